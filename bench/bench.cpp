@@ -0,0 +1,494 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#include "mm/alloc.hpp"
+#include "mm/blocked.hpp"
+#include "mm/compressed.hpp"
+#include "mm/mm.hpp"
+#include "mm/out_of_core.hpp"
+#include "mm/precision.hpp"
+#include "mm/rb.hpp"
+#include "mm/spgemm.hpp"
+#include "mm/spmm.hpp"
+#include "mm/spmv.hpp"
+#include "mm/trsv.hpp"
+#include "mm/tune.hpp"
+#include "generators.hpp"
+
+#include <chrono>
+#include <complex>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+// values are double, or std::complex<double> for hermitian matrices
+using Ordinal = int;
+using Offset = size_t;
+
+struct Stage {
+    std::string name;
+    double seconds;
+    double bytes;   // bytes read or written by the stage
+    double entries; // entries produced or consumed by the stage
+    long peakRss;   // process peak RSS at the end of the stage
+
+    Stage(const std::string &_name, double _seconds, double _bytes, double _entries)
+        : name(_name), seconds(_seconds), bytes(_bytes), entries(_entries), peakRss(peak_rss()) {}
+
+    // peak resident set size of the process so far, in bytes
+    static long peak_rss() {
+        struct rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        return ru.ru_maxrss * 1024L; // kilobytes on Linux
+    }
+};
+
+struct Result {
+    GenParams params;
+    std::string valueType;
+    int64_t rows;
+    int64_t nnz; // stored entries in the file
+    std::vector<Stage> stages;
+    Result(const GenParams &p, const std::string &_valueType) : params(p), valueType(_valueType), rows(0), nnz(0) {}
+};
+
+// the JSON value_type and Matrix Market field of each value type
+static const char *value_type_name(double) { return "double"; }
+static const char *value_type_name(std::complex<double>) { return "complex<double>"; }
+static const char *field_name(double) { return "real"; }
+static const char *field_name(std::complex<double>) { return "complex"; }
+
+static void write_value(FILE *f, double v) { std::fprintf(f, " %.17g", v); }
+static void write_value(FILE *f, const std::complex<double> &v) { std::fprintf(f, " %.17g %.17g", v.real(), v.imag()); }
+
+class Timer {
+    std::chrono::steady_clock::time_point start_;
+public:
+    Timer() : start_(std::chrono::steady_clock::now()) {}
+    double elapsed() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    }
+};
+
+static long file_size(const std::string &path) {
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    return long(f.tellg());
+}
+
+// write coo as a general matrix, real or complex as its values are
+template <typename Coo>
+static void write_coo(const std::string &path, const Coo &coo) {
+    typedef typename Coo::entry_type entry_t;
+    FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        throw std::runtime_error("couldn't open " + path);
+    }
+    std::vector<char> buf(1 << 20);
+    std::setvbuf(f, buf.data(), _IOFBF, buf.size());
+    std::fprintf(f, "%%%%MatrixMarket matrix coordinate %s general\n",
+                 field_name(entry_t().e));
+    std::fprintf(f, "%lld %lld %lld\n", (long long)coo.num_rows(), (long long)coo.num_cols(), (long long)coo.nnz());
+    for (const entry_t &e : coo.entries) {
+        std::fprintf(f, "%lld %lld", (long long)e.i + 1, (long long)e.j + 1);
+        write_value(f, e.e);
+        std::fputc('\n', f);
+    }
+    if (std::fclose(f)) {
+        throw std::runtime_error("error writing " + path);
+    }
+}
+
+// y = A * x, serially
+template <typename Csr, typename Vec>
+static void spmv_serial(Vec &y, const Csr &a, const Vec &x) {
+    const typename Csr::row_ptr_type &rowPtr = a.row_ptr();
+    const typename Csr::col_ind_type &colInd = a.col_ind();
+    const typename Csr::val_type &val = a.val();
+    for (Ordinal i = 0; i < a.num_rows(); ++i) {
+        typename Vec::value_type acc = 0;
+        for (Offset k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+            acc += val[k] * x[colInd[k]];
+        }
+        y[i] = acc;
+    }
+}
+
+// vectors in the spmm stage
+static const int SPMM_VECTORS = 8;
+
+// skip A A when it would do more than this many multiplies per entry of A
+static const uint64_t SPGEMM_MAX_WORK = 64;
+
+// values stored as bfloat16, computed in double; bytes is what the double matrix moves
+template <typename Vec>
+static void run_bfloat16(Result &res, const CSR<Ordinal, double, Offset, DefaultInitAllocator<char>> &a, Vec &y,
+                         const std::vector<double> &x, const std::vector<Ordinal> &bounds, const int reps,
+                         const double bytes) {
+    const CSR<Ordinal, bfloat16, Offset, DefaultInitAllocator<char>> b = convert_values<bfloat16>(a);
+    spmv(y, b, x, bounds);
+    Timer t;
+    for (int r = 0; r < reps; ++r) {
+        spmv(y, b, x, bounds);
+    }
+    const double bbytes = bytes - a.nnz() * (sizeof(double) - sizeof(bfloat16));
+    res.stages.push_back(Stage("spmv.bfloat16", t.elapsed() / reps, bbytes, a.nnz()));
+}
+
+// bfloat16 has no complex counterpart
+template <typename Vec>
+static void run_bfloat16(Result &, const CSR<Ordinal, std::complex<double>, Offset, DefaultInitAllocator<char>> &,
+                         Vec &, const std::vector<std::complex<double>> &, const std::vector<Ordinal> &, const int,
+                         const double) {}
+
+template <typename Scalar>
+static Result run(const GenParams &p, const std::string &dir, const int reps, const bool keep) {
+    typedef MtxReader<Ordinal, Scalar, Offset> reader_t;
+    typedef typename reader_t::coo_type coo_t;
+    typedef typename coo_t::entry_type entry_t;
+    typedef typename reader_t::csr_type csr_t;
+    Result res(p, value_type_name(Scalar()));
+
+    std::stringstream ss;
+    ss << dir << "/mm-bench-" << to_string(p.kind) << "-" << to_string(p.symmetry) << "-" << p.targetNnz
+       << "-" << getpid() << ".mtx";
+    const std::string path = ss.str();
+    const std::string outPath = path + ".out.mtx";
+
+    {
+        Timer t;
+        res.nnz = write_generated(path, p);
+        res.stages.push_back(Stage("generate", t.elapsed(), file_size(path), res.nnz));
+    }
+    const double fileBytes = file_size(path);
+
+    Timer tb;
+    reader_t reader(path);
+    res.stages.push_back(Stage("banner", tb.elapsed(), reader.data_begin(), 0));
+    res.rows = reader.info().nrows;
+
+    {
+        // parse every entry without storing it
+        Timer t;
+        size_t n = 0;
+        reader.for_each_entry([&n](const entry_t &) { ++n; });
+        res.stages.push_back(Stage("parse", t.elapsed(), fileBytes, n));
+    }
+
+    Timer tc;
+    reader_t cooReader(path); // fresh statistics for this stage
+    coo_t coo = cooReader.read_coo();
+    res.stages.push_back(Stage("coo", tc.elapsed(), fileBytes, coo.nnz()));
+
+    LoadStats stats = cooReader.stats();
+    Timer tr;
+    csr_t csr(coo, &stats);
+    res.stages.push_back(Stage("csr", tr.elapsed(), coo.nnz() * sizeof(entry_t), csr.nnz()));
+
+    {
+        // the same matrix from a Rutherford-Boeing file: compressed columns, no sort
+        const std::string rbPath = path + ".rb";
+        write_rb(rbPath, csr);
+        Timer t;
+        const csr_t rb = RbReader<Ordinal, Scalar, Offset>(rbPath).read_csr();
+        res.stages.push_back(Stage("csr.rb", t.elapsed(), file_size(rbPath), rb.nnz()));
+        std::remove(rbPath.c_str());
+    }
+
+    {
+        // the same CSR built on disk in an eighth of the COO's memory, then mapped
+        const std::string prefix = path + ".csr";
+        Timer t;
+        build_csr_files(reader, prefix, std::max(uint64_t(1) << 20, uint64_t(coo.nnz() * sizeof(entry_t) / 8)), dir);
+        res.stages.push_back(Stage("csr.out_of_core", t.elapsed(), fileBytes, coo.nnz()));
+        const MappedCSR<Ordinal, Scalar, Offset> mcsr(prefix);
+        std::vector<Scalar> x(mcsr.num_cols(), 1), y(mcsr.num_rows());
+        const std::vector<Ordinal> bounds = balanced_row_blocks(mcsr, num_threads());
+        spmv(y, mcsr, x, bounds);
+        Timer tm;
+        for (int r = 0; r < reps; ++r) {
+            spmv(y, mcsr, x, bounds);
+        }
+        const double bytes = mcsr.nnz() * (sizeof(Ordinal) + sizeof(Scalar)) + (mcsr.num_rows() + 1) * sizeof(Offset)
+                           + (mcsr.num_rows() + mcsr.num_cols()) * sizeof(Scalar);
+        res.stages.push_back(Stage("spmv.mapped", tm.elapsed() / reps, bytes, mcsr.nnz()));
+        remove_csr_files(prefix);
+    }
+
+#if MM_INSTRUMENT
+    // breakdown of the coo and csr stages
+    res.stages.push_back(Stage("coo.io", stats.io_s, fileBytes, stats.entries));
+    res.stages.push_back(Stage("coo.parse", stats.parse_s, fileBytes, stats.entries));
+    res.stages.push_back(Stage("coo.emit", stats.emit_s, stats.peak_bytes, stats.entries));
+    res.stages.push_back(Stage("csr.copy", stats.csr_copy_s, coo.nnz() * sizeof(entry_t), coo.nnz()));
+    res.stages.push_back(Stage("csr.sort", stats.csr_sort_s, coo.nnz() * sizeof(entry_t), coo.nnz()));
+    res.stages.push_back(Stage("csr.fill", stats.csr_fill_s, stats.csr_peak_bytes, csr.nnz()));
+#endif
+
+    {
+        std::vector<Scalar> x(csr.num_cols(), 1), y(csr.num_rows());
+        spmv_serial(y, csr, x); // warm up
+        Timer t;
+        for (int r = 0; r < reps; ++r) {
+            spmv_serial(y, csr, x);
+        }
+        const double bytes = csr.nnz() * (sizeof(Ordinal) + sizeof(Scalar)) + (csr.num_rows() + 1) * sizeof(Offset)
+                           + (csr.num_rows() + csr.num_cols()) * sizeof(Scalar);
+        res.stages.push_back(Stage("spmv", t.elapsed() / reps, bytes, csr.nnz()));
+
+        // the same with every array in huge pages
+        typedef HugePageAllocator<char> huge_t;
+        const CSR<Ordinal, Scalar, Offset, huge_t> hcsr(coo, huge_t());
+        std::vector<Scalar, HugePageAllocator<Scalar>> hx(x.begin(), x.end()), hy(y.size());
+        spmv_serial(hy, hcsr, hx);
+        Timer th;
+        for (int r = 0; r < reps; ++r) {
+            spmv_serial(hy, hcsr, hx);
+        }
+        res.stages.push_back(Stage("spmv.hugepage", th.elapsed() / reps, bytes, csr.nnz()));
+
+        // multithreaded, on arrays and vectors first touched by the threads that use them
+        std::vector<Ordinal> bounds;
+        const CSR<Ordinal, Scalar, Offset, DefaultInitAllocator<char>> ftcsr = first_touch_csr(coo, bounds);
+        std::vector<Scalar, DefaultInitAllocator<Scalar>> fty(y.size());
+        spmv(fty, ftcsr, x, bounds);
+        Timer tp;
+        for (int r = 0; r < reps; ++r) {
+            spmv(fty, ftcsr, x, bounds);
+        }
+        res.stages.push_back(Stage("spmv.parallel", tp.elapsed() / reps, bytes, csr.nnz()));
+
+        // the same rows with 16-bit column offsets
+        const CompressedCSR<Ordinal, Scalar, Offset> ccsr(csr);
+        spmv(y, ccsr, x, bounds);
+        Timer tz;
+        for (int r = 0; r < reps; ++r) {
+            spmv(y, ccsr, x, bounds);
+        }
+        const double cbytes = ccsr.index_bytes() + ccsr.val().size() * sizeof(Scalar) + (csr.num_rows() + csr.num_cols()) * sizeof(Scalar);
+        res.stages.push_back(Stage("spmv.compressed", tz.elapsed() / reps, cbytes, csr.nnz()));
+
+        run_bfloat16(res, ftcsr, fty, x, bounds, reps, bytes);
+
+        // rows split into panels and columns into tiles sized to L2
+        const BlockedCSR<Ordinal, Scalar, Offset> blcsr(csr);
+        const std::vector<Ordinal> blbounds = balanced_row_blocks(blcsr, num_threads());
+        spmv(y, blcsr, x, blbounds);
+        Timer tk;
+        for (int r = 0; r < reps; ++r) {
+            spmv(y, blcsr, x, blbounds);
+        }
+        const double blbytes = bytes + blcsr.num_block_rows() * (2 * sizeof(Ordinal) + sizeof(Offset));
+        res.stages.push_back(Stage("spmv.blocked", tk.elapsed() / reps, blbytes, csr.nnz()));
+
+        // the layout tune_spmv picks, and the trials it took to pick it
+        Timer tt;
+        const SpmvDecision decision = tune_spmv(csr);
+        res.stages.push_back(Stage("tune", tt.elapsed(), 0, csr.nnz()));
+        const TunedSpmv<Ordinal, Scalar, Offset> tuned(csr, decision);
+        tuned.apply(y, x);
+        Timer tu;
+        for (int r = 0; r < reps; ++r) {
+            tuned.apply(y, x);
+        }
+        res.stages.push_back(Stage("spmv.tuned", tu.elapsed() / reps, bytes, csr.nnz()));
+
+        // SPMM_VECTORS vectors at once, row-major; entries count once per vector
+        {
+            std::vector<Scalar> xb(csr.num_cols() * SPMM_VECTORS, 1), yb(csr.num_rows() * SPMM_VECTORS);
+            spmm(yb.data(), SPMM_VECTORS, ftcsr, xb.data(), SPMM_VECTORS, SPMM_VECTORS, DenseLayout::ROW_MAJOR, bounds);
+            Timer tm;
+            for (int r = 0; r < reps; ++r) {
+                spmm(yb.data(), SPMM_VECTORS, ftcsr, xb.data(), SPMM_VECTORS, SPMM_VECTORS, DenseLayout::ROW_MAJOR, bounds);
+            }
+            const double mbytes = csr.nnz() * (sizeof(Ordinal) + sizeof(Scalar)) + (csr.num_rows() + 1) * sizeof(Offset)
+                                + (csr.num_rows() + csr.num_cols()) * SPMM_VECTORS * sizeof(Scalar);
+            res.stages.push_back(Stage("spmm", tm.elapsed() / reps, mbytes, csr.nnz() * SPMM_VECTORS));
+        }
+
+        // one stored triangle, both applied in one sweep
+        if (GenSymmetry::GENERAL != p.symmetry) {
+            reader_t triReader(path);
+            triReader.set_expand_symmetry(false);
+            const csr_t tcsr(triReader.read_coo());
+            SymmetricSpmvSchedule<Ordinal, Scalar, Offset> sched(tcsr, balanced_row_blocks(tcsr, num_threads()));
+            spmv_symmetric(y, tcsr, x, sched);
+            Timer ts;
+            for (int r = 0; r < reps; ++r) {
+                spmv_symmetric(y, tcsr, x, sched);
+            }
+            const double sbytes = tcsr.nnz() * (sizeof(Ordinal) + sizeof(Scalar)) + (tcsr.num_rows() + 1) * sizeof(Offset)
+                                + (tcsr.num_rows() + tcsr.num_cols()) * sizeof(Scalar)
+                                + 2 * sched.num_buffered() * sizeof(Scalar);
+            res.stages.push_back(Stage("spmv.symmetric", ts.elapsed() / reps, sbytes, csr.nnz()));
+        }
+    }
+
+    if (csr.num_rows() == csr.num_cols()) {
+        // unit lower triangle: the analysis once, then each solve
+        Timer ta;
+        const TrsvSchedule<Ordinal, Offset> sched(csr, Triangle::LOWER, Diagonal::UNIT);
+        res.stages.push_back(Stage("trsv.analysis", ta.elapsed(), csr.nnz() * sizeof(Ordinal), csr.nnz()));
+        std::vector<Scalar> b(csr.num_rows(), 1), x(csr.num_rows());
+        trsv(x, csr, b, sched);
+        Timer t;
+        for (int r = 0; r < reps; ++r) {
+            trsv(x, csr, b, sched);
+        }
+        const double bytes = csr.nnz() * (sizeof(Ordinal) + sizeof(Scalar)) / 2 + 2 * csr.num_rows() * sizeof(Scalar);
+        res.stages.push_back(Stage("trsv", t.elapsed() / reps, bytes, csr.nnz() / 2));
+    }
+
+    if (csr.num_rows() == csr.num_cols() && spgemm_work(csr, csr).back() <= SPGEMM_MAX_WORK * uint64_t(csr.nnz())) {
+        // A A, sized by the symbolic phase
+        Timer t;
+        const csr_t c = spgemm(csr, csr);
+        res.stages.push_back(Stage("spgemm", t.elapsed(), csr.nnz() * (sizeof(Ordinal) + sizeof(Scalar)), c.nnz()));
+    }
+
+    {
+        Timer t;
+        write_coo(outPath, coo);
+        res.stages.push_back(Stage("write", t.elapsed(), file_size(outPath), coo.nnz()));
+    }
+
+    if (!keep) {
+        std::remove(path.c_str());
+        std::remove(outPath.c_str());
+    }
+    return res;
+}
+
+static void write_json(std::ostream &os, const std::vector<Result> &results) {
+    os.precision(6);
+    os << "{\n  \"benchmarks\": [";
+    for (size_t r = 0; r < results.size(); ++r) {
+        const Result &res = results[r];
+        os << (r ? "," : "") << "\n    {\n";
+        os << "      \"matrix\": \"" << to_string(res.params.kind) << "\",\n";
+        os << "      \"symmetry\": \"" << to_string(res.params.symmetry) << "\",\n";
+        os << "      \"value_type\": \"" << res.valueType << "\",\n";
+        os << "      \"seed\": " << res.params.seed << ",\n";
+        os << "      \"rows\": " << res.rows << ",\n";
+        os << "      \"nnz\": " << res.nnz << ",\n";
+        os << "      \"stages\": [";
+        for (size_t s = 0; s < res.stages.size(); ++s) {
+            const Stage &st = res.stages[s];
+            os << (s ? "," : "") << "\n        {";
+            os << "\"name\": \"" << st.name << "\", ";
+            os << "\"seconds\": " << st.seconds << ", ";
+            os << "\"MB_per_s\": " << (st.seconds > 0 ? st.bytes / st.seconds / 1e6 : 0) << ", ";
+            os << "\"entries_per_s\": " << (st.seconds > 0 ? st.entries / st.seconds : 0) << ", ";
+            os << "\"peak_rss_bytes\": " << st.peakRss << "}";
+        }
+        os << "\n      ]\n    }";
+    }
+    os << "\n  ]\n}\n";
+}
+
+static bool parse_case(const std::string &s, GenKind &kind, GenSymmetry &sym) {
+    const std::string k = s.substr(0, s.find(':'));
+    const std::string y = s.find(':') == std::string::npos ? "general" : s.substr(s.find(':') + 1);
+    if ("banded" == k) kind = GenKind::BANDED;
+    else if ("uniform" == k) kind = GenKind::UNIFORM;
+    else if ("powerlaw" == k) kind = GenKind::POWERLAW;
+    else if ("blockdiag" == k) kind = GenKind::BLOCKDIAG;
+    else return false;
+    if ("general" == y) sym = GenSymmetry::GENERAL;
+    else if ("symmetric" == y) sym = GenSymmetry::SYMMETRIC;
+    else if ("hermitian" == y) sym = GenSymmetry::HERMITIAN;
+    else return false;
+    return true;
+}
+
+static void usage(const char *argv0) {
+    std::cerr << "USAGE: " << argv0 << " [-n nnz] [-s seed] [-r reps] [-d dir] [-o out.json] [-k] [kind[:symmetry]]...\n";
+    std::cerr << "  kind: banded, uniform, powerlaw, blockdiag\n";
+    std::cerr << "  symmetry: general (default), symmetric, hermitian\n";
+    std::cerr << "  -n: about this many stored entries per matrix (default: 1000000)\n";
+    std::cerr << "  -s: generator seed (default: 0)\n";
+    std::cerr << "  -r: SpMV repetitions (default: 10)\n";
+    std::cerr << "  -d: directory for generated files (default: /tmp)\n";
+    std::cerr << "  -o: write JSON results here instead of stdout\n";
+    std::cerr << "  -k: keep generated files\n";
+    std::cerr << "peak_rss_bytes is the process peak so far; run one matrix per process to isolate it\n";
+    std::cerr << "spmv.parallel and spmv.symmetric use MM_NUM_THREADS threads (default: all hardware threads)\n";
+    std::cerr << "spmm multiplies " << SPMM_VECTORS << " vectors at once; compare its entries_per_s with spmv.parallel\n";
+    std::cerr << "spmv.blocked tiles x to half of L2 and panels y to at most that, at least 4 panels per thread, on MM_NUM_THREADS threads\n";
+    std::cerr << "spmv.tuned uses the layout tune_spmv picks among csr, compressed, and blocked, on one or all threads\n";
+    std::cerr << "csr.rb reads the CSR back from a Rutherford-Boeing copy of the file, compare with coo + csr\n";
+    std::cerr << "csr.out_of_core builds the CSR files in the -d directory with an eighth of the COO's memory\n";
+    std::cerr << "trsv solves with the unit lower triangle, counting half the entries\n";
+    std::cerr << "spgemm (A A) is skipped for matrices that need more than " << SPGEMM_MAX_WORK << " multiplies per entry\n";
+    std::cerr << "spmv.symmetric only runs for symmetric and hermitian matrices, storing one triangle\n";
+    std::cerr << "hermitian matrices have complex<double> values, counted as 16 bytes, and skip spmv.bfloat16\n";
+}
+
+int main(int argc, char **argv) {
+    int64_t nnz = 1000000;
+    uint64_t seed = 0;
+    int reps = 10;
+    std::string dir = "/tmp";
+    std::string out;
+    bool keep = false;
+    std::vector<GenParams> cases;
+
+    for (int i = 1; i < argc; ++i) {
+        if (0 == std::strcmp(argv[i], "-n") && i + 1 < argc) {
+            nnz = std::atoll(argv[++i]);
+        } else if (0 == std::strcmp(argv[i], "-s") && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (0 == std::strcmp(argv[i], "-r") && i + 1 < argc) {
+            reps = std::max(1, std::atoi(argv[++i]));
+        } else if (0 == std::strcmp(argv[i], "-d") && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (0 == std::strcmp(argv[i], "-o") && i + 1 < argc) {
+            out = argv[++i];
+        } else if (0 == std::strcmp(argv[i], "-k")) {
+            keep = true;
+        } else {
+            GenKind kind;
+            GenSymmetry sym;
+            if (!parse_case(argv[i], kind, sym)) {
+                usage(argv[0]);
+                return 1;
+            }
+            cases.push_back(GenParams(kind, sym, nnz, seed));
+        }
+    }
+    // -n and -s apply to every case, wherever they appear
+    for (GenParams &p : cases) {
+        p.targetNnz = nnz;
+        p.seed = seed;
+    }
+
+    if (cases.empty()) {
+        cases.push_back(GenParams(GenKind::BANDED, GenSymmetry::GENERAL, nnz, seed));
+        cases.push_back(GenParams(GenKind::UNIFORM, GenSymmetry::GENERAL, nnz, seed));
+        cases.push_back(GenParams(GenKind::POWERLAW, GenSymmetry::GENERAL, nnz, seed));
+        cases.push_back(GenParams(GenKind::BLOCKDIAG, GenSymmetry::GENERAL, nnz, seed));
+        cases.push_back(GenParams(GenKind::BANDED, GenSymmetry::SYMMETRIC, nnz, seed));
+        cases.push_back(GenParams(GenKind::POWERLAW, GenSymmetry::HERMITIAN, nnz, seed));
+    }
+
+    std::vector<Result> results;
+    for (const GenParams &p : cases) {
+        std::cerr << to_string(p.kind) << ":" << to_string(p.symmetry) << std::endl;
+        results.push_back(GenSymmetry::HERMITIAN == p.symmetry ? run<std::complex<double>>(p, dir, reps, keep)
+                                                               : run<double>(p, dir, reps, keep));
+    }
+
+    if (out.empty()) {
+        write_json(std::cout, results);
+    } else {
+        std::ofstream outf(out);
+        write_json(outf, results);
+    }
+    return 0;
+}
@@ -0,0 +1,216 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/* Deterministic synthetic matrix generators.
+
+   Each generator produces the entries of one row at a time, so matrices with
+   far more non-zeros than fit in memory can be written. The same kind, size,
+   and seed always produce the same file.
+   Symmetric and Hermitian variants keep only the lower triangle, as the format requires.
+*/
+
+enum class GenKind {
+    BANDED,     // every entry within a fixed distance of the diagonal
+    UNIFORM,    // a fixed number of uniformly random columns per row
+    POWERLAW,   // heavy-tailed row lengths, columns skewed toward low indices
+    BLOCKDIAG   // dense-ish square blocks on the diagonal, like 08blocks
+};
+
+enum class GenSymmetry {
+    GENERAL,
+    SYMMETRIC,
+    HERMITIAN
+};
+
+inline const char *to_string(GenKind k) {
+    switch (k) {
+    case GenKind::BANDED: return "banded";
+    case GenKind::UNIFORM: return "uniform";
+    case GenKind::POWERLAW: return "powerlaw";
+    case GenKind::BLOCKDIAG: return "blockdiag";
+    }
+    return "unknown";
+}
+
+inline const char *to_string(GenSymmetry s) {
+    switch (s) {
+    case GenSymmetry::GENERAL: return "general";
+    case GenSymmetry::SYMMETRIC: return "symmetric";
+    case GenSymmetry::HERMITIAN: return "hermitian";
+    }
+    return "unknown";
+}
+
+struct GenParams {
+    GenKind kind;
+    GenSymmetry symmetry;
+    int64_t targetNnz; // about this many stored entries are generated
+    uint64_t seed;
+
+    GenParams(GenKind _kind, GenSymmetry _symmetry, int64_t _targetNnz, uint64_t _seed = 0)
+        : kind(_kind), symmetry(_symmetry), targetNnz(_targetNnz), seed(_seed) {}
+};
+
+class Generator {
+public:
+    typedef std::mt19937_64 rng_t;
+
+    explicit Generator(const GenParams &p) : p_(p), rng_(p.seed) {
+        switch (p.kind) {
+        case GenKind::BANDED: {
+            bw_ = 8;
+            n_ = std::max(int64_t(1), p.targetNnz / (2 * bw_ + 1));
+            break;
+        }
+        case GenKind::UNIFORM: {
+            perRow_ = 16;
+            n_ = std::max(int64_t(1), p.targetNnz / perRow_);
+            break;
+        }
+        case GenKind::POWERLAW: {
+            perRow_ = 16; // mean row length
+            n_ = std::max(int64_t(1), p.targetNnz / perRow_);
+            break;
+        }
+        case GenKind::BLOCKDIAG: {
+            bw_ = 32; // block size
+            n_ = std::max(int64_t(bw_), p.targetNnz / (bw_ / 2) / bw_ * bw_);
+            break;
+        }
+        }
+        // symmetric variants keep about half of each row
+        if (p.symmetry != GenSymmetry::GENERAL) {
+            n_ = std::max(int64_t(1), n_ * 2);
+        }
+    }
+
+    int64_t num_rows() const { return n_; }
+    int64_t num_cols() const { return n_; }
+    bool complex() const { return p_.symmetry == GenSymmetry::HERMITIAN; }
+
+    /* append the sorted, unique, 0-indexed columns of row i to cols.
+       rows must be requested in order 0, 1, ... for the output to be deterministic
+    */
+    void row(const int64_t i, std::vector<int64_t> &cols) {
+        cols.clear();
+        switch (p_.kind) {
+        case GenKind::BANDED: {
+            for (int64_t j = std::max(int64_t(0), i - bw_); j <= std::min(n_ - 1, i + bw_); ++j) {
+                cols.push_back(j);
+            }
+            break;
+        }
+        case GenKind::UNIFORM: {
+            std::uniform_int_distribution<int64_t> dist(0, n_ - 1);
+            for (int64_t k = 0; k < perRow_; ++k) {
+                cols.push_back(dist(rng_));
+            }
+            break;
+        }
+        case GenKind::POWERLAW: {
+            // Pareto row lengths with tail exponent 2 (mean = 2 * minimum),
+            // columns from a density that falls off as a power of the index
+            std::uniform_real_distribution<double> u(0, 1);
+            const double dmin = perRow_ / 2.0;
+            const int64_t d = std::min(n_, int64_t(dmin / std::sqrt(1 - u(rng_))));
+            for (int64_t k = 0; k < d; ++k) {
+                cols.push_back(std::min(n_ - 1, int64_t(n_ * std::pow(u(rng_), 3.0))));
+            }
+            break;
+        }
+        case GenKind::BLOCKDIAG: {
+            // each block is about half full
+            std::bernoulli_distribution keep(0.5);
+            const int64_t b = i / bw_ * bw_;
+            for (int64_t j = b; j < std::min(n_, b + bw_); ++j) {
+                if (j == i || keep(rng_)) {
+                    cols.push_back(j);
+                }
+            }
+            break;
+        }
+        }
+
+        if (p_.symmetry != GenSymmetry::GENERAL) {
+            // keep the lower triangle
+            cols.erase(std::remove_if(cols.begin(), cols.end(), [i](int64_t j) { return j > i; }), cols.end());
+        }
+        std::sort(cols.begin(), cols.end());
+        cols.erase(std::unique(cols.begin(), cols.end()), cols.end());
+    }
+
+    // value of the next entry in row i, column j
+    void value(const int64_t i, const int64_t j, double &re, double &im) {
+        std::uniform_real_distribution<double> u(-1, 1);
+        re = u(rng_);
+        if (0 == re) {
+            re = 1; // no explicit zeros
+        }
+        // hermitian diagonal must be real
+        im = (complex() && i != j) ? u(rng_) : 0;
+    }
+
+private:
+    GenParams p_;
+    rng_t rng_;
+    int64_t n_;
+    int64_t bw_;
+    int64_t perRow_;
+};
+
+/* write the matrix described by p to path, returning the number of stored entries.
+   The nnz field of the size line is padded and filled in at the end,
+   since generators only know their exact nnz once they are done.
+*/
+inline int64_t write_generated(const std::string &path, const GenParams &p) {
+    Generator gen(p);
+
+    FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        throw std::runtime_error("couldn't open " + path);
+    }
+    std::vector<char> buf(1 << 20);
+    std::setvbuf(f, buf.data(), _IOFBF, buf.size());
+
+    std::fprintf(f, "%%%%MatrixMarket matrix coordinate %s %s\n", gen.complex() ? "complex" : "real",
+                 to_string(p.symmetry));
+    std::fprintf(f, "%% generated by github.com/cwpearson/matrix-market/bench: %s seed=%llu\n",
+                 to_string(p.kind), (unsigned long long)p.seed);
+    std::fprintf(f, "%lld %lld ", (long long)gen.num_rows(), (long long)gen.num_cols());
+    const long nnzPos = std::ftell(f);
+    std::fprintf(f, "%-20s\n", "");
+
+    int64_t nnz = 0;
+    std::vector<int64_t> cols;
+    for (int64_t i = 0; i < gen.num_rows(); ++i) {
+        gen.row(i, cols);
+        for (int64_t j : cols) {
+            double re, im;
+            gen.value(i, j, re, im);
+            if (gen.complex()) {
+                std::fprintf(f, "%lld %lld %.17g %.17g\n", (long long)i + 1, (long long)j + 1, re, im);
+            } else {
+                std::fprintf(f, "%lld %lld %.17g\n", (long long)i + 1, (long long)j + 1, re);
+            }
+        }
+        nnz += int64_t(cols.size());
+    }
+
+    std::fseek(f, nnzPos, SEEK_SET);
+    std::fprintf(f, "%-20lld", (long long)nnz);
+    if (std::fclose(f)) {
+        throw std::runtime_error("error writing " + path);
+    }
+    return nnz;
+}
@@ -0,0 +1,282 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <sys/mman.h>
+
+/* Allocators for the Alloc parameter of COO, CSR, and MtxReader.
+
+   HugePageAllocator puts large arrays in 2 MiB-aligned mappings advised for transparent
+   huge pages, so streaming them (as SpMV does) takes far fewer TLB misses.
+   Arena hands out memory from a few large chunks and takes it all back at once,
+   so a service that loads and releases many matrices reuses the same memory
+   instead of fragmenting the heap, and its RSS stays at the high-water mark.
+   DefaultInitAllocator wraps either (or std::allocator) so that resizing an array
+   does not write it, leaving the first write to whichever thread fills it.
+*/
+
+static constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+/* bytes rounded up to a whole number of huge pages,
+   mapped at a huge-page boundary and advised for huge pages
+*/
+inline void *hugepage_alloc(size_t bytes)
+{
+    const size_t size = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    // over-map by one huge page and trim, since mmap only aligns to small pages
+    void *raw = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == raw)
+    {
+        throw std::bad_alloc();
+    }
+    char *begin = static_cast<char *>(raw);
+    char *aligned = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(begin) + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE);
+    if (aligned > begin)
+    {
+        munmap(begin, aligned - begin);
+    }
+    char *end = begin + size + HUGE_PAGE_SIZE;
+    if (end > aligned + size)
+    {
+        munmap(aligned + size, end - (aligned + size));
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, size, MADV_HUGEPAGE); // advice only, so failure is fine
+#endif
+    return aligned;
+}
+
+// release memory from hugepage_alloc(bytes)
+inline void hugepage_free(void *p, size_t bytes)
+{
+    const size_t size = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    munmap(p, size);
+}
+
+/* allocations of at least half a huge page come from hugepage_alloc, smaller ones from operator new
+ */
+template <typename T>
+struct HugePageAllocator
+{
+    typedef T value_type;
+    static constexpr size_t MIN_BYTES = HUGE_PAGE_SIZE / 2;
+
+    HugePageAllocator() = default;
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U> &) {}
+
+    T *allocate(size_t n)
+    {
+        const size_t bytes = n * sizeof(T);
+        if (bytes >= MIN_BYTES)
+        {
+            return static_cast<T *>(hugepage_alloc(bytes));
+        }
+        return static_cast<T *>(::operator new(bytes));
+    }
+
+    void deallocate(T *p, size_t n)
+    {
+        const size_t bytes = n * sizeof(T);
+        if (bytes >= MIN_BYTES)
+        {
+            hugepage_free(p, bytes);
+        }
+        else
+        {
+            ::operator delete(p);
+        }
+    }
+
+    template <typename U>
+    bool operator==(const HugePageAllocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const HugePageAllocator<U> &) const { return false; }
+};
+
+/* Bump allocation from large chunks.
+   Individual deallocations are ignored; reset() makes all the memory available again
+   while keeping the chunks, and release() returns the chunks to the system.
+   Allocation is thread-safe.
+*/
+class Arena
+{
+    struct Chunk
+    {
+        char *p;
+        size_t size;
+    };
+
+    std::vector<Chunk> chunks_;
+    size_t current_; // chunk being allocated from
+    size_t offset_;  // next free byte in the current chunk
+    size_t used_;
+    const size_t chunkBytes_;
+    const bool hugePages_;
+    std::mutex m_;
+
+    Chunk new_chunk(size_t bytes)
+    {
+        Chunk c;
+        c.size = std::max(bytes, chunkBytes_);
+        if (hugePages_)
+        {
+            c.size = (c.size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+            c.p = static_cast<char *>(hugepage_alloc(c.size));
+        }
+        else
+        {
+            c.p = static_cast<char *>(::operator new(c.size));
+        }
+        return c;
+    }
+
+public:
+    /* new chunks hold at least chunkBytes, and come from hugepage_alloc if hugePages
+     */
+    explicit Arena(size_t chunkBytes = size_t(64) << 20, bool hugePages = false)
+        : current_(0), offset_(0), used_(0), chunkBytes_(chunkBytes), hugePages_(hugePages) {}
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+    ~Arena() { release(); }
+
+    void *allocate(size_t bytes, size_t align)
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        // the first chunk from the current one on with room, or a new one
+        while (current_ < chunks_.size())
+        {
+            const uintptr_t base = reinterpret_cast<uintptr_t>(chunks_[current_].p);
+            const size_t start = size_t((base + offset_ + align - 1) / align * align - base);
+            if (start + bytes <= chunks_[current_].size)
+            {
+                offset_ = start + bytes;
+                used_ += bytes;
+                return chunks_[current_].p + start;
+            }
+            ++current_;
+            offset_ = 0;
+        }
+        chunks_.push_back(new_chunk(bytes + align));
+        current_ = chunks_.size() - 1;
+        const uintptr_t base = reinterpret_cast<uintptr_t>(chunks_[current_].p);
+        const size_t start = size_t((base + align - 1) / align * align - base);
+        offset_ = start + bytes;
+        used_ += bytes;
+        return chunks_[current_].p + start;
+    }
+
+    /* make all memory available again.
+       Nothing allocated from the arena may be used afterwards
+    */
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        current_ = 0;
+        offset_ = 0;
+        used_ = 0;
+    }
+
+    // reset() and return the chunks to the system
+    void release()
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        for (const Chunk &c : chunks_)
+        {
+            if (hugePages_)
+            {
+                hugepage_free(c.p, c.size);
+            }
+            else
+            {
+                ::operator delete(c.p);
+            }
+        }
+        chunks_.clear();
+        current_ = 0;
+        offset_ = 0;
+        used_ = 0;
+    }
+
+    // bytes handed out since the last reset
+    size_t used() const { return used_; }
+
+    // bytes held in chunks
+    size_t capacity() const
+    {
+        size_t n = 0;
+        for (const Chunk &c : chunks_)
+        {
+            n += c.size;
+        }
+        return n;
+    }
+};
+
+/* allocates from an Arena, which must outlive every container using it
+ */
+template <typename T>
+class ArenaAllocator
+{
+    Arena *arena_;
+
+public:
+    typedef T value_type;
+
+    explicit ArenaAllocator(Arena &arena) : arena_(&arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena_(&other.arena()) {}
+
+    T *allocate(size_t n) { return static_cast<T *>(arena_->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T *, size_t) {}
+
+    Arena &arena() const { return *arena_; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &rhs) const { return arena_ == &rhs.arena(); }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U> &rhs) const { return !(*this == rhs); }
+};
+
+/* A with value-initialization replaced by default-initialization,
+   so resize() and sized construction of arrays of arithmetic types leave the memory untouched.
+   On a first-touch NUMA system each page is then placed by the thread that first writes it.
+*/
+template <typename T, typename A = std::allocator<T>>
+class DefaultInitAllocator : public A
+{
+    typedef std::allocator_traits<A> traits;
+
+public:
+    template <typename U>
+    struct rebind
+    {
+        typedef DefaultInitAllocator<U, typename traits::template rebind_alloc<U>> other;
+    };
+
+    DefaultInitAllocator() = default;
+    DefaultInitAllocator(const A &a) : A(a) {}
+    template <typename U, typename B>
+    DefaultInitAllocator(const DefaultInitAllocator<U, B> &other) : A(static_cast<const B &>(other)) {}
+
+    template <typename U>
+    void construct(U *p)
+    {
+        ::new (static_cast<void *>(p)) U;
+    }
+    template <typename U, typename... Args>
+    void construct(U *p, Args &&...args)
+    {
+        traits::construct(static_cast<A &>(*this), p, std::forward<Args>(args)...);
+    }
+};
@@ -0,0 +1,213 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#pragma once
+
+#include "mm/mm.hpp"
+#include "mm/parallel.hpp"
+#include "mm/partition.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <unistd.h>
+
+/* CSR split into 2D cache blocks, for SpMV of matrices whose rows span many columns.
+
+   Rows are grouped into panels of panel_height() rows and columns into tiles of tile_width()
+   columns. Each (panel, tile) block lists the rows of the panel that have an entry in the tile,
+   and where those entries are in the source CSR: its rows are sorted, so a row's entries in one
+   tile are contiguous. SpMV visits a panel's blocks tile by tile, so while one block is read its
+   x tile (and the panel's y) stay in cache, instead of every row gathering from the whole of x.
+
+   The default x tile is half of L2. The default panel is as tall, but no taller than a quarter of
+   a thread's share of the rows, since threads get whole panels. Building is O(nnz). No entries
+   are copied: a BlockedCSR stores a row, an offset and a length for every nonempty row of a
+   block, and reads the entries from the CSR it was built from, which must outlive it.
+*/
+
+/* bytes of L2 cache per core, or 256 KiB if the system won't say
+ */
+inline uint64_t l2_cache_bytes()
+{
+#ifdef _SC_LEVEL2_CACHE_SIZE
+    const long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (l2 > 0)
+    {
+        return uint64_t(l2);
+    }
+#endif
+    return uint64_t(256) << 10;
+}
+
+template <typename Ordinal, typename Scalar, typename Offset = size_t, typename Alloc = std::allocator<char>>
+class BlockedCSR
+{
+public:
+    typedef CSR<Ordinal, Scalar, Offset, Alloc> csr_type;
+
+private:
+    const csr_type &a_;
+    Ordinal tileWidth_, panelHeight_;
+    Ordinal nTiles_, nPanels_;
+    std::vector<Offset> blockRow_;  // rows of block b = p * nTiles_ + c are [blockRow_[b], blockRow_[b+1])
+    std::vector<Ordinal> rows_;     // the row of each of those
+    std::vector<Offset> rowBegin_;  // its first entry in the tile, an index into a_.col_ind() and a_.val()
+    std::vector<Ordinal> rowLen_;   // and how many it has there
+    std::vector<Offset> panelWork_; // prefix sum of the entries and rows of each panel
+
+public:
+    /* a with sorted rows, which must outlive this. A tileWidth or panelHeight of 0 picks the default,
+       the panel for num_threads() threads
+     */
+    explicit BlockedCSR(const csr_type &a, Ordinal tileWidth = 0, Ordinal panelHeight = 0) : a_(a)
+    {
+        if (a.symmetry() != Info::Symmetry::GENERAL)
+        {
+            throw std::logic_error("BlockedCSR: needs general storage, see expand()");
+        }
+        const Ordinal nrows = a.num_rows();
+        const Ordinal fit = Ordinal(std::max<uint64_t>(1, l2_cache_bytes() / 2 / sizeof(Scalar)));
+        tileWidth_ = std::max(Ordinal(1), tileWidth > 0 ? tileWidth : fit);
+        // at least 4 panels per thread, so balanced_row_blocks can give each of them rows
+        const int64_t share = (int64_t(nrows) + 4 * num_threads() - 1) / (4 * num_threads());
+        panelHeight_ = std::max(Ordinal(1), panelHeight > 0 ? panelHeight : Ordinal(std::min(int64_t(fit), share)));
+        nTiles_ = std::max(Ordinal(1), Ordinal((int64_t(a.num_cols()) + tileWidth_ - 1) / tileWidth_));
+        nPanels_ = Ordinal((int64_t(nrows) + panelHeight_ - 1) / panelHeight_);
+
+        blockRow_.reserve(size_t(nPanels_) * nTiles_ + 1);
+        blockRow_.push_back(0);
+        panelWork_.assign(1, 0);
+
+        // past the entries from k on that share its row and tile, k being the first of them
+        auto tile_end = [&](Offset k, Offset e)
+        {
+            const Ordinal last = (a.col_ind(k) / tileWidth_ + 1) * tileWidth_;
+            while (k < e && a.col_ind(k) < last)
+            {
+                ++k;
+            }
+            return k;
+        };
+
+        // within a panel, each row's segments go to their tiles with a counting sort that keeps row order
+        std::vector<Offset> tilePtr(nTiles_ + 1);
+        for (Ordinal p = 0; p < nPanels_; ++p)
+        {
+            const Ordinal lb = p * panelHeight_, ub = std::min(nrows, lb + panelHeight_);
+            std::fill(tilePtr.begin(), tilePtr.end(), 0);
+            for (Ordinal i = lb; i < ub; ++i)
+            {
+                for (Offset k = a.row_ptr(i); k < a.row_ptr(i + 1); k = tile_end(k, a.row_ptr(i + 1)))
+                {
+                    ++tilePtr[a.col_ind(k) / tileWidth_ + 1];
+                }
+            }
+            const Offset first = Offset(rows_.size());
+            for (Ordinal c = 0; c < nTiles_; ++c)
+            {
+                tilePtr[c + 1] += tilePtr[c];
+                blockRow_.push_back(first + tilePtr[c + 1]);
+            }
+            rows_.resize(first + tilePtr[nTiles_]);
+            rowBegin_.resize(rows_.size());
+            rowLen_.resize(rows_.size());
+            for (Ordinal i = lb; i < ub; ++i)
+            {
+                for (Offset k = a.row_ptr(i), e; k < a.row_ptr(i + 1); k = e)
+                {
+                    e = tile_end(k, a.row_ptr(i + 1));
+                    const Offset dst = first + tilePtr[a.col_ind(k) / tileWidth_]++;
+                    rows_[dst] = i;
+                    rowBegin_[dst] = k;
+                    rowLen_[dst] = Ordinal(e - k);
+                }
+            }
+            panelWork_.push_back(panelWork_.back() + (a.row_ptr(ub) - a.row_ptr(lb)) + Offset(ub - lb));
+        }
+    }
+
+    const csr_type &csr() const { return a_; }
+    Ordinal num_rows() const { return a_.num_rows(); }
+    Ordinal num_cols() const { return a_.num_cols(); }
+    Offset nnz() const { return a_.nnz(); }
+    Ordinal tile_width() const { return tileWidth_; }
+    Ordinal panel_height() const { return panelHeight_; }
+    Ordinal num_tiles() const { return nTiles_; }
+    Ordinal num_panels() const { return nPanels_; }
+    // nonempty rows summed over every block, each stored as a row, an offset, and a length
+    Offset num_block_rows() const { return Offset(rows_.size()); }
+
+    const std::vector<Offset> &block_row() const { return blockRow_; }
+    const std::vector<Ordinal> &rows() const { return rows_; }
+    const std::vector<Offset> &row_begin() const { return rowBegin_; }
+    const std::vector<Ordinal> &row_len() const { return rowLen_; }
+    const std::vector<Offset> &panel_work() const { return panelWork_; }
+};
+
+/* k row blocks with about the same work each, falling on panel boundaries
+ */
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+std::vector<Ordinal> balanced_row_blocks(const BlockedCSR<Ordinal, Scalar, Offset, Alloc> &a, int k)
+{
+    std::vector<Ordinal> bounds = balanced_row_blocks<Ordinal>(a.panel_work(), k);
+    for (Ordinal &b : bounds)
+    {
+        b = Ordinal(std::min(int64_t(a.num_rows()), int64_t(b) * a.panel_height()));
+    }
+    return bounds;
+}
+
+/* y = A x, one thread per row block [bounds[t], bounds[t+1]), which fall on panel boundaries
+ */
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc, typename YVec, typename XVec>
+void spmv(YVec &y, const BlockedCSR<Ordinal, Scalar, Offset, Alloc> &a, const XVec &x, const std::vector<Ordinal> &bounds)
+{
+    if (bounds.size() < 2 || bounds.front() != 0 || bounds.back() != a.num_rows())
+    {
+        throw std::logic_error("spmv: bounds must cover every row");
+    }
+    for (const Ordinal &b : bounds)
+    {
+        if (b % a.panel_height() && b != a.num_rows())
+        {
+            throw std::logic_error("spmv: bounds must fall on panel boundaries, see balanced_row_blocks");
+        }
+    }
+    const Offset *blockRow = a.block_row().data();
+    const Ordinal *rows = a.rows().data();
+    const Offset *rowBegin = a.row_begin().data();
+    const Ordinal *rowLen = a.row_len().data();
+    const Ordinal *colInd = a.csr().col_ind().data();
+    const Scalar *val = a.csr().val().data();
+    const Ordinal h = a.panel_height(), nTiles = a.num_tiles();
+    typedef typename std::decay<decltype(val[0] * x[0])>::type acc_t;
+    parallel_run(int(bounds.size() - 1), [&](int t)
+                 {
+        for (Ordinal i = bounds[t]; i < bounds[t + 1]; ++i) {
+            y[i] = 0;
+        }
+        for (Ordinal lb = bounds[t]; lb < bounds[t + 1]; lb += h) {
+            const Ordinal p = lb / h;
+            for (Offset b = Offset(p) * nTiles; b < Offset(p + 1) * nTiles; ++b) {
+                for (Offset r = blockRow[b]; r < blockRow[b + 1]; ++r) {
+                    acc_t acc = 0;
+                    for (Offset k = rowBegin[r], e = k + rowLen[r]; k < e; ++k) {
+                        acc += val[k] * x[colInd[k]];
+                    }
+                    y[rows[r]] += acc;
+                }
+            }
+        } });
+}
+
+/* y = A x, with rows split by balanced_row_blocks(a, num_threads())
+ */
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc, typename YVec, typename XVec>
+void spmv(YVec &y, const BlockedCSR<Ordinal, Scalar, Offset, Alloc> &a, const XVec &x)
+{
+    spmv(y, a, x, balanced_row_blocks(a, num_threads()));
+}
@@ -0,0 +1,233 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#pragma once
+
+#include "mm/mm.hpp"
+#include "mm/parallel.hpp"
+#include "mm/partition.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/* CSR with narrow column indices.
+
+   Each row has a base column, and each entry whose column lies in the Delta-sized window
+   above it stores only its offset from the base, so with the default 16-bit Delta the column
+   indices take 2 bytes instead of sizeof(Ordinal). A row costs one base column more than in CSR.
+   The window is placed to cover as many of the row's entries as it can; the rest are "far"
+   entries, kept apart with their full row and column, which sorted rows only have if they
+   span more than 65535 columns.
+
+   SpMV of a row is then one flat loop over contiguous offsets and values: a zero-extending
+   load added to the base, folded into the x gather, with four partial sums the compiler can
+   keep in vector lanes. Far entries are added afterwards.
+*/
+template <typename Ordinal, typename Scalar, typename Offset = size_t, typename Delta = uint16_t,
+          typename Alloc = std::allocator<char>>
+class CompressedCSR
+{
+public:
+    typedef CSR<Ordinal, Scalar, Offset, Alloc> csr_type;
+
+private:
+    alloc_vector<Offset, Alloc> rowPtr_;   // windowed entries of row i are [rowPtr_[i], rowPtr_[i+1])
+    alloc_vector<Ordinal, Alloc> base_;    // base column of each row
+    alloc_vector<Delta, Alloc> delta_;     // column - base of each windowed entry
+    alloc_vector<Scalar, Alloc> val_;
+    alloc_vector<Ordinal, Alloc> farRow_;  // far entries, sorted by row
+    alloc_vector<Ordinal, Alloc> farCol_;
+    alloc_vector<Scalar, Alloc> farVal_;
+    Ordinal ncols_;
+
+public:
+    static constexpr uint64_t MAX_DELTA = std::numeric_limits<Delta>::max();
+
+    CompressedCSR() : rowPtr_(1, 0), ncols_(0) {}
+
+    /* a with sorted rows, or the windows may be placed badly
+     */
+    template <typename SrcAlloc>
+    explicit CompressedCSR(const CSR<Ordinal, Scalar, Offset, SrcAlloc> &a, const Alloc &alloc = Alloc())
+        : rowPtr_(alloc), base_(alloc), delta_(alloc), val_(alloc), farRow_(alloc), farCol_(alloc), farVal_(alloc),
+          ncols_(a.num_cols())
+    {
+        if (a.symmetry() != Info::Symmetry::GENERAL)
+        {
+            throw std::logic_error("CompressedCSR: needs general storage, see expand()");
+        }
+        rowPtr_.reserve(a.num_rows() + 1);
+        base_.reserve(a.num_rows());
+        delta_.reserve(a.nnz());
+        val_.reserve(a.nnz());
+
+        rowPtr_.push_back(0);
+        for (Ordinal i = 0; i < a.num_rows(); ++i)
+        {
+            const Offset rb = a.row_ptr(i), re = a.row_ptr(i + 1);
+            // the window [j, j + MAX_DELTA] starting at an entry that covers the most entries
+            Ordinal base = rb < re ? a.col_ind(rb) : 0;
+            Offset best = 0;
+            for (Offset lo = rb, hi = rb; lo < re && best < re - lo; ++lo)
+            {
+                while (hi < re && a.col_ind(hi) >= a.col_ind(lo) && uint64_t(a.col_ind(hi) - a.col_ind(lo)) <= MAX_DELTA)
+                {
+                    ++hi;
+                }
+                if (hi - lo > best)
+                {
+                    best = hi - lo;
+                    base = a.col_ind(lo);
+                }
+            }
+            base_.push_back(base);
+            for (Offset k = rb; k < re; ++k)
+            {
+                const Ordinal j = a.col_ind(k);
+                if (j >= base && uint64_t(j - base) <= MAX_DELTA)
+                {
+                    delta_.push_back(Delta(j - base));
+                    val_.push_back(a.val(k));
+                }
+                else
+                {
+                    farRow_.push_back(i);
+                    farCol_.push_back(j);
+                    farVal_.push_back(a.val(k));
+                }
+            }
+            rowPtr_.push_back(Offset(delta_.size()));
+        }
+    }
+
+    Offset nnz() const { return Offset(val_.size() + farVal_.size()); }
+    Ordinal num_rows() const { return Ordinal(rowPtr_.size() - 1); }
+    Ordinal num_cols() const { return ncols_; }
+    // entries outside their row's window
+    Offset num_far() const { return Offset(farVal_.size()); }
+
+    const alloc_vector<Offset, Alloc> &window_ptr() const { return rowPtr_; }
+    const alloc_vector<Ordinal, Alloc> &base() const { return base_; }
+    const alloc_vector<Delta, Alloc> &delta() const { return delta_; }
+    const alloc_vector<Scalar, Alloc> &val() const { return val_; }
+    const alloc_vector<Ordinal, Alloc> &far_row() const { return farRow_; }
+    const alloc_vector<Ordinal, Alloc> &far_col() const { return farCol_; }
+    const alloc_vector<Scalar, Alloc> &far_val() const { return farVal_; }
+
+    // bytes of everything but the windowed values, to compare with the row pointers and column indices of a CSR
+    uint64_t index_bytes() const
+    {
+        return rowPtr_.size() * sizeof(Offset) + base_.size() * sizeof(Ordinal) + delta_.size() * sizeof(Delta) +
+               farVal_.size() * (2 * sizeof(Ordinal) + sizeof(Scalar));
+    }
+
+    // the row pointers of the equivalent CSR
+    std::vector<Offset> row_ptr() const
+    {
+        std::vector<Offset> rowPtr(rowPtr_.begin(), rowPtr_.end());
+        Offset f = 0;
+        for (Ordinal i = 0; i < num_rows(); ++i)
+        {
+            while (f < num_far() && farRow_[f] == i)
+            {
+                ++f;
+            }
+            rowPtr[i + 1] += f;
+        }
+        return rowPtr;
+    }
+
+    // the equivalent CSR, with each row's windowed and far entries merged in column order
+    csr_type to_csr() const
+    {
+        const Alloc alloc(val_.get_allocator());
+        const std::vector<Offset> rp = row_ptr();
+        typename csr_type::row_ptr_type rowPtr(rp.begin(), rp.end(), alloc);
+        typename csr_type::col_ind_type colInd(alloc);
+        typename csr_type::val_type val(alloc);
+        colInd.reserve(nnz());
+        val.reserve(nnz());
+        Offset f = 0;
+        for (Ordinal i = 0; i < num_rows(); ++i)
+        {
+            Offset k = rowPtr_[i];
+            while (k < rowPtr_[i + 1] || (f < num_far() && farRow_[f] == i))
+            {
+                if (k < rowPtr_[i + 1] && !(f < num_far() && farRow_[f] == i && farCol_[f] < base_[i] + Ordinal(delta_[k])))
+                {
+                    colInd.push_back(base_[i] + Ordinal(delta_[k]));
+                    val.push_back(val_[k++]);
+                }
+                else
+                {
+                    colInd.push_back(farCol_[f]);
+                    val.push_back(farVal_[f++]);
+                }
+            }
+        }
+        return csr_type(ncols_, std::move(rowPtr), std::move(colInd), std::move(val));
+    }
+};
+
+template <typename Ordinal, typename Scalar, typename Offset, typename Delta, typename Alloc>
+std::vector<Ordinal> balanced_row_blocks(const CompressedCSR<Ordinal, Scalar, Offset, Delta, Alloc> &a, int k)
+{
+    return balanced_row_blocks<Ordinal>(a.row_ptr(), k);
+}
+
+/* y = A x, one thread per row block [bounds[t], bounds[t+1])
+ */
+template <typename Ordinal, typename Scalar, typename Offset, typename Delta, typename Alloc, typename YVec, typename XVec>
+void spmv(YVec &y, const CompressedCSR<Ordinal, Scalar, Offset, Delta, Alloc> &a, const XVec &x, const std::vector<Ordinal> &bounds)
+{
+    if (bounds.size() < 2 || bounds.front() != 0 || bounds.back() != a.num_rows())
+    {
+        throw std::logic_error("spmv: bounds must cover every row");
+    }
+    const Offset *rowPtr = a.window_ptr().data();
+    const Ordinal *base = a.base().data();
+    const Delta *delta = a.delta().data();
+    const Scalar *val = a.val().data();
+    const Ordinal *farRow = a.far_row().data();
+    const Ordinal *farCol = a.far_col().data();
+    const Scalar *farVal = a.far_val().data();
+    // accumulate in the type of val * x, so narrow values times a double x are summed in double
+    typedef typename std::decay<decltype(val[0] * x[0])>::type acc_t;
+    parallel_run(int(bounds.size() - 1), [&](int t)
+                 {
+        for (Ordinal i = bounds[t]; i < bounds[t + 1]; ++i) {
+            acc_t acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+            Offset k = rowPtr[i];
+            const Offset kEnd = rowPtr[i + 1];
+            if (k < kEnd) {
+                const auto *xb = &x[0] + base[i];
+                for (; k + 4 <= kEnd; k += 4) {
+                    acc0 += val[k] * xb[delta[k]];
+                    acc1 += val[k + 1] * xb[delta[k + 1]];
+                    acc2 += val[k + 2] * xb[delta[k + 2]];
+                    acc3 += val[k + 3] * xb[delta[k + 3]];
+                }
+                for (; k < kEnd; ++k) {
+                    acc0 += val[k] * xb[delta[k]];
+                }
+            }
+            y[i] = (acc0 + acc1) + (acc2 + acc3);
+        }
+        const Ordinal *fb = std::lower_bound(farRow, farRow + a.num_far(), bounds[t]);
+        const Ordinal *fe = std::lower_bound(fb, farRow + a.num_far(), bounds[t + 1]);
+        for (Offset f = Offset(fb - farRow); f < Offset(fe - farRow); ++f) {
+            y[farRow[f]] += farVal[f] * x[farCol[f]];
+        } });
+}
+
+/* y = A x, with rows split by balanced_row_blocks(a, num_threads())
+ */
+template <typename Ordinal, typename Scalar, typename Offset, typename Delta, typename Alloc, typename YVec, typename XVec>
+void spmv(YVec &y, const CompressedCSR<Ordinal, Scalar, Offset, Delta, Alloc> &a, const XVec &x)
+{
+    spmv(y, a, x, balanced_row_blocks(a, num_threads()));
+}
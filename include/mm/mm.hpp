@@ -12,6 +12,24 @@
 #include <stdexcept>
 #include <complex>
 #include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+
+/* define MM_INSTRUMENT to 1 to collect LoadStats in MtxReader and CSR.
+   Otherwise the instrumentation compiles away and LoadStats stays zeroed.
+*/
+#ifndef MM_INSTRUMENT
+#define MM_INSTRUMENT 0
+#endif
+
+#if MM_INSTRUMENT
+#include <chrono>
+#endif
 
 struct Info
 {
@@ -61,16 +79,141 @@ struct Info
     }
 };
 
-template <typename Ordinal, typename Scalar, typename Offset = size_t>
+/* Where the time and memory of a load went.
+
+   The read_s of entry lines is split into io_s, parse_s, and emit_s by timing one line in SAMPLE,
+   so those three are estimates that sum to read_s.
+*/
+struct LoadStats
+{
+    static constexpr uint64_t SAMPLE = 16;
+
+    double banner_s; // reading the banner and size line
+    double read_s;   // reading entry lines
+    double io_s;     // ... waiting on the file
+    double parse_s;  // ... tokenizing and converting values
+    double emit_s;   // ... handing entries to the consumer (storing, expanding symmetric entries)
+    uint64_t bytes;    // bytes of entry lines consumed
+    uint64_t lines;    // entry lines consumed, including comments and explicit zeros
+    uint64_t entries;  // entries emitted, including mirrored entries
+    uint64_t mirrored; // entries emitted by expanding symmetric, skew-symmetric, or hermitian storage
+    uint64_t reallocs;   // times the entry storage grew
+    uint64_t peak_bytes; // largest entry storage capacity, in bytes
+
+    double csr_copy_s; // copying the COO entries in CSR construction
+    double csr_sort_s; // sorting them
+    double csr_fill_s; // filling the CSR arrays
+    uint64_t csr_peak_bytes; // CSR arrays plus the sorted copy, in bytes
+
+    LoadStats() : banner_s(0), read_s(0), io_s(0), parse_s(0), emit_s(0), bytes(0), lines(0), entries(0), mirrored(0),
+                  reallocs(0), peak_bytes(0), csr_copy_s(0), csr_sort_s(0), csr_fill_s(0), csr_peak_bytes(0) {}
+
+    // wall-clock seconds for instrumentation
+    static double now()
+    {
+#if MM_INSTRUMENT
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+        return 0;
+#endif
+    }
+
+    // fold in statistics from another range of the same file
+    LoadStats &operator+=(const LoadStats &rhs)
+    {
+        banner_s += rhs.banner_s;
+        read_s += rhs.read_s;
+        io_s += rhs.io_s;
+        parse_s += rhs.parse_s;
+        emit_s += rhs.emit_s;
+        bytes += rhs.bytes;
+        lines += rhs.lines;
+        entries += rhs.entries;
+        mirrored += rhs.mirrored;
+        reallocs += rhs.reallocs;
+        peak_bytes = std::max(peak_bytes, rhs.peak_bytes);
+        csr_copy_s += rhs.csr_copy_s;
+        csr_sort_s += rhs.csr_sort_s;
+        csr_fill_s += rhs.csr_fill_s;
+        csr_peak_bytes = std::max(csr_peak_bytes, rhs.csr_peak_bytes);
+        return *this;
+    }
+};
+
+/* Error from converting parsed values to a narrower Scalar.
+   The error of a complex value stored as a real one is measured against its magnitude,
+   since that is what from_complex stores.
+*/
+struct ConversionError
+{
+    double max_rel;   // largest |stored - parsed| / |parsed|, inf if a value overflowed
+    uint64_t inexact; // values that changed
+    uint64_t values;  // values converted
+
+    ConversionError() : max_rel(0), inexact(0), values(0) {}
+
+    template <typename Exact, typename S>
+    void add(const Exact &exact, const S &stored)
+    {
+        ++values;
+        const double err = error(exact, stored);
+        if (err != 0)
+        {
+            ++inexact;
+            const double rel = err / std::abs(exact);
+            if (!(rel <= max_rel)) // NaN counts as the worst
+            {
+                max_rel = rel;
+            }
+        }
+    }
+
+    ConversionError &operator+=(const ConversionError &rhs)
+    {
+        max_rel = (rhs.max_rel <= max_rel) ? max_rel : rhs.max_rel;
+        inexact += rhs.inexact;
+        values += rhs.values;
+        return *this;
+    }
+
+private:
+    template <typename S>
+    static double error(double exact, const S &stored) { return std::abs(double(stored) - exact); }
+    template <typename T>
+    static double error(double exact, const std::complex<T> &stored) { return std::abs(std::complex<double>(stored) - exact); }
+    template <typename S>
+    static double error(std::complex<double> exact, const S &stored) { return std::abs(double(stored) - std::abs(exact)); }
+    template <typename T>
+    static double error(std::complex<double> exact, const std::complex<T> &stored) { return std::abs(std::complex<double>(stored) - exact); }
+};
+
+/* a std::vector of T whose allocator is Alloc rebound to T,
+   so a single allocator type can back every array of a container
+*/
+template <typename T, typename Alloc>
+using alloc_vector = std::vector<T, typename std::allocator_traits<Alloc>::template rebind_alloc<T>>;
+
+/* Alloc provides the memory for `entries`, see mm/alloc.hpp
+
+   symmetry() is GENERAL unless only one triangle of a symmetric, skew-symmetric, or hermitian
+   matrix is stored (MtxReader::set_expand_symmetry(false)). Then each off-diagonal entry (i,j,v)
+   also stands for (j,i,v), (j,i,-v), or (j,i,conj(v)).
+ */
+template <typename Ordinal, typename Scalar, typename Offset = size_t, typename Alloc = std::allocator<char>>
 class COO
 {
 private:
     Ordinal nrows_;
     Ordinal ncols_;
+    Info::Symmetry symmetry_;
 
 public:
-    COO() : nrows_(0), ncols_(0) {}
-    COO(Ordinal nrows, Ordinal ncols) : nrows_(nrows), ncols_(ncols) {}
+    typedef Alloc allocator_type;
+
+    COO() : nrows_(0), ncols_(0), symmetry_(Info::Symmetry::GENERAL) {}
+    explicit COO(const Alloc &alloc) : nrows_(0), ncols_(0), symmetry_(Info::Symmetry::GENERAL), entries(alloc) {}
+    COO(Ordinal nrows, Ordinal ncols, const Alloc &alloc = Alloc())
+        : nrows_(nrows), ncols_(ncols), symmetry_(Info::Symmetry::GENERAL), entries(alloc) {}
 
     struct Entry
     {
@@ -108,33 +251,82 @@ public:
     };
     typedef Entry entry_type;
 
-    std::vector<entry_type> entries;
+    alloc_vector<entry_type, Alloc> entries;
 
     Offset nnz() const { return Offset(entries.size()); }
     Ordinal num_rows() const { return nrows_; }
     Ordinal num_cols() const { return ncols_; }
+    Info::Symmetry symmetry() const { return symmetry_; }
+    void set_symmetry(Info::Symmetry symmetry) { symmetry_ = symmetry; }
+    allocator_type get_allocator() const { return allocator_type(entries.get_allocator()); }
 };
 
-template <typename Ordinal, typename Scalar, typename Offset = size_t>
+/* Alloc provides the memory for the three arrays, see mm/alloc.hpp
+
+   symmetry() is carried over from the COO, and means the same thing.
+   Routines that only read the arrays see the stored triangle; use expand() for both.
+ */
+template <typename Ordinal, typename Scalar, typename Offset = size_t, typename Alloc = std::allocator<char>>
 class CSR
 {
+public:
+    typedef Alloc allocator_type;
+    typedef alloc_vector<Offset, Alloc> row_ptr_type;
+    typedef alloc_vector<Ordinal, Alloc> col_ind_type;
+    typedef alloc_vector<Scalar, Alloc> val_type;
+
 private:
-    std::vector<Offset> rowPtr_;
-    std::vector<Ordinal> colInd_;
-    std::vector<Scalar> val_;
+    row_ptr_type rowPtr_;
+    col_ind_type colInd_;
+    val_type val_;
     Ordinal ncols_;
+    Info::Symmetry symmetry_;
 public:
 
-    CSR(const COO<Ordinal, Scalar, Offset> &coo) : ncols_(coo.num_cols()) {
-        typedef COO<Ordinal, Scalar, Offset> coo_t;
-        typedef typename coo_t::entry_type entry_t;
+    CSR() : rowPtr_(1, 0), ncols_(0), symmetry_(Info::Symmetry::GENERAL) {}
+    explicit CSR(const Alloc &alloc) : rowPtr_(1, 0, alloc), colInd_(alloc), val_(alloc), ncols_(0), symmetry_(Info::Symmetry::GENERAL) {}
 
-        // sort by rows, then cols within row
-        coo_t sorted(coo);
-        std::sort(sorted.entries.begin(), sorted.entries.end(), entry_t::by_ij);
+    /* take ownership of existing CSR arrays.
+       rowPtr has num_rows()+1 entries, and columns should be sorted within each row
+    */
+    CSR(Ordinal ncols, row_ptr_type rowPtr, col_ind_type colInd, val_type val)
+        : rowPtr_(std::move(rowPtr)), colInd_(std::move(colInd)), val_(std::move(val)), ncols_(ncols), symmetry_(Info::Symmetry::GENERAL) {
+        if (rowPtr_.empty() || rowPtr_.back() != Offset(colInd_.size()) || colInd_.size() != val_.size()) {
+            throw std::logic_error("CSR: inconsistent row_ptr, col_ind, and val");
+        }
+    }
 
+    /* if MM_INSTRUMENT, construction time and memory are added to *stats.
+       The arrays use the allocator of coo
+     */
+    CSR(const COO<Ordinal, Scalar, Offset, Alloc> &coo, LoadStats *stats = nullptr)
+        : CSR(coo, coo.get_allocator(), stats) {}
 
-        for (const entry_t &e : sorted.entries)
+    /* the arrays use alloc, whatever memory coo is in.
+       The sorted copy of the entries is temporary and uses the default allocator
+     */
+    template <typename CooAlloc>
+    CSR(const COO<Ordinal, Scalar, Offset, CooAlloc> &coo, const Alloc &alloc, LoadStats *stats = nullptr)
+        : rowPtr_(alloc), colInd_(alloc), val_(alloc), ncols_(coo.num_cols()), symmetry_(coo.symmetry()) {
+        typedef typename COO<Ordinal, Scalar, Offset, CooAlloc>::entry_type entry_t;
+
+#if MM_INSTRUMENT
+        const double t0 = LoadStats::now();
+#endif
+        // sort by rows, then cols within row
+        std::vector<entry_t> sorted(coo.entries.begin(), coo.entries.end());
+#if MM_INSTRUMENT
+        const double t1 = LoadStats::now();
+#endif
+        std::sort(sorted.begin(), sorted.end(), entry_t::by_ij);
+#if MM_INSTRUMENT
+        const double t2 = LoadStats::now();
+#endif
+
+        rowPtr_.reserve(coo.num_rows() + 1);
+        colInd_.reserve(sorted.size());
+        val_.reserve(sorted.size());
+        for (const entry_t &e : sorted)
         {
             while (Ordinal(rowPtr_.size()) <= e.i)
             {
@@ -148,7 +340,19 @@ public:
             rowPtr_.push_back(colInd_.size());
         }
 
-        
+#if MM_INSTRUMENT
+        if (stats)
+        {
+            stats->csr_copy_s += t1 - t0;
+            stats->csr_sort_s += t2 - t1;
+            stats->csr_fill_s += LoadStats::now() - t2;
+            stats->csr_peak_bytes = std::max(stats->csr_peak_bytes, uint64_t(
+                sorted.capacity() * sizeof(entry_t) + rowPtr_.capacity() * sizeof(Offset)
+                + colInd_.capacity() * sizeof(Ordinal) + val_.capacity() * sizeof(Scalar)));
+        }
+#else
+        (void)stats;
+#endif
     }
 
     Offset nnz() const { return Offset(val_.size()); }
@@ -161,6 +365,8 @@ public:
 
     }
     Ordinal num_cols() const { return ncols_; }
+    Info::Symmetry symmetry() const { return symmetry_; }
+    void set_symmetry(Info::Symmetry symmetry) { symmetry_ = symmetry; }
 
     const Offset &row_ptr(Ordinal i) const {
         if (Offset(i) >= Offset(rowPtr_.size()) || i < Ordinal(0)) {
@@ -176,13 +382,214 @@ public:
     }
 
     // underlying container
-    const std::vector<Offset> &row_ptr() const {return rowPtr_;}
-    const std::vector<Ordinal> & col_ind() const {return colInd_;}
-    const std::vector<Scalar> & val() const {return val_;}
+    const row_ptr_type &row_ptr() const {return rowPtr_;}
+    const col_ind_type & col_ind() const {return colInd_;}
+    const val_type & val() const {return val_;}
+    allocator_type get_allocator() const { return allocator_type(val_.get_allocator()); }
 
 };
 
+/* the transpose of a, with columns sorted within each row, in O(nnz + rows + cols).
+   The result uses the allocator of a
+*/
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+CSR<Ordinal, Scalar, Offset, Alloc> transpose(const CSR<Ordinal, Scalar, Offset, Alloc> &a)
+{
+    typedef CSR<Ordinal, Scalar, Offset, Alloc> csr_t;
+    const typename csr_t::row_ptr_type &rowPtr = a.row_ptr();
+    const typename csr_t::col_ind_type &colInd = a.col_ind();
+    const typename csr_t::val_type &val = a.val();
+
+    // count entries in each column, then prefix-sum into row pointers of the transpose
+    typename csr_t::row_ptr_type tRowPtr(a.num_cols() + 1, 0, rowPtr.get_allocator());
+    for (const Ordinal &j : colInd)
+    {
+        ++tRowPtr[j + 1];
+    }
+    for (Ordinal j = 0; j < a.num_cols(); ++j)
+    {
+        tRowPtr[j + 1] += tRowPtr[j];
+    }
+
+    // visiting rows in order leaves each row of the transpose sorted
+    std::vector<Offset> next(tRowPtr.begin(), tRowPtr.end() - 1);
+    typename csr_t::col_ind_type tColInd(colInd.size(), Ordinal(), colInd.get_allocator());
+    typename csr_t::val_type tVal(val.size(), Scalar(), val.get_allocator());
+    for (Ordinal i = 0; i < a.num_rows(); ++i)
+    {
+        for (Offset k = rowPtr[i]; k < rowPtr[i + 1]; ++k)
+        {
+            const Offset dst = next[colInd[k]]++;
+            tColInd[dst] = i;
+            tVal[dst] = val[k];
+        }
+    }
+    csr_t t(a.num_rows(), std::move(tRowPtr), std::move(tColInd), std::move(tVal));
+    t.set_symmetry(a.symmetry()); // the swapped triangle with the same rule is the transpose
+    return t;
+}
+
+
+
+/* the integer at p, after any spaces or tabs. Like strtoll, *end is set past it, or to p if
+   there is none
+*/
+inline int64_t parse_integer(const char *p, const char **end)
+{
+    const char *s = p;
+    while (' ' == *s || '\t' == *s)
+    {
+        ++s;
+    }
+    const bool neg = '-' == *s;
+    s += neg || '+' == *s;
+    const char *digits = s;
+    uint64_t v = 0;
+    for (; unsigned(*s - '0') < 10; ++s)
+    {
+        v = 10 * v + unsigned(*s - '0');
+    }
+    if (s == digits)
+    {
+        *end = p;
+        return 0;
+    }
+    *end = s;
+    return neg ? -int64_t(v) : int64_t(v);
+}
+
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 uint128; // __extension__ keeps -Wpedantic quiet
+
+/* (-1)^neg n 2^e rounded to the nearest double, ties to even, for n >= 2^53 or exact n, and a
+   normal result. sticky says nonzero bits below n were cut off. The sign is set in the bits,
+   since -ffast-math may fold away a negated zero
+*/
+inline double round_to_double(uint128 n, bool sticky, int e, bool neg)
+{
+    double d;
+    if (0 == n)
+    {
+        const uint64_t b = uint64_t(neg) << 63;
+        std::memcpy(&d, &b, sizeof(d));
+        return d;
+    }
+    const uint64_t hi = uint64_t(n >> 64);
+    const int bits = hi ? 128 - __builtin_clzll(hi) : 64 - __builtin_clzll(uint64_t(n));
+    uint64_t q;
+    if (bits <= 53)
+    {
+        q = uint64_t(n);
+        q <<= 53 - bits;
+        e -= 53 - bits;
+    }
+    else
+    {
+        const int shift = bits - 53;
+        q = uint64_t(n >> shift);
+        const uint128 rem = n & ((uint128(1) << shift) - 1), half = uint128(1) << (shift - 1);
+        q += rem > half || (rem == half && (sticky || (q & 1)));
+        e += shift;
+        if (q >> 53)
+        {
+            q >>= 1;
+            ++e;
+        }
+    }
+    // q is in [2^52, 2^53), its top bit is the implicit one
+    const uint64_t b = (uint64_t(neg) << 63) | (uint64_t(1023 + 52 + e) << 52) | (q & ((uint64_t(1) << 52) - 1));
+    std::memcpy(&d, &b, sizeof(d));
+    return d;
+}
+#endif
 
+/* the real number at p, after any spaces or tabs, rounded like strtod, which it falls back to
+   for what it doesn't handle itself: more than 19 significant digits, a decimal exponent
+   beyond +-27 after the digits, and anything other than [sign] digits [. digits] [e exponent]
+   followed by whitespace. *end is set like strtod's
+*/
+inline double parse_real(const char *p, const char **end)
+{
+#ifdef __SIZEOF_INT128__
+    static const uint64_t pow5[28] = {1ull, 5ull, 25ull, 125ull, 625ull, 3125ull, 15625ull, 78125ull, 390625ull,
+                                      1953125ull, 9765625ull, 48828125ull, 244140625ull, 1220703125ull, 6103515625ull,
+                                      30517578125ull, 152587890625ull, 762939453125ull, 3814697265625ull,
+                                      19073486328125ull, 95367431640625ull, 476837158203125ull, 2384185791015625ull,
+                                      11920928955078125ull, 59604644775390625ull, 298023223876953125ull,
+                                      1490116119384765625ull, 7450580596923828125ull};
+    const char *s = p;
+    while (' ' == *s || '\t' == *s)
+    {
+        ++s;
+    }
+    const bool neg = '-' == *s;
+    s += neg || '+' == *s;
+    uint64_t m = 0;
+    int nDigits = 0, e10 = 0; // significant digits in m, and the power of ten it is scaled by
+    bool any = false;
+    for (; unsigned(*s - '0') < 10; ++s, any = true)
+    {
+        if (m || '0' != *s)
+        {
+            m = 10 * m + unsigned(*s - '0');
+            ++nDigits;
+        }
+    }
+    if ('.' == *s)
+    {
+        for (++s; unsigned(*s - '0') < 10; ++s, any = true)
+        {
+            if (m || '0' != *s)
+            {
+                m = 10 * m + unsigned(*s - '0');
+                ++nDigits;
+            }
+            --e10;
+        }
+    }
+    if (any && ('e' == *s || 'E' == *s))
+    {
+        const char *x = s + 1;
+        const bool negExp = '-' == *x;
+        x += negExp || '+' == *x;
+        int exp = 0;
+        const char *expDigits = x;
+        for (; unsigned(*x - '0') < 10 && exp < 10000; ++x)
+        {
+            exp = 10 * exp + (*x - '0');
+        }
+        s = x == expDigits ? s : x; // "1e" is 1 followed by e
+        e10 += negExp ? -exp : exp;
+    }
+    const bool delimited = ' ' == *s || '\t' == *s || '\r' == *s || '\n' == *s || '\0' == *s;
+    if (any && delimited && nDigits <= 19)
+    {
+        if (0 == m)
+        {
+            *end = s;
+            return round_to_double(0, false, 0, neg);
+        }
+        if (e10 >= 0 && e10 <= 27)
+        {
+            *end = s;
+            return round_to_double(uint128(m) * pow5[e10], false, e10, neg);
+        }
+        if (e10 < 0 && e10 >= -27)
+        {
+            // m / 10^k = (m 2^s / 5^k) 2^-(s+k), with s so the quotient has 64 or 65 bits
+            const uint64_t d = pow5[-e10];
+            const int shift = 64 + (64 - __builtin_clzll(d)) - (64 - __builtin_clzll(m));
+            const uint128 num = uint128(m) << shift;
+            *end = s;
+            return round_to_double(num / d, 0 != num % d, e10 - shift, neg);
+        }
+    }
+#endif
+    char *e;
+    const double v = std::strtod(p, &e);
+    *end = e;
+    return v;
+}
 
 /* convert `pattern` matrix to Scalar S*/
 template <typename S>
@@ -212,7 +619,76 @@ std::complex<float> conj(std::complex<float> s) { return std::conj(s); }
 template <>
 std::complex<double> conj(std::complex<double> s) { return std::conj(s); }
 
-template <typename Ordinal, typename Scalar, typename Offset = size_t>
+/* A(j,i) of a symmetric, skew-symmetric, or hermitian matrix where A(i,j) = v */
+template <typename S>
+S mirror(Info::Symmetry symmetry, const S &v)
+{
+    switch (symmetry)
+    {
+    case Info::Symmetry::SKEW:
+        return S(-v);
+    case Info::Symmetry::HERMITIAN:
+        return conj(v);
+    case Info::Symmetry::unknown:
+    case Info::Symmetry::GENERAL:
+    case Info::Symmetry::SYMMETRIC:
+        break;
+    }
+    return v;
+}
+
+/* a with both triangles stored and symmetry() GENERAL, rows sorted.
+   Merges each row of a with the mirrored row of its transpose, so this is O(nnz)
+*/
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+CSR<Ordinal, Scalar, Offset, Alloc> expand(const CSR<Ordinal, Scalar, Offset, Alloc> &a)
+{
+    typedef CSR<Ordinal, Scalar, Offset, Alloc> csr_t;
+    const Info::Symmetry sym = a.symmetry();
+    if (Info::Symmetry::GENERAL == sym)
+    {
+        return a;
+    }
+    if (a.num_rows() != a.num_cols())
+    {
+        throw std::logic_error("expand: symmetric storage must be square");
+    }
+    const csr_t t = transpose(a);
+
+    typename csr_t::row_ptr_type rowPtr(a.num_rows() + 1, 0, a.row_ptr().get_allocator());
+    typename csr_t::col_ind_type colInd(a.col_ind().get_allocator());
+    typename csr_t::val_type val(a.val().get_allocator());
+    colInd.reserve(2 * a.nnz());
+    val.reserve(2 * a.nnz());
+    for (Ordinal i = 0; i < a.num_rows(); ++i)
+    {
+        Offset p = a.row_ptr()[i], pe = a.row_ptr()[i + 1];
+        Offset q = t.row_ptr()[i], qe = t.row_ptr()[i + 1];
+        while (p < pe || q < qe)
+        {
+            if (q < qe && t.col_ind(q) == i)
+            {
+                ++q; // the diagonal is stored once
+            }
+            else if (q == qe || (p < pe && a.col_ind(p) <= t.col_ind(q)))
+            {
+                colInd.push_back(a.col_ind(p));
+                val.push_back(a.val(p++));
+            }
+            else
+            {
+                colInd.push_back(t.col_ind(q));
+                val.push_back(mirror(sym, t.val(q++)));
+            }
+        }
+        rowPtr[i + 1] = Offset(colInd.size());
+    }
+    return csr_t(a.num_cols(), std::move(rowPtr), std::move(colInd), std::move(val));
+}
+
+/* Alloc provides the memory of the COO and CSR it loads, see mm/alloc.hpp
+ */
+template <typename Ordinal, typename Scalar, typename Offset = size_t, typename Alloc = std::allocator<char>>
 class MtxReader
 {
 private:
@@ -221,7 +697,7 @@ private:
     Info read_banner()
     {
         Info ret;
-        std::ifstream inf(path_);
+        std::ifstream inf(path_, std::ios::binary);
         if (!inf)
         {
             std::stringstream ss;
@@ -229,6 +705,18 @@ private:
             throw std::runtime_error(ss.str());
         }
         ret = read_banner(inf);
+
+        // remember where the entries start and the file ends, so they can be split up
+        if (inf)
+        {
+            dataBegin_ = inf.tellg();
+        }
+        std::ifstream sizef(path_, std::ios::binary | std::ios::ate);
+        dataEnd_ = sizef.tellg();
+        if (!inf)
+        {
+            dataBegin_ = dataEnd_;
+        }
         return ret;
     }
 
@@ -321,13 +809,19 @@ private:
     }
 
 public:
-    using coo_type = COO<Ordinal, Scalar, Offset>;
+    using coo_type = COO<Ordinal, Scalar, Offset, Alloc>;
     using coo_entry_type = typename coo_type::entry_type;
-    using csr_type = CSR<Ordinal, Scalar, Offset>;
+    using csr_type = CSR<Ordinal, Scalar, Offset, Alloc>;
 
-    MtxReader(const std::string &path) : path_(path)
+    MtxReader(const std::string &path) : path_(path), dataBegin_(0), dataEnd_(0), progressInterval_(0), expand_(true)
     {
+#if MM_INSTRUMENT
+        const double t0 = LoadStats::now();
+#endif
         info_ = read_banner();
+#if MM_INSTRUMENT
+        stats_.banner_s = LoadStats::now() - t0;
+#endif
     }
 
     operator bool() const
@@ -335,124 +829,408 @@ public:
         return bool(info_);
     }
 
-    coo_type read_coo()
+    const Info &info() const { return info_; }
+    const std::string &path() const { return path_; }
+
+    /* statistics of everything this reader has loaded so far.
+       All zero unless MM_INSTRUMENT.
+    */
+    const LoadStats &stats() const { return stats_; }
+
+    /* error of converting the values parsed so far to Scalar.
+       Not tracked (all zero) when Scalar is double or std::complex<double>, which hold every parsed value exactly
+    */
+    const ConversionError &conversion_error() const { return conversionError_; }
+
+    /* if MM_INSTRUMENT, call progress(stats) each time another `interval` bytes of entries are consumed.
+       stats covers the call to for_each_entry or read_coo in progress,
+       so concurrent calls on byte ranges each report their own range from their own thread.
+    */
+    void set_progress(std::function<void(const LoadStats &)> progress, uint64_t interval)
+    {
+        progress_ = progress;
+        progressInterval_ = interval;
+    }
+
+    // byte offset of the first line after the size line
+    std::streamoff data_begin() const { return dataBegin_; }
+    // size of the file in bytes
+    std::streamoff data_end() const { return dataEnd_; }
+
+    /* if expand (the default), off-diagonal entries of symmetric, skew-symmetric, and hermitian
+       matrices are followed by their mirror across the diagonal.
+       Otherwise only the stored triangle is visited, and read_coo() tags the COO with info().symmetry
+    */
+    void set_expand_symmetry(bool expand) { expand_ = expand; }
+    bool expand_symmetry() const { return expand_; }
+
+    /* call f(entry) for every entry in the file.
+       Explicit zeros are dropped, and entries of symmetric, skew-symmetric, and hermitian
+       matrices are followed by their mirror across the diagonal (see set_expand_symmetry).
+       Entries are not stored, so this works for files larger than memory.
+    */
+    template <typename F>
+    void for_each_entry(F f) const
     {
+        for_each_entry(dataBegin_, dataEnd_, f);
+    }
 
-        std::ifstream inf(path_);
+    /* call f(entry) for every entry on a line that starts in the byte range [begin, end) of the file.
+       Ranges that tile [data_begin(), data_end()) visit every entry exactly once,
+       so the file can be split among threads that each call this independently.
+    */
+    template <typename F>
+    void for_each_entry(std::streamoff begin, std::streamoff end, F f) const
+    {
+        if (info_.format == Info::Format::ARRAY)
+        {
+            throw std::logic_error("get_as_coo: array format");
+        }
+
+        std::ifstream inf(path_, std::ios::binary);
         if (!inf)
         {
             throw std::logic_error("get_as_coo: couldn't open input file");
         }
-        Info info = read_banner(inf);
 
-        if (info.format == Info::Format::ARRAY)
+        begin = std::max(begin, dataBegin_);
+        end = std::min(end, dataEnd_);
+        if (begin >= end)
         {
-            throw std::logic_error("get_as_coo: array format");
+            return;
         }
 
-        coo_type coo(info.nrows, info.ncols);
-
-        for (std::string line; std::getline(inf, line);)
+        std::streamoff pos = begin;
+        std::string line;
+        if (begin > dataBegin_)
         {
-            if ('%' == line[0])
+            // a line that straddles `begin` belongs to the previous range
+            inf.seekg(begin - 1);
+            if (inf.get() != '\n')
             {
-                continue;
+                std::getline(inf, line);
+                pos += line.size() + 1;
             }
+        }
+        else
+        {
+            inf.seekg(begin);
+        }
 
-            coo_entry_type entry;
-            std::stringstream ss;
-            ss << line;
-            ss >> entry.i;
-            ss >> entry.j;
-            if (!ss)
-            {
-                throw std::logic_error("get_as_coo: unexpected format");
-            }
+        ConversionError conv;
+        ScanState st;
+        st.err = TRACK_CONVERSION ? &conv : nullptr;
+#if MM_INSTRUMENT
+        st.tStart = LoadStats::now();
+        st.sampled[0] = st.sampled[1] = st.sampled[2] = 0;
+        st.nextProgress = progressInterval_;
+#endif
 
-            --entry.i;
-            --entry.j;
-            if (entry.i < 0 || entry.j < 0)
-            {
-                std::logic_error("row/col is too small (not 1-indexed?)");
-            }
+        // mirrored entries are only made when expanding, so otherwise every file parses as general
+        dispatch_scalar(info_.scalar, expand_ ? info_.symmetry : Info::Symmetry::GENERAL, inf, pos, end, f, st);
 
-            // pattern has all non-zeros are 1
-            switch (info.scalar)
-            {
-            case Info::Scalar::unknown:
-                throw std::logic_error("221");
-            case Info::Scalar::PATTERN:
-                entry.e = from_pattern<Scalar>();
-                break; // no more read
-            case Info::Scalar::REAL:
+#if MM_INSTRUMENT
+        LoadStats &local = st.local;
+        local.read_s = LoadStats::now() - st.tStart;
+        const double sampledTotal = st.sampled[0] + st.sampled[1] + st.sampled[2];
+        if (sampledTotal > 0)
+        {
+            local.io_s = local.read_s * st.sampled[0] / sampledTotal;
+            local.parse_s = local.read_s * st.sampled[1] / sampledTotal;
+            local.emit_s = local.read_s * st.sampled[2] / sampledTotal;
+        }
+#endif
+
+        if (TRACK_CONVERSION || MM_INSTRUMENT)
+        {
+            static std::mutex m; // ranges may be read concurrently
+            std::lock_guard<std::mutex> lock(m);
+            conversionError_ += conv;
+#if MM_INSTRUMENT
+            stats_ += local;
+#endif
+        }
+    }
+
+    coo_type read_coo(const Alloc &alloc = Alloc())
+    {
+        if (info_.format == Info::Format::ARRAY)
+        {
+            throw std::logic_error("get_as_coo: array format");
+        }
+
+        coo_type coo(info_.nrows, info_.ncols, alloc);
+        if (!expand_)
+        {
+            coo.set_symmetry(info_.symmetry);
+        }
+        if (info_.nnz > 0)
+        {
+            coo.entries.reserve(info_.nnz);
+        }
+#if MM_INSTRUMENT
+        uint64_t reallocs = 0;
+        for_each_entry([&coo, &reallocs](const coo_entry_type &e)
+                       {
+                           reallocs += coo.entries.size() == coo.entries.capacity();
+                           coo.entries.push_back(e); });
+        stats_.reallocs += reallocs;
+        stats_.peak_bytes = std::max(stats_.peak_bytes, uint64_t(coo.entries.capacity() * sizeof(coo_entry_type)));
+#else
+        for_each_entry([&coo](const coo_entry_type &e)
+                       { coo.entries.push_back(e); });
+#endif
+        return coo;
+    }
+
+private:
+    static constexpr bool TRACK_CONVERSION = !std::is_same<Scalar, double>::value && !std::is_same<Scalar, std::complex<double>>::value;
+
+    // what a scan of data lines accumulates besides its entries
+    struct ScanState
+    {
+        ConversionError *err; // null if conversions are not tracked
+#if MM_INSTRUMENT
+        LoadStats local;
+        double tStart;
+        double sampled[3]; // io of every read, then parse and emit of sampled lines times SAMPLE
+        uint64_t nextProgress;
+#endif
+    };
+
+    /* the scan of a file is instantiated for each scalar kind and symmetry, so the per-line parse
+       has no branches on them. These pick the instantiation once per call to for_each_entry
+    */
+    template <typename F>
+    void dispatch_scalar(Info::Scalar scalar, Info::Symmetry symmetry, std::ifstream &inf, std::streamoff pos, std::streamoff end,
+                         F &f, ScanState &st) const
+    {
+        switch (scalar)
+        {
+        case Info::Scalar::PATTERN:
+            return dispatch_symmetry<Info::Scalar::PATTERN>(symmetry, inf, pos, end, f, st);
+        case Info::Scalar::REAL:
+            return dispatch_symmetry<Info::Scalar::REAL>(symmetry, inf, pos, end, f, st);
+        case Info::Scalar::INTEGER:
+            return dispatch_symmetry<Info::Scalar::INTEGER>(symmetry, inf, pos, end, f, st);
+        case Info::Scalar::COMPLEX:
+            return dispatch_symmetry<Info::Scalar::COMPLEX>(symmetry, inf, pos, end, f, st);
+        case Info::Scalar::unknown:
+        default:
+            throw std::logic_error("get_as_coo: unsupported scalar type");
+        }
+    }
+
+    template <Info::Scalar K, typename F>
+    void dispatch_symmetry(Info::Symmetry symmetry, std::ifstream &inf, std::streamoff pos, std::streamoff end, F &f, ScanState &st) const
+    {
+        switch (symmetry)
+        {
+        case Info::Symmetry::GENERAL:
+            return scan_lines<K, Info::Symmetry::GENERAL>(inf, pos, end, f, st);
+        case Info::Symmetry::SYMMETRIC:
+            return scan_lines<K, Info::Symmetry::SYMMETRIC>(inf, pos, end, f, st);
+        case Info::Symmetry::SKEW:
+            return scan_lines<K, Info::Symmetry::SKEW>(inf, pos, end, f, st);
+        case Info::Symmetry::HERMITIAN:
+            return scan_lines<K, Info::Symmetry::HERMITIAN>(inf, pos, end, f, st);
+        case Info::Symmetry::unknown:
+        default:
+            throw std::logic_error("must be general, skew-symmetric or symmetric");
+        }
+    }
+
+    /* parse the lines from pos, which starts a line, to the first line that starts at or after end.
+       The file is read in blocks of up to 1 MiB, and each line is parsed where it lies in the
+       block, its newline replaced by a terminator
+     */
+    template <Info::Scalar K, Info::Symmetry S, typename F>
+    void scan_lines(std::ifstream &inf, std::streamoff pos, std::streamoff end, F &f, ScanState &st) const
+    {
+        // one more byte than is read, to terminate a last line without a newline
+        const size_t blockBytes = size_t(1) << 20;
+        std::vector<char> buf(std::min(blockBytes, size_t(end - pos) + 256) + 1);
+        size_t head = 0, tail = 0; // unparsed bytes are [head, tail)
+        std::streamoff readPos = pos; // file offset of buf[tail]
+        bool eof = false;
+        while (pos < end)
+        {
+            char *nl = static_cast<char *>(std::memchr(buf.data() + head, '\n', tail - head));
+            if (!nl && !eof)
             {
-                double re;
-                ss >> re;
-                if (0.0 == re)
-                    continue; // skip explicit 0
-                entry.e = from_real<Scalar>(re);
-                break;
+                // keep the partial line, growing the block if it is all one line, and read more
+                std::memmove(buf.data(), buf.data() + head, tail - head);
+                tail -= head;
+                head = 0;
+                if (tail + 1 == buf.size())
+                {
+                    buf.resize(2 * buf.size() - 1);
+                }
+                // past end, only enough to finish the last line
+                const size_t room = buf.size() - 1 - tail;
+                const size_t want = readPos < end ? std::min(room, size_t(end - readPos)) : std::min(room, size_t(256));
+#if MM_INSTRUMENT
+                const double t0 = LoadStats::now();
+#endif
+                inf.read(buf.data() + tail, want);
+                const size_t got = size_t(inf.gcount());
+#if MM_INSTRUMENT
+                st.sampled[0] += LoadStats::now() - t0;
+#endif
+                tail += got;
+                readPos += got;
+                eof = got < want;
+                continue;
             }
-            case Info::Scalar::INTEGER:
+            if (!nl)
             {
-                int64_t i;
-                ss >> i;
-                if (0 == i)
-                    continue; // skip explicit 0
-                entry.e = from_integer<Scalar>(i);
-                break;
+                if (head == tail)
+                {
+                    break;
+                }
+                nl = buf.data() + tail; // the last line has no newline
             }
-            case Info::Scalar::COMPLEX:
+            *nl = '\0';
+            const char *line = buf.data() + head;
+            const size_t len = size_t(nl - line);
+            head += len + 1;
+            pos += len + 1;
+#if MM_INSTRUMENT
+            LoadStats &local = st.local;
+            const bool sample = 0 == local.lines % LoadStats::SAMPLE;
+            const double t1 = sample ? LoadStats::now() : 0;
+            double t2 = 0; // parse finished
+            local.bytes += len + 1;
+            ++local.lines;
+            if (progress_ && progressInterval_ && local.bytes >= st.nextProgress)
             {
-                double real, imag;
-                ss >> real;
-                ss >> imag;
-                if (real == 0 && imag == 0)
-                    continue; // skip 0
-                entry.e = from_complex<Scalar>(std::complex<double>(real, imag));
-                break;
-            }
-            default:
-                throw std::logic_error("get_as_coo: unsupported scalar type");
+                local.read_s = LoadStats::now() - st.tStart;
+                progress_(local);
+                st.nextProgress += progressInterval_;
             }
-
-            coo.entries.push_back(entry);
-
-            // add any symmetric entries
-            switch (info.symmetry)
+#endif
+            if (0 == len || '%' == line[0])
             {
-            case Info::Symmetry::unknown:
-                throw std::logic_error("251");
-            case Info::Symmetry::GENERAL:
-                break;                      // no-op
-            case Info::Symmetry::SYMMETRIC: // fall
-            case Info::Symmetry::SKEW:
-            {
-                if (entry.i != entry.j)
-                {
-                    std::swap(entry.i, entry.j);
-                    coo.entries.push_back(entry);
-                }
-                break;
+                continue;
             }
-            case Info::Symmetry::HERMITIAN:
+#if MM_INSTRUMENT
+            int emitted = 0;
+            auto g = [&](const coo_entry_type &e)
             {
-                if (entry.i != entry.j)
+                if (0 == emitted++ && sample)
                 {
-                    std::swap(entry.i, entry.j);
-                    entry.e = conj(entry.e);
-                    coo.entries.push_back(entry);
+                    t2 = LoadStats::now();
                 }
-                break;
-            }
-            default:
-                throw std::logic_error("must be general, skew-symmetric or symmetric");
+                f(e);
+            };
+            parse_line<K, S>(line, g, st.err);
+            local.entries += emitted;
+            local.mirrored += emitted > 1;
+            if (sample)
+            {
+                // reads are timed in full, lines one in SAMPLE
+                const double t3 = LoadStats::now();
+                t2 = emitted ? t2 : t3;
+                st.sampled[1] += (t2 - t1) * LoadStats::SAMPLE;
+                st.sampled[2] += (t3 - t2) * LoadStats::SAMPLE;
             }
+#else
+            parse_line<K, S>(line, f, st.err);
+#endif
         }
+    }
 
-        return coo;
+    /* parse a data line of a K matrix and pass its entry, then its mirror if S is not GENERAL, to f.
+       If err is not null, the conversion of the parsed value to Scalar is added to it
+     */
+    template <Info::Scalar K, Info::Symmetry S, typename F>
+    static void parse_line(const char *line, F &f, ConversionError *err)
+    {
+        coo_entry_type entry;
+        const char *end;
+        const char *p = line;
+
+        entry.i = Ordinal(parse_integer(p, &end));
+        if (end == p)
+        {
+            throw std::logic_error("get_as_coo: unexpected format");
+        }
+        p = end;
+        entry.j = Ordinal(parse_integer(p, &end));
+        if (end == p)
+        {
+            throw std::logic_error("get_as_coo: unexpected format");
+        }
+        p = end;
+
+        --entry.i;
+        --entry.j;
+        if (entry.i < 0 || entry.j < 0)
+        {
+            throw std::logic_error("row/col is too small (not 1-indexed?)");
+        }
+
+        // K is a constant, so only one case is compiled into each instantiation
+        switch (K)
+        {
+        case Info::Scalar::PATTERN:
+            entry.e = from_pattern<Scalar>(); // pattern has all non-zeros are 1
+            break;                            // no more read
+        case Info::Scalar::REAL:
+        {
+            double re = parse_real(p, &end);
+            if (0.0 == re)
+                return; // skip explicit 0
+            entry.e = from_real<Scalar>(re);
+            if (TRACK_CONVERSION && err)
+                err->add(re, entry.e);
+            break;
+        }
+        case Info::Scalar::INTEGER:
+        {
+            int64_t i = parse_integer(p, &end);
+            if (0 == i)
+                return; // skip explicit 0
+            entry.e = from_integer<Scalar>(i);
+            if (TRACK_CONVERSION && err)
+                err->add(double(i), entry.e);
+            break;
+        }
+        case Info::Scalar::COMPLEX:
+        {
+            double real = parse_real(p, &end);
+            p = end;
+            double imag = parse_real(p, &end);
+            if (real == 0 && imag == 0)
+                return; // skip 0
+            entry.e = from_complex<Scalar>(std::complex<double>(real, imag));
+            if (TRACK_CONVERSION && err)
+                err->add(std::complex<double>(real, imag), entry.e);
+            break;
+        }
+        case Info::Scalar::unknown:
+        default:
+            break; // rejected by dispatch_scalar
+        }
+
+        f(entry);
+
+        // add any symmetric entry
+        if (Info::Symmetry::GENERAL != S && entry.i != entry.j)
+        {
+            std::swap(entry.i, entry.j);
+            entry.e = mirror(S, entry.e);
+            f(entry);
+        }
     }
 
-private:
     std::string path_;
+    std::streamoff dataBegin_;
+    std::streamoff dataEnd_;
+
+    mutable LoadStats stats_;
+    mutable ConversionError conversionError_;
+    std::function<void(const LoadStats &)> progress_;
+    uint64_t progressInterval_;
+    bool expand_;
 };
@@ -0,0 +1,509 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#pragma once
+
+#include "mm/mm.hpp"
+#include "mm/parallel.hpp"
+#include "mm/partition.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* CSR construction for matrices that do not fit in memory.
+
+   build_csr_files() streams the entries of a file into sorted runs of at most a memory
+   budget each, spills them to a scratch directory, and k-way merges the runs into three
+   files <prefix>.rowptr, <prefix>.colind and <prefix>.val, plus a text header <prefix>.info.
+   Row pointers are written as the merge advances through the rows, so nothing of size nnz or
+   nrows is ever held in memory. Each entry is read and written twice, and once more for each
+   intermediate pass when there are more runs than one pass merges.
+
+   MappedCSR maps those files read-only. The page cache holds whatever part of the matrix is
+   in use, so a matrix larger than memory can still be multiplied, at disk speed.
+*/
+
+/* a read-only view of n elements, usable where the CSR kernels expect a vector
+ */
+template <typename T>
+class ConstSpan
+{
+    const T *data_;
+    size_t size_;
+
+public:
+    ConstSpan() : data_(nullptr), size_(0) {}
+    ConstSpan(const T *data, size_t size) : data_(data), size_(size) {}
+    const T *data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return 0 == size_; }
+    const T &operator[](size_t i) const { return data_[i]; }
+    const T &back() const { return data_[size_ - 1]; }
+    const T *begin() const { return data_; }
+    const T *end() const { return data_ + size_; }
+};
+
+/* a file mapped read-only for the lifetime of this object
+ */
+class MappedFile
+{
+    void *addr_;
+    size_t size_;
+
+public:
+    MappedFile() : addr_(nullptr), size_(0) {}
+    explicit MappedFile(const std::string &path) : addr_(nullptr), size_(0)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::logic_error("MappedFile: couldn't open " + path);
+        }
+        struct stat st;
+        if (0 != fstat(fd, &st))
+        {
+            ::close(fd);
+            throw std::logic_error("MappedFile: couldn't stat " + path);
+        }
+        size_ = size_t(st.st_size);
+        if (size_ > 0) // zero-length mappings are an error
+        {
+            addr_ = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (MAP_FAILED == addr_)
+        {
+            addr_ = nullptr;
+            throw std::logic_error("MappedFile: couldn't map " + path);
+        }
+    }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&rhs) : addr_(rhs.addr_), size_(rhs.size_)
+    {
+        rhs.addr_ = nullptr;
+        rhs.size_ = 0;
+    }
+    MappedFile &operator=(MappedFile &&rhs)
+    {
+        std::swap(addr_, rhs.addr_);
+        std::swap(size_, rhs.size_);
+        return *this;
+    }
+    ~MappedFile()
+    {
+        if (addr_)
+        {
+            munmap(addr_, size_);
+        }
+    }
+
+    const void *data() const { return addr_; }
+    size_t size() const { return size_; }
+};
+
+/* a CSR whose arrays are the files written by build_csr_files, mapped read-only
+ */
+template <typename Ordinal, typename Scalar, typename Offset = size_t>
+class MappedCSR
+{
+    MappedFile rowPtrFile_, colIndFile_, valFile_;
+    ConstSpan<Offset> rowPtr_;
+    ConstSpan<Ordinal> colInd_;
+    ConstSpan<Scalar> val_;
+    Ordinal ncols_;
+    Info::Symmetry symmetry_;
+
+    template <typename T>
+    static ConstSpan<T> span(const MappedFile &f, const std::string &path, size_t n)
+    {
+        if (f.size() != n * sizeof(T))
+        {
+            throw std::logic_error("MappedCSR: " + path + " has " + std::to_string(f.size()) + " bytes, expected " + std::to_string(n * sizeof(T)));
+        }
+        return ConstSpan<T>(static_cast<const T *>(f.data()), n);
+    }
+
+public:
+    explicit MappedCSR(const std::string &prefix)
+    {
+        std::ifstream info(prefix + ".info");
+        int64_t nrows, ncols;
+        uint64_t nnz;
+        int symmetry;
+        size_t ordinalSize, scalarSize, offsetSize;
+        if (!(info >> nrows >> ncols >> nnz >> symmetry >> ordinalSize >> scalarSize >> offsetSize))
+        {
+            throw std::logic_error("MappedCSR: couldn't read " + prefix + ".info");
+        }
+        if (ordinalSize != sizeof(Ordinal) || scalarSize != sizeof(Scalar) || offsetSize != sizeof(Offset))
+        {
+            throw std::logic_error("MappedCSR: " + prefix + " was built with other Ordinal, Scalar, or Offset types");
+        }
+        rowPtrFile_ = MappedFile(prefix + ".rowptr");
+        colIndFile_ = MappedFile(prefix + ".colind");
+        valFile_ = MappedFile(prefix + ".val");
+        rowPtr_ = span<Offset>(rowPtrFile_, prefix + ".rowptr", size_t(nrows + 1));
+        colInd_ = span<Ordinal>(colIndFile_, prefix + ".colind", size_t(nnz));
+        val_ = span<Scalar>(valFile_, prefix + ".val", size_t(nnz));
+        ncols_ = Ordinal(ncols);
+        symmetry_ = Info::Symmetry(symmetry);
+    }
+
+    Offset nnz() const { return Offset(val_.size()); }
+    Ordinal num_rows() const { return Ordinal(rowPtr_.size() - 1); }
+    Ordinal num_cols() const { return ncols_; }
+    Info::Symmetry symmetry() const { return symmetry_; }
+
+    const ConstSpan<Offset> &row_ptr() const { return rowPtr_; }
+    const ConstSpan<Ordinal> &col_ind() const { return colInd_; }
+    const ConstSpan<Scalar> &val() const { return val_; }
+    const Offset &row_ptr(Ordinal i) const { return rowPtr_[i]; }
+    const Ordinal &col_ind(Offset k) const { return colInd_[k]; }
+    const Scalar &val(Offset k) const { return val_[k]; }
+
+    // a copy in memory, for matrices that fit
+    CSR<Ordinal, Scalar, Offset> to_csr() const
+    {
+        CSR<Ordinal, Scalar, Offset> a(ncols_, std::vector<Offset>(rowPtr_.begin(), rowPtr_.end()),
+                                       std::vector<Ordinal>(colInd_.begin(), colInd_.end()),
+                                       std::vector<Scalar>(val_.begin(), val_.end()));
+        a.set_symmetry(symmetry_);
+        return a;
+    }
+};
+
+/* writes values of T to a file through a buffer of n values. The file stream itself is
+   unbuffered, so the n values are all the memory a writer holds
+ */
+template <typename T>
+class BufferedWriter
+{
+    std::ofstream out_;
+    std::vector<T> buf_;
+
+public:
+    BufferedWriter(const std::string &path, size_t n)
+    {
+        out_.rdbuf()->pubsetbuf(nullptr, 0); // before open, or it has no effect
+        out_.open(path, std::ios::binary);
+        buf_.reserve(std::max(size_t(1), n));
+    }
+    ~BufferedWriter() { flush(); }
+
+    void put(const T &v)
+    {
+        buf_.push_back(v);
+        if (buf_.size() == buf_.capacity())
+        {
+            flush();
+        }
+    }
+    void flush()
+    {
+        out_.write(reinterpret_cast<const char *>(buf_.data()), buf_.size() * sizeof(T));
+        buf_.clear();
+    }
+    // flush, and whether every write so far succeeded
+    bool good()
+    {
+        flush();
+        return bool(out_);
+    }
+};
+
+/* k-way merge of the sorted runs at paths, in order of by_ij and then of the run, so it is
+   stable like a sort of the runs concatenated. Each run is read through an unbuffered stream
+   into its own buffer of bufEntries entries, and sink(e) is called for every entry.
+   Throws if a run can't be opened or read.
+*/
+template <typename Entry, typename Sink>
+void merge_runs(const std::vector<std::string> &paths, size_t bufEntries, Sink sink)
+{
+    struct Run
+    {
+        std::ifstream in;
+        std::vector<Entry> buf;
+        size_t pos;
+        bool refill(const std::string &path)
+        {
+            buf.resize(buf.capacity());
+            in.read(reinterpret_cast<char *>(buf.data()), buf.size() * sizeof(Entry));
+            if (in.bad())
+            {
+                throw std::logic_error("build_csr_files: couldn't read run " + path);
+            }
+            buf.resize(size_t(in.gcount()) / sizeof(Entry));
+            pos = 0;
+            return !buf.empty();
+        }
+    };
+    std::vector<Run> runs(paths.size());
+    typedef std::pair<Entry, size_t> head_t; // an entry and its run
+    auto later = [](const head_t &a, const head_t &b)
+    {
+        return Entry::by_ij(b.first, a.first) || (!Entry::by_ij(a.first, b.first) && a.second > b.second);
+    };
+    std::priority_queue<head_t, std::vector<head_t>, decltype(later)> heads(later);
+    for (size_t r = 0; r < runs.size(); ++r)
+    {
+        runs[r].in.rdbuf()->pubsetbuf(nullptr, 0);
+        runs[r].in.open(paths[r], std::ios::binary);
+        if (!runs[r].in.is_open())
+        {
+            throw std::logic_error("build_csr_files: couldn't open run " + paths[r] + " (" + std::to_string(r) + " of " +
+                                   std::to_string(runs.size()) + " runs open)");
+        }
+        runs[r].buf.reserve(bufEntries);
+        if (runs[r].refill(paths[r]))
+        {
+            heads.push(head_t(runs[r].buf[runs[r].pos++], r));
+        }
+    }
+    while (!heads.empty())
+    {
+        const head_t h = heads.top();
+        heads.pop();
+        Run &run = runs[h.second];
+        if (run.pos < run.buf.size() || run.refill(paths[h.second]))
+        {
+            heads.push(head_t(run.buf[run.pos++], h.second));
+        }
+        sink(h.first);
+    }
+}
+
+/* what build_csr_files did
+ */
+struct OutOfCoreStats
+{
+    uint64_t entries;   // entries merged into the CSR
+    uint64_t runs;      // sorted runs spilled to disk
+    uint64_t passes;    // merge passes, the last of which writes the CSR
+    uint64_t runBytes;  // bytes of all runs, including those of intermediate passes
+    uint64_t peakBytes; // largest buffer memory in use at once
+    OutOfCoreStats() : entries(0), runs(0), passes(0), runBytes(0), peakBytes(0) {}
+};
+
+/* build <prefix>.{info,rowptr,colind,val} from the entries of reader's file, in about
+   memoryBudget bytes of buffers. Runs are written to scratchDir and removed afterwards.
+   A budget of B bytes spills about nnz * sizeof(entry) / B runs. They are merged at most
+   64 at a time (fewer if the budget is too small to give each about 16 entries of buffer),
+   into intermediate runs, until one pass can write the CSR. Streams are unbuffered, so the
+   merge's buffers are all the memory it uses, and it holds at most 64 runs open.
+   Like CSR(coo), rows are sorted by column and duplicates are kept.
+*/
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+OutOfCoreStats build_csr_files(const MtxReader<Ordinal, Scalar, Offset, Alloc> &reader, const std::string &prefix,
+                               uint64_t memoryBudget, const std::string &scratchDir)
+{
+    typedef typename MtxReader<Ordinal, Scalar, Offset, Alloc>::coo_entry_type entry_t;
+    static_assert(std::is_trivially_copyable<entry_t>::value, "build_csr_files: entries are spilled as raw bytes");
+    const size_t maxFanIn = 64, minRunBuf = 16;
+    const size_t runEntries = std::max(size_t(1), size_t(memoryBudget / sizeof(entry_t)));
+    OutOfCoreStats stats;
+    std::vector<std::string> runPaths;
+    size_t longestRun = 1;
+    // every run written, removed on return or on a throw
+    struct Scratch
+    {
+        std::vector<std::string> paths;
+        ~Scratch()
+        {
+            for (const std::string &p : paths)
+            {
+                std::remove(p.c_str());
+            }
+        }
+    } scratch;
+    auto run_path = [&]()
+    {
+        scratch.paths.push_back(scratchDir + "/" + prefix.substr(prefix.find_last_of('/') + 1) + ".run" + std::to_string(scratch.paths.size()));
+        return scratch.paths.back();
+    };
+
+    // spill sorted runs
+    {
+        std::vector<entry_t> buf;
+        buf.reserve(std::min(runEntries, size_t(std::max(int64_t(1), int64_t(reader.info().nnz)))));
+        auto spill = [&]()
+        {
+            std::sort(buf.begin(), buf.end(), entry_t::by_ij);
+            const std::string path = run_path();
+            std::ofstream outf;
+            outf.rdbuf()->pubsetbuf(nullptr, 0);
+            outf.open(path, std::ios::binary);
+            outf.write(reinterpret_cast<const char *>(buf.data()), buf.size() * sizeof(entry_t));
+            if (!outf)
+            {
+                throw std::logic_error("build_csr_files: couldn't write " + path);
+            }
+            runPaths.push_back(path);
+            longestRun = std::max(longestRun, buf.size());
+            stats.runBytes += buf.size() * sizeof(entry_t);
+            stats.peakBytes = std::max(stats.peakBytes, uint64_t(buf.capacity() * sizeof(entry_t)));
+            buf.clear();
+        };
+        reader.for_each_entry([&](const entry_t &e)
+                              {
+            if (buf.size() == buf.capacity()) {
+                // symmetric files have more entries than their size line says, grow only up to the budget
+                buf.reserve(std::min(runEntries, 2 * buf.capacity()));
+            }
+            buf.push_back(e);
+            if (buf.size() == runEntries) {
+                spill();
+            } });
+        if (!buf.empty())
+        {
+            spill();
+        }
+    }
+    stats.runs = runPaths.size();
+
+    // the inputs of a pass and its output each get a buffer of runBuf entries
+    const size_t fanIn = std::max(size_t(2), std::min(maxFanIn, runEntries / minRunBuf));
+    auto run_buf = [&](size_t inputs)
+    { return std::max(size_t(1), std::min(longestRun, runEntries / (inputs + 1))); };
+
+    // intermediate passes merge groups of fanIn consecutive runs, which keeps the merge stable
+    while (runPaths.size() > fanIn)
+    {
+        const size_t runBuf = run_buf(fanIn);
+        std::vector<std::string> merged;
+        size_t longest = 1;
+        for (size_t first = 0; first < runPaths.size(); first += fanIn)
+        {
+            const std::vector<std::string> group(runPaths.begin() + first,
+                                                 runPaths.begin() + std::min(runPaths.size(), first + fanIn));
+            const std::string path = run_path();
+            size_t n = 0;
+            {
+                BufferedWriter<entry_t> out(path, runBuf);
+                merge_runs<entry_t>(group, runBuf, [&](const entry_t &e)
+                                    {
+                    out.put(e);
+                    ++n; });
+                if (!out.good())
+                {
+                    throw std::logic_error("build_csr_files: couldn't write " + path);
+                }
+            }
+            for (const std::string &p : group)
+            {
+                std::remove(p.c_str());
+            }
+            merged.push_back(path);
+            longest = std::max(longest, n);
+            stats.runBytes += n * sizeof(entry_t);
+            stats.peakBytes = std::max(stats.peakBytes, uint64_t((group.size() + 1) * runBuf * sizeof(entry_t)));
+        }
+        runPaths.swap(merged);
+        longestRun = longest;
+        ++stats.passes;
+    }
+
+    // the last pass writes the CSR, its output buffers take the share of one more run
+    const size_t runBuf = run_buf(runPaths.size());
+    stats.peakBytes = std::max(stats.peakBytes, uint64_t((runPaths.size() + 1) * runBuf * sizeof(entry_t)));
+    BufferedWriter<Offset> rowPtrOut(prefix + ".rowptr", runBuf * sizeof(entry_t) / 3 / sizeof(Offset));
+    BufferedWriter<Ordinal> colIndOut(prefix + ".colind", runBuf * sizeof(entry_t) / 3 / sizeof(Ordinal));
+    BufferedWriter<Scalar> valOut(prefix + ".val", runBuf * sizeof(entry_t) / 3 / sizeof(Scalar));
+    const Ordinal nrows = Ordinal(reader.info().nrows);
+    Ordinal row = 0; // row pointers [0, row] have been written
+    Offset nnz = 0;
+    rowPtrOut.put(nnz);
+    merge_runs<entry_t>(runPaths, runBuf, [&](const entry_t &e)
+                        {
+        for (; row < e.i; ++row) {
+            rowPtrOut.put(nnz);
+        }
+        colIndOut.put(e.j);
+        valOut.put(e.e);
+        ++nnz; });
+    ++stats.passes;
+    for (; row < nrows; ++row)
+    {
+        rowPtrOut.put(nnz);
+    }
+    if (!rowPtrOut.good() || !colIndOut.good() || !valOut.good())
+    {
+        throw std::logic_error("build_csr_files: couldn't write " + prefix);
+    }
+    stats.entries = uint64_t(nnz);
+
+    std::ofstream info(prefix + ".info");
+    const Info::Symmetry symmetry = reader.expand_symmetry() ? Info::Symmetry::GENERAL : reader.info().symmetry;
+    info << reader.info().nrows << " " << reader.info().ncols << " " << uint64_t(nnz) << " " << int(symmetry) << " "
+         << sizeof(Ordinal) << " " << sizeof(Scalar) << " " << sizeof(Offset) << "\n";
+    if (!info)
+    {
+        throw std::logic_error("build_csr_files: couldn't write " + prefix + ".info");
+    }
+    return stats;
+}
+
+/* remove the files of build_csr_files
+ */
+inline void remove_csr_files(const std::string &prefix)
+{
+    for (const char *ext : {".info", ".rowptr", ".colind", ".val"})
+    {
+        std::remove((prefix + ext).c_str());
+    }
+}
+
+template <typename Ordinal, typename Scalar, typename Offset>
+std::vector<Ordinal> balanced_row_blocks(const MappedCSR<Ordinal, Scalar, Offset> &a, int k)
+{
+    return balanced_row_blocks<Ordinal>(a.row_ptr(), k);
+}
+
+/* y = A x, one thread per row block [bounds[t], bounds[t+1])
+ */
+template <typename Ordinal, typename Scalar, typename Offset, typename YVec, typename XVec>
+void spmv(YVec &y, const MappedCSR<Ordinal, Scalar, Offset> &a, const XVec &x, const std::vector<Ordinal> &bounds)
+{
+    if (bounds.size() < 2 || bounds.front() != 0 || bounds.back() != a.num_rows())
+    {
+        throw std::logic_error("spmv: bounds must cover every row");
+    }
+    if (a.symmetry() != Info::Symmetry::GENERAL)
+    {
+        throw std::logic_error("spmv: mapped symmetric storage is not supported, build with set_expand_symmetry(true)");
+    }
+    const Offset *rowPtr = a.row_ptr().data();
+    const Ordinal *colInd = a.col_ind().data();
+    const Scalar *val = a.val().data();
+    typedef typename std::decay<decltype(val[0] * x[0])>::type acc_t;
+    parallel_run(int(bounds.size() - 1), [&](int t)
+                 {
+        for (Ordinal i = bounds[t]; i < bounds[t + 1]; ++i) {
+            acc_t acc = 0;
+            for (Offset k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+                acc += val[k] * x[colInd[k]];
+            }
+            y[i] = acc;
+        } });
+}
+
+/* y = A x, with rows split by balanced_row_blocks(a, num_threads())
+ */
+template <typename Ordinal, typename Scalar, typename Offset, typename YVec, typename XVec>
+void spmv(YVec &y, const MappedCSR<Ordinal, Scalar, Offset> &a, const XVec &x)
+{
+    spmv(y, a, x, balanced_row_blocks(a, num_threads()));
+}
@@ -0,0 +1,151 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Number of threads used by multithreaded routines.
+   Defaults to the MM_NUM_THREADS environment variable, or else the number of hardware threads.
+*/
+inline int &num_threads_storage()
+{
+    static int n = []()
+    {
+        const char *env = std::getenv("MM_NUM_THREADS");
+        if (env && std::atoi(env) > 0)
+        {
+            return std::atoi(env);
+        }
+        return int(std::max(1u, std::thread::hardware_concurrency()));
+    }();
+    return n;
+}
+
+inline int num_threads() { return num_threads_storage(); }
+inline void set_num_threads(int n) { num_threads_storage() = std::max(1, n); }
+
+/* call f(t) from each of nThreads threads, t = 0...nThreads-1.
+   f(0) runs on the calling thread.
+   If any call throws, the first exception is rethrown after all threads finish.
+*/
+template <typename F>
+void parallel_run(const int nThreads, F f)
+{
+    std::vector<std::exception_ptr> errors(nThreads);
+    std::vector<std::thread> threads;
+    for (int t = 1; t < nThreads; ++t)
+    {
+        threads.push_back(std::thread([&f, &errors, t]()
+                                      {
+                                          try
+                                          {
+                                              f(t);
+                                          }
+                                          catch (...)
+                                          {
+                                              errors[t] = std::current_exception();
+                                          } }));
+    }
+    try
+    {
+        f(0);
+    }
+    catch (...)
+    {
+        errors[0] = std::current_exception();
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    for (const std::exception_ptr &error : errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+/* split [begin, end) into nThreads contiguous pieces, and call f(t, lb, ub) for each piece
+ */
+template <typename Index, typename F>
+void parallel_for(const Index begin, const Index end, F f, const int nThreads = num_threads())
+{
+    const Index n = end > begin ? end - begin : Index(0);
+    const int nt = int(std::max(Index(1), std::min(Index(nThreads), n)));
+    parallel_run(nt, [&](int t)
+                 { f(t, begin + Index(int64_t(n) * t / nt), begin + Index(int64_t(n) * (t + 1) / nt)); });
+}
+
+/* a reusable barrier for a fixed number of threads
+ */
+class Barrier
+{
+    std::mutex m_;
+    std::condition_variable cv_;
+    const int n_;
+    int waiting_;
+    uint64_t generation_;
+
+public:
+    explicit Barrier(int n) : n_(n), waiting_(0), generation_(0) {}
+
+    // block until all n threads have called wait()
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(m_);
+        const uint64_t gen = generation_;
+        if (++waiting_ == n_)
+        {
+            waiting_ = 0;
+            ++generation_;
+            cv_.notify_all();
+        }
+        else
+        {
+            cv_.wait(lock, [this, gen]()
+                     { return gen != generation_; });
+        }
+    }
+};
+
+/* a reusable barrier that spins instead of sleeping, for phases too short to be worth a
+   system call. Yields while it waits, so it still makes progress with more threads than cores
+*/
+class SpinBarrier
+{
+    const int n_;
+    std::atomic<int> waiting_;
+    std::atomic<uint64_t> generation_;
+
+public:
+    explicit SpinBarrier(int n) : n_(n), waiting_(0), generation_(0) {}
+
+    // block until all n threads have called wait()
+    void wait()
+    {
+        const uint64_t gen = generation_.load(std::memory_order_acquire);
+        if (waiting_.fetch_add(1, std::memory_order_acq_rel) + 1 == n_)
+        {
+            waiting_.store(0, std::memory_order_relaxed);
+            generation_.fetch_add(1, std::memory_order_acq_rel);
+        }
+        else
+        {
+            while (generation_.load(std::memory_order_acquire) == gen)
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+};
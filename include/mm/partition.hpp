@@ -0,0 +1,626 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#pragma once
+
+#include "mm/mm.hpp"
+#include "mm/parallel.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/* k-way row partitions of a square matrix for distributed SpMV.
+
+   Part p owns rows, and the matching entries of x and y, where part[i] == p.
+   An entry A(i,j) with part[i] != part[j] is cut: the owner of row i needs x[j] from
+   the owner of row j, so the cut and halo sizes measure communication.
+*/
+
+/* the part that owns each row
+ */
+struct Partition
+{
+    int nparts;
+    std::vector<int> part;
+
+    Partition() : nparts(0) {}
+    Partition(int _nparts, std::vector<int> _part) : nparts(_nparts), part(std::move(_part)) {}
+};
+
+/* k contiguous row blocks with about the same work (entries + rows) each,
+   from the n+1 row pointers of a CSR. Block p is rows [bounds[p], bounds[p+1])
+*/
+template <typename Ordinal, typename RowPtr>
+std::vector<Ordinal> balanced_row_blocks(const RowPtr &rowPtr, int k)
+{
+    if (k < 1 || rowPtr.empty())
+    {
+        throw std::logic_error("balanced_row_blocks: need at least one block and row pointer");
+    }
+    const Ordinal n = Ordinal(rowPtr.size() - 1);
+    const double total = double(rowPtr.back()) + double(n);
+
+    std::vector<Ordinal> bounds(k + 1, n);
+    bounds[0] = 0;
+    for (int p = 1; p < k; ++p)
+    {
+        // first row whose preceding work reaches the target
+        const double target = total * p / k;
+        Ordinal lo = bounds[p - 1], hi = n;
+        while (lo < hi)
+        {
+            const Ordinal mid = lo + (hi - lo) / 2;
+            if (double(rowPtr[mid]) + double(mid) < target)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        bounds[p] = lo;
+    }
+    return bounds;
+}
+
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+std::vector<Ordinal> balanced_row_blocks(const CSR<Ordinal, Scalar, Offset, Alloc> &a, int k)
+{
+    return balanced_row_blocks<Ordinal>(a.row_ptr(), k);
+}
+
+/* baseline: rows split into k contiguous, work-balanced blocks
+ */
+template <typename Ordinal, typename Scalar, typename Offset>
+Partition partition_contiguous(const CSR<Ordinal, Scalar, Offset> &a, int k)
+{
+    const std::vector<Ordinal> bounds = balanced_row_blocks(a, k);
+    std::vector<int> part(a.num_rows());
+    for (int p = 0; p < k; ++p)
+    {
+        std::fill(part.begin() + bounds[p], part.begin() + bounds[p + 1], p);
+    }
+    return Partition(k, std::move(part));
+}
+
+/* undirected graph with vertex and edge weights, as used by the multilevel partitioner
+ */
+template <typename Ordinal, typename Offset>
+struct PartitionGraph
+{
+    std::vector<Offset> xadj;
+    std::vector<Ordinal> adj;
+    std::vector<int64_t> adjw; // weight of each edge
+    std::vector<int64_t> vw;   // weight of each vertex
+
+    Ordinal num_vertices() const { return Ordinal(vw.size()); }
+
+    /* the pattern of A + A^T without the diagonal.
+       Vertex i weighs the entries of row i plus one, and edge {i,j} weighs the
+       number of entries A(i,j), A(j,i) it stands for
+    */
+    template <typename Scalar>
+    static PartitionGraph from_csr(const CSR<Ordinal, Scalar, Offset> &a)
+    {
+        const Ordinal n = a.num_rows();
+        const CSR<Ordinal, Scalar, Offset> at = transpose(a);
+        PartitionGraph g;
+        g.xadj.assign(n + 1, 0);
+        g.vw.resize(n);
+        g.adj.reserve(2 * a.nnz());
+        g.adjw.reserve(2 * a.nnz());
+        for (Ordinal i = 0; i < n; ++i)
+        {
+            g.vw[i] = int64_t(a.row_ptr()[i + 1] - a.row_ptr()[i]) + 1;
+            Offset p = a.row_ptr()[i], pe = a.row_ptr()[i + 1];
+            Offset q = at.row_ptr()[i], qe = at.row_ptr()[i + 1];
+            while (p < pe || q < qe)
+            {
+                Ordinal j;
+                int64_t w = 1;
+                if (q == qe || (p < pe && a.col_ind(p) < at.col_ind(q)))
+                {
+                    j = a.col_ind(p++);
+                }
+                else if (p == pe || at.col_ind(q) < a.col_ind(p))
+                {
+                    j = at.col_ind(q++);
+                }
+                else
+                {
+                    j = a.col_ind(p++);
+                    ++q;
+                    w = 2;
+                }
+                if (j != i)
+                {
+                    g.adj.push_back(j);
+                    g.adjw.push_back(w);
+                }
+            }
+            g.xadj[i + 1] = Offset(g.adj.size());
+        }
+        return g;
+    }
+
+    /* heavy-edge matching: each vertex is merged with the unmatched neighbor it shares the heaviest edge with.
+       Returns the coarse graph, and fills cmap with the coarse vertex of each vertex
+    */
+    PartitionGraph coarsen(std::vector<Ordinal> &cmap, std::mt19937_64 &rng) const
+    {
+        const Ordinal n = num_vertices();
+        std::vector<Ordinal> order(n);
+        for (Ordinal v = 0; v < n; ++v)
+        {
+            order[v] = v;
+        }
+        std::shuffle(order.begin(), order.end(), rng);
+
+        std::vector<Ordinal> match(n, -1);
+        for (const Ordinal v : order)
+        {
+            if (match[v] != -1)
+            {
+                continue;
+            }
+            Ordinal best = v;
+            int64_t bestW = -1;
+            for (Offset e = xadj[v]; e < xadj[v + 1]; ++e)
+            {
+                if (match[adj[e]] == -1 && adjw[e] > bestW)
+                {
+                    best = adj[e];
+                    bestW = adjw[e];
+                }
+            }
+            match[v] = best;
+            match[best] = v;
+        }
+
+        // coarse vertex c is made of fine[2c] and fine[2c+1] (the same vertex if unmatched)
+        cmap.assign(n, -1);
+        std::vector<Ordinal> fine;
+        fine.reserve(2 * n);
+        Ordinal nc = 0;
+        for (Ordinal v = 0; v < n; ++v)
+        {
+            if (cmap[v] == -1)
+            {
+                cmap[v] = cmap[match[v]] = nc++;
+                fine.push_back(v);
+                fine.push_back(match[v]);
+            }
+        }
+
+        // merge the neighbors of each pair, summing edges to the same coarse vertex
+        PartitionGraph c;
+        c.xadj.assign(nc + 1, 0);
+        c.vw.resize(nc);
+        c.adj.reserve(adj.size());
+        c.adjw.reserve(adj.size());
+        std::vector<Offset> slot(nc, Offset(-1)); // position of each coarse neighbor in the current row
+        for (Ordinal cv = 0; cv < nc; ++cv)
+        {
+            const Offset rowBegin = Offset(c.adj.size());
+            const Ordinal u0 = fine[2 * cv], u1 = fine[2 * cv + 1];
+            c.vw[cv] = vw[u0] + (u1 != u0 ? vw[u1] : 0);
+            for (int s = 0; s < (u1 != u0 ? 2 : 1); ++s)
+            {
+                const Ordinal u = s ? u1 : u0;
+                for (Offset e = xadj[u]; e < xadj[u + 1]; ++e)
+                {
+                    const Ordinal cu = cmap[adj[e]];
+                    if (cu == cv)
+                    {
+                        continue;
+                    }
+                    if (slot[cu] == Offset(-1) || slot[cu] < rowBegin)
+                    {
+                        slot[cu] = Offset(c.adj.size());
+                        c.adj.push_back(cu);
+                        c.adjw.push_back(adjw[e]);
+                    }
+                    else
+                    {
+                        c.adjw[slot[cu]] += adjw[e];
+                    }
+                }
+            }
+            c.xadj[cv + 1] = Offset(c.adj.size());
+        }
+        return c;
+    }
+
+    // total weight of edges between parts
+    int64_t cut(const std::vector<int> &part) const
+    {
+        int64_t c = 0;
+        for (Ordinal v = 0; v < num_vertices(); ++v)
+        {
+            for (Offset e = xadj[v]; e < xadj[v + 1]; ++e)
+            {
+                c += (part[v] != part[adj[e]]) ? adjw[e] : 0;
+            }
+        }
+        return c / 2;
+    }
+
+    /* k parts from a breadth-first order starting at root: consecutive vertices
+       are assigned to a part until it reaches its share of the vertex weight
+    */
+    std::vector<int> grow(int k, Ordinal root) const
+    {
+        const Ordinal n = num_vertices();
+        std::vector<Ordinal> order;
+        order.reserve(n);
+        std::vector<char> seen(n, 0);
+        for (Ordinal s = 0; s < n; ++s)
+        {
+            const Ordinal start = (s == 0) ? root : s;
+            if (seen[start])
+            {
+                continue;
+            }
+            seen[start] = 1;
+            size_t head = order.size();
+            order.push_back(start);
+            while (head < order.size())
+            {
+                const Ordinal u = order[head++];
+                for (Offset e = xadj[u]; e < xadj[u + 1]; ++e)
+                {
+                    if (!seen[adj[e]])
+                    {
+                        seen[adj[e]] = 1;
+                        order.push_back(adj[e]);
+                    }
+                }
+            }
+        }
+
+        int64_t total = 0;
+        for (const int64_t w : vw)
+        {
+            total += w;
+        }
+        std::vector<int> part(n);
+        int64_t acc = 0;
+        for (const Ordinal v : order)
+        {
+            part[v] = int(std::min<int64_t>(k - 1, acc * k / std::max<int64_t>(1, total)));
+            acc += vw[v];
+        }
+        return part;
+    }
+
+    /* greedy k-way refinement: move each vertex to the neighboring part it is most connected to,
+       if that reduces the cut without any part exceeding maxWeight.
+       Vertices in an overweight part may also move to a part with room when that costs cut.
+    */
+    void refine(std::vector<int> &part, int k, int64_t maxWeight, std::mt19937_64 &rng, int passes = 8) const
+    {
+        const Ordinal n = num_vertices();
+        std::vector<int64_t> pw(k, 0);
+        for (Ordinal v = 0; v < n; ++v)
+        {
+            pw[part[v]] += vw[v];
+        }
+        std::vector<Ordinal> order(n);
+        for (Ordinal v = 0; v < n; ++v)
+        {
+            order[v] = v;
+        }
+        std::vector<int64_t> conn(k, 0);
+        std::vector<int> touched;
+
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            std::shuffle(order.begin(), order.end(), rng);
+            Ordinal moved = 0;
+            for (const Ordinal v : order)
+            {
+                const int from = part[v];
+                touched.clear();
+                for (Offset e = xadj[v]; e < xadj[v + 1]; ++e)
+                {
+                    const int p = part[adj[e]];
+                    if (0 == conn[p])
+                    {
+                        touched.push_back(p);
+                    }
+                    conn[p] += adjw[e];
+                }
+                const bool over = pw[from] > maxWeight;
+                int best = from;
+                int64_t bestGain = over ? INT64_MIN : 0;
+                for (const int p : touched)
+                {
+                    const int64_t gain = conn[p] - conn[from];
+                    if (p != from && pw[p] + vw[v] <= maxWeight &&
+                        (gain > bestGain || (gain == bestGain && best != from && pw[p] < pw[best])))
+                    {
+                        best = p;
+                        bestGain = gain;
+                    }
+                }
+                for (const int p : touched)
+                {
+                    conn[p] = 0;
+                }
+                if (best != from)
+                {
+                    pw[from] -= vw[v];
+                    pw[best] += vw[v];
+                    part[v] = best;
+                    ++moved;
+                }
+            }
+            if (0 == moved)
+            {
+                break;
+            }
+        }
+    }
+};
+
+/* Multilevel k-way partition of the graph of A + A^T.
+
+   The graph is coarsened by heavy-edge matching until it has a few dozen vertices per part,
+   the coarsest graph is split by breadth-first growing from several roots (keeping the smallest cut),
+   and the partition is projected back level by level with greedy boundary refinement at each.
+   No part weighs more than (1 + imbalance) times the average, where the vertex weight of a
+   row is its entries plus one, unless a single vertex makes that impossible.
+*/
+template <typename Ordinal, typename Scalar, typename Offset>
+Partition partition_multilevel(const CSR<Ordinal, Scalar, Offset> &a, int k, double imbalance = 0.03, uint64_t seed = 0)
+{
+    typedef PartitionGraph<Ordinal, Offset> graph_t;
+    if (a.num_rows() != a.num_cols())
+    {
+        throw std::logic_error("partition_multilevel: needs a square matrix");
+    }
+    if (k < 1)
+    {
+        throw std::logic_error("partition_multilevel: need at least one part");
+    }
+    std::mt19937_64 rng(seed);
+
+    std::vector<graph_t> graphs(1, graph_t::from_csr(a));
+    std::vector<std::vector<Ordinal>> cmaps;
+    const Ordinal coarsest = std::max(Ordinal(32), Ordinal(20 * k));
+    while (graphs.back().num_vertices() > coarsest)
+    {
+        std::vector<Ordinal> cmap;
+        graph_t c = graphs.back().coarsen(cmap, rng);
+        if (c.num_vertices() > graphs.back().num_vertices() * 9 / 10)
+        {
+            break; // matching has stalled, e.g. on a star
+        }
+        cmaps.push_back(std::move(cmap));
+        graphs.push_back(std::move(c));
+    }
+
+    int64_t total = 0;
+    for (const int64_t w : graphs[0].vw)
+    {
+        total += w;
+    }
+    const int64_t maxWeight = int64_t((1 + imbalance) * double(total) / k) + 1;
+
+    // initial partition
+    const graph_t &gc = graphs.back();
+    std::vector<int> part;
+    int64_t bestCut = INT64_MAX;
+    std::uniform_int_distribution<Ordinal> pick(0, std::max(Ordinal(0), gc.num_vertices() - 1));
+    for (int trial = 0; trial < 8 && gc.num_vertices() > 0; ++trial)
+    {
+        std::vector<int> p = gc.grow(k, pick(rng));
+        gc.refine(p, k, maxWeight, rng);
+        const int64_t c = gc.cut(p);
+        if (c < bestCut)
+        {
+            bestCut = c;
+            part.swap(p);
+        }
+    }
+
+    // project and refine
+    for (size_t l = cmaps.size(); l-- > 0;)
+    {
+        std::vector<int> fine(graphs[l].num_vertices());
+        for (Ordinal v = 0; v < graphs[l].num_vertices(); ++v)
+        {
+            fine[v] = part[cmaps[l][v]];
+        }
+        part.swap(fine);
+        graphs[l].refine(part, k, maxWeight, rng);
+    }
+    return Partition(k, std::move(part));
+}
+
+/* The rows of A owned by one part, with columns renumbered locally.
+   Local column c < rows.size() is owned row rows[c]; local column rows.size() + g is ghost g,
+   whose x value comes from ghostOwner[g], where it is local row ghostIndex[g].
+   Ghosts are ordered by owner and then global index, so each owner's halo is contiguous.
+*/
+template <typename Ordinal, typename Scalar, typename Offset>
+struct LocalMatrix
+{
+    typedef CSR<Ordinal, Scalar, Offset> csr_type;
+
+    std::vector<Ordinal> rows;       // global index of each local row
+    std::vector<Ordinal> ghosts;     // global index of each ghost column
+    std::vector<int> ghostOwner;     // part that owns each ghost
+    std::vector<Ordinal> ghostIndex; // local row of each ghost on its owner
+    csr_type a;
+
+    Ordinal num_owned() const { return Ordinal(rows.size()); }
+    Ordinal num_ghosts() const { return Ordinal(ghosts.size()); }
+};
+
+/* split A into the local matrices of each part, one thread per part
+ */
+template <typename Ordinal, typename Scalar, typename Offset>
+std::vector<LocalMatrix<Ordinal, Scalar, Offset>> distribute(const CSR<Ordinal, Scalar, Offset> &a, const Partition &partition)
+{
+    const Ordinal n = a.num_rows();
+    if (n != a.num_cols() || Ordinal(partition.part.size()) != n)
+    {
+        throw std::logic_error("distribute: needs a square matrix and a part for every row");
+    }
+    if (a.symmetry() != Info::Symmetry::GENERAL)
+    {
+        throw std::logic_error("distribute: needs general storage, see expand()");
+    }
+    const std::vector<int> &part = partition.part;
+    std::vector<LocalMatrix<Ordinal, Scalar, Offset>> locals(partition.nparts);
+
+    // owned rows in increasing global order, and the local index of each row on its owner
+    std::vector<Ordinal> localIndex(n);
+    for (Ordinal i = 0; i < n; ++i)
+    {
+        if (part[i] < 0 || part[i] >= partition.nparts)
+        {
+            throw std::logic_error("distribute: part out of range");
+        }
+        localIndex[i] = Ordinal(locals[part[i]].rows.size());
+        locals[part[i]].rows.push_back(i);
+    }
+
+    parallel_for(0, partition.nparts, [&](int, int lb, int ub)
+                 {
+        std::vector<Ordinal> ghostSlot(n, -1);
+        std::vector<std::pair<int, Ordinal>> found;
+        std::vector<std::pair<Ordinal, Scalar>> row;
+        for (int p = lb; p < ub; ++p) {
+            LocalMatrix<Ordinal, Scalar, Offset> &l = locals[p];
+            const Ordinal nOwned = l.num_owned();
+
+            found.clear();
+            for (const Ordinal i : l.rows) {
+                for (Offset k = a.row_ptr()[i]; k < a.row_ptr()[i + 1]; ++k) {
+                    const Ordinal j = a.col_ind(k);
+                    if (part[j] != p && ghostSlot[j] == -1) {
+                        ghostSlot[j] = 0;
+                        found.push_back(std::make_pair(part[j], j));
+                    }
+                }
+            }
+            std::sort(found.begin(), found.end());
+            for (size_t g = 0; g < found.size(); ++g) {
+                ghostSlot[found[g].second] = nOwned + Ordinal(g);
+                l.ghostOwner.push_back(found[g].first);
+                l.ghosts.push_back(found[g].second);
+                l.ghostIndex.push_back(localIndex[found[g].second]);
+            }
+
+            std::vector<Offset> rowPtr(nOwned + 1, 0);
+            std::vector<Ordinal> colInd;
+            std::vector<Scalar> val;
+            for (Ordinal r = 0; r < nOwned; ++r) {
+                const Ordinal i = l.rows[r];
+                row.clear();
+                for (Offset k = a.row_ptr()[i]; k < a.row_ptr()[i + 1]; ++k) {
+                    const Ordinal j = a.col_ind(k);
+                    row.push_back(std::make_pair(part[j] == p ? localIndex[j] : ghostSlot[j], a.val(k)));
+                }
+                std::sort(row.begin(), row.end(), [](const std::pair<Ordinal, Scalar> &x, const std::pair<Ordinal, Scalar> &y) {
+                    return x.first < y.first;
+                });
+                for (const std::pair<Ordinal, Scalar> &e : row) {
+                    colInd.push_back(e.first);
+                    val.push_back(e.second);
+                }
+                rowPtr[r + 1] = Offset(colInd.size());
+            }
+            l.a = CSR<Ordinal, Scalar, Offset>(nOwned + l.num_ghosts(), std::move(rowPtr), std::move(colInd), std::move(val));
+
+            for (const Ordinal j : l.ghosts) {
+                ghostSlot[j] = -1;
+            }
+        } });
+    return locals;
+}
+
+/* communication and balance of a distribution
+ */
+struct PartitionStats
+{
+    int nparts;
+    uint64_t cut;              // entries whose row and column are owned by different parts
+    uint64_t volume;           // x values received over all parts (sum of halo)
+    uint64_t maxHalo;          // most x values received by one part
+    std::vector<uint64_t> nnz; // entries of each part
+    std::vector<uint64_t> halo; // x values received by each part
+    double imbalance;          // most entries in one part over the average
+
+    PartitionStats() : nparts(0), cut(0), volume(0), maxHalo(0), imbalance(0) {}
+};
+
+template <typename Ordinal, typename Scalar, typename Offset>
+PartitionStats partition_stats(const std::vector<LocalMatrix<Ordinal, Scalar, Offset>> &locals)
+{
+    PartitionStats s;
+    s.nparts = int(locals.size());
+    uint64_t total = 0, most = 0;
+    for (const LocalMatrix<Ordinal, Scalar, Offset> &l : locals)
+    {
+        for (const Ordinal &c : l.a.col_ind())
+        {
+            s.cut += (c >= l.num_owned());
+        }
+        s.nnz.push_back(l.a.nnz());
+        s.halo.push_back(l.num_ghosts());
+        s.volume += l.num_ghosts();
+        s.maxHalo = std::max(s.maxHalo, uint64_t(l.num_ghosts()));
+        total += l.a.nnz();
+        most = std::max(most, uint64_t(l.a.nnz()));
+    }
+    s.imbalance = total ? double(most) * s.nparts / double(total) : 1;
+    return s;
+}
+
+/* y = A x with one thread per part, standing in for one rank each.
+
+   Every rank holds only its owned entries of x. It publishes them, waits at a barrier,
+   copies its ghosts out of the owners' published values (the halo exchange), and multiplies
+   its local matrix into its owned entries of y.
+*/
+template <typename Ordinal, typename Scalar, typename Offset>
+void spmv_distributed(const std::vector<LocalMatrix<Ordinal, Scalar, Offset>> &locals,
+                      const std::vector<Scalar> &x, std::vector<Scalar> &y)
+{
+    const int nparts = int(locals.size());
+    std::vector<const Scalar *> published(nparts, nullptr);
+    Barrier barrier(nparts);
+
+    parallel_run(nparts, [&](int p)
+                 {
+        const LocalMatrix<Ordinal, Scalar, Offset> &l = locals[p];
+        const Ordinal nOwned = l.num_owned();
+        std::vector<Scalar> xl(nOwned + l.num_ghosts());
+        for (Ordinal r = 0; r < nOwned; ++r) {
+            xl[r] = x[l.rows[r]];
+        }
+        published[p] = xl.data();
+        barrier.wait();
+
+        for (Ordinal g = 0; g < l.num_ghosts(); ++g) {
+            xl[nOwned + g] = published[l.ghostOwner[g]][l.ghostIndex[g]];
+        }
+        for (Ordinal r = 0; r < nOwned; ++r) {
+            Scalar acc = 0;
+            for (Offset k = l.a.row_ptr()[r]; k < l.a.row_ptr()[r + 1]; ++k) {
+                acc += l.a.val(k) * xl[l.a.col_ind(k)];
+            }
+            y[l.rows[r]] = acc;
+        }
+
+        // others may still be reading our published values
+        barrier.wait(); });
+}
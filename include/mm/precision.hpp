@@ -0,0 +1,147 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#pragma once
+
+#include "mm/mm.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+/* 16-bit storage types for matrix values.
+
+   They only store: arithmetic converts them to float, so a product with a double x is
+   computed in double. Use them as the Scalar of a COO or CSR (MtxReader converts as it
+   parses, and reports the error of doing so in conversion_error()), or convert an existing
+   CSR with convert_values(). The SpMV kernels accumulate in the type of val * x, so a
+   bfloat16 or float16 matrix times a double vector is computed in double.
+*/
+
+inline uint32_t float_bits(float f)
+{
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    return x;
+}
+
+inline float bits_float(uint32_t x)
+{
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+/* the upper half of an IEEE float: 8 exponent bits, 7 mantissa bits.
+   Same range as float, about 3 significant digits
+*/
+struct bfloat16
+{
+    uint16_t bits;
+
+    bfloat16() = default;
+    template <typename T>
+    explicit bfloat16(T v) : bits(from_float(float(v))) {}
+
+    operator float() const { return bits_float(uint32_t(bits) << 16); }
+
+    // round to nearest, ties to even
+    static uint16_t from_float(float f)
+    {
+        const uint32_t x = float_bits(f);
+        if ((x & 0x7fffffff) > 0x7f800000)
+        {
+            return uint16_t((x >> 16) | 0x40); // quiet NaN
+        }
+        return uint16_t((x + 0x7fff + ((x >> 16) & 1)) >> 16);
+    }
+};
+
+/* IEEE binary16: 5 exponent bits, 10 mantissa bits.
+   Largest finite value 65504, about 3 significant digits
+*/
+struct float16
+{
+    uint16_t bits;
+
+    float16() = default;
+    template <typename T>
+    explicit float16(T v) : bits(from_float(float(v))) {}
+
+    operator float() const
+    {
+        const uint32_t sign = uint32_t(bits & 0x8000) << 16;
+        const uint32_t e = (bits >> 10) & 0x1f;
+        const uint32_t m = bits & 0x3ff;
+        if (0 == e)
+        {
+            const float f = std::ldexp(float(m), -24); // zero or subnormal
+            return sign ? -f : f;
+        }
+        if (31 == e)
+        {
+            return bits_float(sign | 0x7f800000 | (m << 13)); // inf or NaN
+        }
+        return bits_float(sign | ((e + 112) << 23) | (m << 13));
+    }
+
+    // round to nearest, ties to even
+    static uint16_t from_float(float f)
+    {
+        const uint32_t x = float_bits(f);
+        const uint32_t sign = (x >> 16) & 0x8000;
+        const uint32_t a = x & 0x7fffffff;
+        if (a >= 0x7f800000)
+        {
+            return uint16_t(sign | 0x7c00 | (a > 0x7f800000 ? 0x200 : 0)); // inf or NaN
+        }
+        if (a >= 0x477ff000)
+        {
+            return uint16_t(sign | 0x7c00); // at least 65520 rounds to inf
+        }
+        if (a < 0x38800000)
+        {
+            // below 2^-14: subnormal, in units of 2^-24
+            if (a < 0x33000000)
+            {
+                return uint16_t(sign);
+            }
+            const uint32_t m = (a & 0x7fffff) | 0x800000;
+            const uint32_t shift = 126 - (a >> 23);
+            uint32_t h = m >> shift;
+            const uint32_t rem = m & ((1u << shift) - 1), half = 1u << (shift - 1);
+            h += (rem > half || (rem == half && (h & 1)));
+            return uint16_t(sign | h);
+        }
+        uint32_t h = (a - 0x38000000) >> 13;
+        const uint32_t rem = a & 0x1fff;
+        h += (rem > 0x1000 || (rem == 0x1000 && (h & 1))); // may carry into the exponent
+        return uint16_t(sign | h);
+    }
+};
+
+/* a copy of a with values converted to To.
+   If err is not null, the error of each conversion is added to it
+*/
+template <typename To, typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+CSR<Ordinal, To, Offset, Alloc> convert_values(const CSR<Ordinal, Scalar, Offset, Alloc> &a, ConversionError *err = nullptr)
+{
+    typedef CSR<Ordinal, To, Offset, Alloc> csr_t;
+    typename csr_t::val_type val(a.val().get_allocator());
+    val.reserve(a.nnz());
+    for (const Scalar &v : a.val())
+    {
+        val.push_back(To(v));
+        if (err)
+        {
+            err->add(v, val.back());
+        }
+    }
+    csr_t b(a.num_cols(),
+            typename csr_t::row_ptr_type(a.row_ptr().begin(), a.row_ptr().end(), a.row_ptr().get_allocator()),
+            typename csr_t::col_ind_type(a.col_ind().begin(), a.col_ind().end(), a.col_ind().get_allocator()),
+            std::move(val));
+    b.set_symmetry(a.symmetry());
+    return b;
+}
@@ -0,0 +1,201 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#pragma once
+
+#include "mm/mm.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+/* Loading matrices in the background.
+
+   load_coo_async and load_csr_async read one file on a new thread and return its future.
+   A Prefetcher reads a list of files in order on one background thread, so the next files
+   are parsed while the caller works on the current one. It stays at most `lookahead` files
+   ahead of the caller, and does not start a file whose estimated size would bring the files
+   loaded but not yet handed out over `memoryCap` bytes, unless there are none.
+*/
+
+/* read path on a new thread
+ */
+template <typename Ordinal, typename Scalar, typename Offset = size_t>
+std::future<COO<Ordinal, Scalar, Offset>> load_coo_async(const std::string &path)
+{
+    return std::async(std::launch::async, [path]()
+                      { return MtxReader<Ordinal, Scalar, Offset>(path).read_coo(); });
+}
+
+template <typename Ordinal, typename Scalar, typename Offset = size_t>
+std::future<CSR<Ordinal, Scalar, Offset>> load_csr_async(const std::string &path)
+{
+    return std::async(std::launch::async, [path]()
+                      { return CSR<Ordinal, Scalar, Offset>(MtxReader<Ordinal, Scalar, Offset>(path).read_coo()); });
+}
+
+/* bytes of physical memory, or 0 if unknown
+ */
+inline uint64_t physical_memory_bytes()
+{
+    const long pages = sysconf(_SC_PHYS_PAGES), pageSize = sysconf(_SC_PAGE_SIZE);
+    return pages > 0 && pageSize > 0 ? uint64_t(pages) * uint64_t(pageSize) : 0;
+}
+
+/* loads paths in order with load(path) on a background thread.
+   estimate(path) is the memory the result will take, used against the memory cap
+*/
+template <typename T>
+class Prefetcher
+{
+    std::vector<std::string> paths_;
+    std::function<T(const std::string &)> load_;
+    std::function<uint64_t(const std::string &)> estimate_;
+    size_t lookahead_;
+    uint64_t memoryCap_;
+
+    std::vector<std::promise<T>> promises_;
+    std::vector<uint64_t> counted_; // bytes of file k counted in queuedBytes_, until handed out
+    size_t next_;                   // the next file to hand out
+    uint64_t queuedBytes_;
+    bool stop_;
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::thread worker_;
+
+    void run()
+    {
+        for (size_t k = 0; k < paths_.size(); ++k)
+        {
+            try
+            {
+                const uint64_t bytes = estimate_(paths_[k]);
+                {
+                    std::unique_lock<std::mutex> lock(m_);
+                    cv_.wait(lock, [&]()
+                             { return stop_ || k < next_ ||
+                                      (k < next_ + lookahead_ && (0 == queuedBytes_ || 0 == memoryCap_ || queuedBytes_ + bytes <= memoryCap_)); });
+                    if (stop_)
+                    {
+                        return;
+                    }
+                    if (k >= next_)
+                    {
+                        counted_[k] = bytes;
+                        queuedBytes_ += bytes;
+                    }
+                }
+                promises_[k].set_value(load_(paths_[k]));
+            }
+            catch (...)
+            {
+                promises_[k].set_exception(std::current_exception());
+            }
+        }
+    }
+
+public:
+    Prefetcher(const std::vector<std::string> &paths, std::function<T(const std::string &)> load,
+               std::function<uint64_t(const std::string &)> estimate, size_t lookahead = 1, uint64_t memoryCap = 0)
+        : paths_(paths), load_(load), estimate_(estimate), lookahead_(std::max(size_t(1), lookahead)), memoryCap_(memoryCap),
+          promises_(paths.size()), counted_(paths.size(), 0), next_(0), queuedBytes_(0), stop_(false)
+    {
+        worker_ = std::thread(&Prefetcher::run, this);
+    }
+
+    Prefetcher(const Prefetcher &) = delete;
+    Prefetcher &operator=(const Prefetcher &) = delete;
+
+    // stops after the file in progress
+    ~Prefetcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        worker_.join();
+    }
+
+    size_t size() const { return paths_.size(); }
+
+    /* the next file, in the order of paths: its get() returns the result or rethrows its error.
+       Must be called at most size() times
+    */
+    std::future<T> next()
+    {
+        std::future<T> f;
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            if (next_ >= paths_.size())
+            {
+                throw std::logic_error("Prefetcher: no more files");
+            }
+            f = promises_[next_].get_future();
+            queuedBytes_ -= counted_[next_];
+            counted_[next_] = 0;
+            ++next_;
+        }
+        cv_.notify_all();
+        return f;
+    }
+};
+
+/* about the bytes of the COO of the file that reader opened
+ */
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+uint64_t estimate_coo_bytes(const MtxReader<Ordinal, Scalar, Offset, Alloc> &reader)
+{
+    const Info &info = reader.info();
+    const uint64_t entries = uint64_t(info.nnz) * (info.symmetry != Info::Symmetry::GENERAL && reader.expand_symmetry() ? 2 : 1);
+    return entries * sizeof(typename COO<Ordinal, Scalar, Offset, Alloc>::entry_type);
+}
+
+/* a Prefetcher of the COO of each path
+ */
+template <typename Ordinal, typename Scalar, typename Offset = size_t>
+class CooPrefetcher : public Prefetcher<COO<Ordinal, Scalar, Offset>>
+{
+    typedef MtxReader<Ordinal, Scalar, Offset> reader_t;
+
+public:
+    CooPrefetcher(const std::vector<std::string> &paths, size_t lookahead = 1, uint64_t memoryCap = 0)
+        : Prefetcher<COO<Ordinal, Scalar, Offset>>(
+              paths, [](const std::string &path)
+              { return reader_t(path).read_coo(); },
+              [](const std::string &path)
+              { return estimate_coo_bytes(reader_t(path)); },
+              lookahead, memoryCap) {}
+};
+
+/* a Prefetcher of the CSR of each path. The estimate is the peak while converting, when the
+   COO and the CSR are both held
+ */
+template <typename Ordinal, typename Scalar, typename Offset = size_t>
+class CsrPrefetcher : public Prefetcher<CSR<Ordinal, Scalar, Offset>>
+{
+    typedef MtxReader<Ordinal, Scalar, Offset> reader_t;
+
+public:
+    CsrPrefetcher(const std::vector<std::string> &paths, size_t lookahead = 1, uint64_t memoryCap = 0)
+        : Prefetcher<CSR<Ordinal, Scalar, Offset>>(
+              paths, [](const std::string &path)
+              { return CSR<Ordinal, Scalar, Offset>(reader_t(path).read_coo()); },
+              [](const std::string &path)
+              {
+                  const reader_t reader(path);
+                  const uint64_t coo = estimate_coo_bytes(reader);
+                  const uint64_t entries = coo / sizeof(typename COO<Ordinal, Scalar, Offset>::entry_type);
+                  return coo + entries * (sizeof(Ordinal) + sizeof(Scalar)) + uint64_t(reader.info().nrows + 1) * sizeof(Offset);
+              },
+              lookahead, memoryCap) {}
+};
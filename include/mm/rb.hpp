@@ -0,0 +1,513 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#pragma once
+
+#include "mm/mm.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/* Rutherford-Boeing and Harwell-Boeing files.
+
+   Both store a matrix by columns: the column pointers, then the row indices, then the values,
+   each section in a fixed-width Fortran format given in the header. RbReader reads the
+   sections straight into arrays. The compressed columns of A are the compressed rows of A^T,
+   so read_csc() is a CSR of the transpose with nothing to sort, and read_csr() turns it into
+   A with one O(nnz) transpose().
+
+   Assembled matrices of every type are read: real, complex, integer, and pattern, each general,
+   rectangular, symmetric, skew-symmetric, or hermitian. Elemental (unassembled) matrices and
+   right-hand sides are not. As with MtxReader, explicit zeros are dropped.
+*/
+
+/* a Fortran edit descriptor like (16I5), (3E26.18), or (1P,4D20.12):
+   up to `count` fields of `width` characters on each line
+*/
+struct FortranFormat
+{
+    int count;
+    int width;
+    char type; // I, E, D, F, or G
+
+    FortranFormat() : count(0), width(0), type(0) {}
+
+    static FortranFormat parse(const std::string &s)
+    {
+        std::string f;
+        for (char c : s)
+        {
+            if (!std::isspace(static_cast<unsigned char>(c)) && c != '(' && c != ')')
+            {
+                f.push_back(char(std::toupper(static_cast<unsigned char>(c))));
+            }
+        }
+        // a scale factor (1P) changes how values are printed, but not the value of a field with an exponent
+        const size_t p = f.find('P');
+        if (p != std::string::npos)
+        {
+            f.erase(0, p + 1 < f.size() && ',' == f[p + 1] ? p + 2 : p + 1);
+        }
+        FortranFormat ret;
+        const char *c = f.c_str();
+        char *end;
+        ret.count = std::isdigit(static_cast<unsigned char>(*c)) ? int(std::strtol(c, &end, 10)) : 1;
+        c = std::isdigit(static_cast<unsigned char>(*c)) ? end : c;
+        ret.type = *c++;
+        ret.width = int(std::strtol(c, &end, 10));
+        if (ret.count < 1 || ret.width < 1 || std::string("IEDFG").find(ret.type) == std::string::npos)
+        {
+            throw std::logic_error("FortranFormat: can't read format " + s);
+        }
+        return ret;
+    }
+
+    // the integer in a field
+    static int64_t to_integer(const char *field)
+    {
+        return std::strtoll(field, nullptr, 10);
+    }
+
+    // the real in a field, which may have a D exponent or only a sign before the exponent (1.5-300)
+    static double to_real(char *field)
+    {
+        for (char *c = field; *c; ++c)
+        {
+            if ('D' == *c || 'd' == *c)
+            {
+                *c = 'E';
+            }
+        }
+        char *end;
+        double v = std::strtod(field, &end);
+        if ('+' == *end || '-' == *end)
+        {
+            v *= std::pow(10.0, double(std::strtol(end, nullptr, 10)));
+        }
+        return v;
+    }
+};
+
+template <typename Ordinal, typename Scalar, typename Offset = size_t, typename Alloc = std::allocator<char>>
+class RbReader
+{
+public:
+    using csr_type = CSR<Ordinal, Scalar, Offset, Alloc>;
+
+private:
+    std::string path_;
+    std::string title_;
+    std::string key_;
+    Info info_;
+    FortranFormat ptrFormat_, indFormat_, valFormat_;
+    std::streamoff dataBegin_;
+    bool expand_;
+
+    static std::string trim(const std::string &s)
+    {
+        const size_t b = s.find_first_not_of(" \t\r");
+        return std::string::npos == b ? std::string() : s.substr(b, s.find_last_not_of(" \t\r") - b + 1);
+    }
+
+    void read_header()
+    {
+        std::ifstream inf(path_, std::ios::binary);
+        if (!inf)
+        {
+            throw std::runtime_error("couldn't open " + path_);
+        }
+        std::string line;
+
+        // title (72 characters) and key (8 characters)
+        std::getline(inf, line);
+        title_ = trim(line.substr(0, 72));
+        key_ = line.size() > 72 ? trim(line.substr(72, 8)) : std::string();
+
+        // lines in total, of pointers, of indices, of values, and (Harwell-Boeing only) of right-hand sides
+        std::getline(inf, line);
+        int64_t cards[5] = {0, 0, 0, 0, 0};
+        {
+            std::istringstream ss(line);
+            for (int k = 0; k < 5 && ss >> cards[k]; ++k)
+            {
+            }
+        }
+
+        // type, rows, columns, entries
+        std::getline(inf, line);
+        std::string type;
+        int64_t nrows = -1, ncols = -1, nnz = -1;
+        {
+            std::istringstream ss(line);
+            ss >> type >> nrows >> ncols >> nnz;
+        }
+        if (!inf || type.size() != 3 || nrows < 0 || ncols < 0 || nnz < 0)
+        {
+            throw std::logic_error("RbReader: " + path_ + " has no matrix type and size");
+        }
+        for (char &c : type)
+        {
+            c = char(std::toupper(static_cast<unsigned char>(c)));
+        }
+        info_.nrows = int(nrows);
+        info_.ncols = int(ncols);
+        info_.nnz = int(nnz);
+        info_.format = Info::Format::COORDINATE;
+        switch (type[0])
+        {
+        case 'R':
+            info_.scalar = Info::Scalar::REAL;
+            break;
+        case 'C':
+            info_.scalar = Info::Scalar::COMPLEX;
+            break;
+        case 'I':
+            info_.scalar = Info::Scalar::INTEGER;
+            break;
+        case 'P':
+        case 'Q': // pattern, with the values in another file
+            info_.scalar = Info::Scalar::PATTERN;
+            break;
+        default:
+            throw std::logic_error("RbReader: unknown value type " + type);
+        }
+        switch (type[1])
+        {
+        case 'U':
+        case 'R':
+            info_.symmetry = Info::Symmetry::GENERAL;
+            break;
+        case 'S':
+            info_.symmetry = Info::Symmetry::SYMMETRIC;
+            break;
+        case 'Z':
+            info_.symmetry = Info::Symmetry::SKEW;
+            break;
+        case 'H':
+            info_.symmetry = Info::Symmetry::HERMITIAN;
+            break;
+        default:
+            throw std::logic_error("RbReader: unknown structure " + type);
+        }
+        if ('A' != type[2])
+        {
+            throw std::logic_error("RbReader: " + path_ + " is not assembled (" + type + ")");
+        }
+
+        // formats of the pointers, indices, and values
+        std::getline(inf, line);
+        std::vector<std::string> formats;
+        for (size_t b = line.find('('); b != std::string::npos; b = line.find('(', b + 1))
+        {
+            const size_t e = line.find(')', b);
+            if (std::string::npos == e)
+            {
+                break;
+            }
+            formats.push_back(line.substr(b, e - b + 1));
+        }
+        const bool hasValues = Info::Scalar::PATTERN != info_.scalar && cards[3] > 0;
+        if (formats.size() < (hasValues ? 3u : 2u))
+        {
+            throw std::logic_error("RbReader: " + path_ + " is missing a format");
+        }
+        ptrFormat_ = FortranFormat::parse(formats[0]);
+        indFormat_ = FortranFormat::parse(formats[1]);
+        if (hasValues)
+        {
+            valFormat_ = FortranFormat::parse(formats[2]);
+        }
+        else
+        {
+            info_.scalar = Info::Scalar::PATTERN;
+        }
+
+        // the right-hand side header of a Harwell-Boeing file
+        if (cards[4] > 0)
+        {
+            std::getline(inf, line);
+        }
+        if (!inf)
+        {
+            throw std::logic_error("RbReader: " + path_ + " ends in the header");
+        }
+        dataBegin_ = inf.tellg();
+    }
+
+    /* call f(field) for n fields of format fmt, starting at the next line.
+       field is a null-terminated copy that f may modify
+    */
+    template <typename F>
+    static void read_fields(std::istream &inf, const FortranFormat &fmt, size_t n, F f, const char *section)
+    {
+        std::string line;
+        std::vector<char> field(fmt.width + 1);
+        size_t got = 0;
+        while (got < n)
+        {
+            if (!std::getline(inf, line))
+            {
+                throw std::logic_error(std::string("RbReader: file ends in the ") + section);
+            }
+            for (int k = 0; k < fmt.count && got < n && size_t(k) * fmt.width < line.size(); ++k)
+            {
+                const size_t w = std::min(size_t(fmt.width), line.size() - size_t(k) * fmt.width);
+                std::copy(line.begin() + size_t(k) * fmt.width, line.begin() + size_t(k) * fmt.width + w, field.begin());
+                field[w] = 0;
+                f(field.data());
+                ++got;
+            }
+        }
+    }
+
+    // a value of the file
+    static Scalar convert(Info::Scalar kind, double re, double im)
+    {
+        switch (kind)
+        {
+        case Info::Scalar::COMPLEX:
+            return from_complex<Scalar>(std::complex<double>(re, im));
+        case Info::Scalar::INTEGER:
+            return from_integer<Scalar>(int64_t(re));
+        case Info::Scalar::REAL:
+            return from_real<Scalar>(re);
+        case Info::Scalar::PATTERN:
+        case Info::Scalar::unknown:
+        default:
+            return from_pattern<Scalar>();
+        }
+    }
+
+public:
+    RbReader(const std::string &path) : path_(path), dataBegin_(0), expand_(true)
+    {
+        read_header();
+    }
+
+    const Info &info() const { return info_; }
+    const std::string &path() const { return path_; }
+    const std::string &title() const { return title_; }
+    const std::string &key() const { return key_; }
+
+    /* if expand (the default), matrices that are not general are returned with both triangles
+       stored, as from MtxReader. Otherwise only the stored triangle is returned, tagged with info().symmetry
+    */
+    void set_expand_symmetry(bool expand) { expand_ = expand; }
+    bool expand_symmetry() const { return expand_; }
+
+    /* the compressed columns of the file, as the num_cols() x num_rows() CSR of A^T.
+       Rows are sorted; they are only sorted here if a column of the file is not
+    */
+    csr_type read_csc(const Alloc &alloc = Alloc()) const
+    {
+        std::ifstream inf(path_, std::ios::binary);
+        if (!inf)
+        {
+            throw std::runtime_error("couldn't open " + path_);
+        }
+        inf.seekg(dataBegin_);
+        const Ordinal nrows = Ordinal(info_.nrows), ncols = Ordinal(info_.ncols);
+        const size_t nnz = size_t(info_.nnz);
+
+        typename csr_type::row_ptr_type colPtr(alloc);
+        colPtr.reserve(ncols + 1);
+        read_fields(inf, ptrFormat_, size_t(ncols) + 1, [&](const char *field)
+                    { colPtr.push_back(Offset(FortranFormat::to_integer(field) - 1)); },
+                    "column pointers");
+        for (Ordinal j = 0; j < ncols; ++j)
+        {
+            if (colPtr[j] > colPtr[j + 1])
+            {
+                throw std::logic_error("RbReader: column pointers decrease at column " + std::to_string(j + 1));
+            }
+        }
+        if (colPtr[0] != 0 || colPtr[ncols] != nnz)
+        {
+            throw std::logic_error("RbReader: column pointers don't cover the entries");
+        }
+
+        typename csr_type::col_ind_type rowInd(alloc);
+        rowInd.reserve(nnz);
+        read_fields(inf, indFormat_, nnz, [&](const char *field)
+                    {
+            const int64_t i = FortranFormat::to_integer(field) - 1;
+            if (i < 0 || i >= int64_t(nrows)) {
+                throw std::logic_error("RbReader: row index " + std::to_string(i + 1) + " out of range");
+            }
+            rowInd.push_back(Ordinal(i)); },
+                    "row indices");
+
+        typename csr_type::val_type val(alloc);
+        val.reserve(nnz);
+        std::vector<char> keep; // the value is not an explicit zero
+        keep.reserve(nnz);
+        const Info::Scalar kind = info_.scalar;
+        if (Info::Scalar::PATTERN == kind)
+        {
+            val.assign(nnz, from_pattern<Scalar>());
+            keep.assign(nnz, 1);
+        }
+        else
+        {
+            const bool complex = Info::Scalar::COMPLEX == kind;
+            const bool integer = 'I' == valFormat_.type;
+            double re = 0;
+            bool haveRe = false;
+            read_fields(inf, valFormat_, complex ? 2 * nnz : nnz, [&](char *field)
+                        {
+                const double v = integer ? double(FortranFormat::to_integer(field)) : FortranFormat::to_real(field);
+                if (complex && !haveRe) {
+                    re = v;
+                    haveRe = true;
+                    return;
+                }
+                const double r = complex ? re : v, im = complex ? v : 0;
+                haveRe = false;
+                keep.push_back(r != 0 || im != 0);
+                val.push_back(convert(kind, r, im)); },
+                        "values");
+        }
+
+        // drop explicit zeros and sort any column that is out of order, in place
+        Offset w = 0;
+        std::vector<std::pair<Ordinal, Scalar>> column;
+        for (Ordinal j = 0; j < ncols; ++j)
+        {
+            const Offset b = colPtr[j], e = colPtr[j + 1], wb = w;
+            bool sorted = true;
+            for (Offset k = b; k < e; ++k)
+            {
+                if (keep[k])
+                {
+                    sorted = sorted && (w == wb || rowInd[w - 1] <= rowInd[k]);
+                    rowInd[w] = rowInd[k];
+                    val[w++] = val[k];
+                }
+            }
+            if (!sorted)
+            {
+                column.clear();
+                for (Offset k = wb; k < w; ++k)
+                {
+                    column.push_back(std::make_pair(rowInd[k], val[k]));
+                }
+                std::stable_sort(column.begin(), column.end(), [](const std::pair<Ordinal, Scalar> &x, const std::pair<Ordinal, Scalar> &y)
+                                 { return x.first < y.first; });
+                for (Offset k = wb; k < w; ++k)
+                {
+                    rowInd[k] = column[k - wb].first;
+                    val[k] = column[k - wb].second;
+                }
+            }
+            colPtr[j] = wb;
+        }
+        colPtr[ncols] = w;
+        rowInd.resize(w);
+        val.resize(w);
+
+        csr_type csc(nrows, std::move(colPtr), std::move(rowInd), std::move(val));
+        // A^T of a symmetric, skew-symmetric, or hermitian A is one too, and stores the mirrored triangle
+        csc.set_symmetry(info_.symmetry);
+        return expand_ ? expand(csc) : csc;
+    }
+
+    /* the num_rows() x num_cols() CSR of A, with sorted rows, in O(nnz + rows + cols) after reading
+     */
+    csr_type read_csr(const Alloc &alloc = Alloc()) const
+    {
+        return transpose(read_csc(alloc));
+    }
+};
+
+/* write a to path as a Rutherford-Boeing file, real or complex as Scalar is, in the symmetry a is tagged with.
+   Values are written with 17 significant digits, which round-trip a double
+*/
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+void write_rb(const std::string &path, const CSR<Ordinal, Scalar, Offset, Alloc> &a, const std::string &title = "",
+              const std::string &key = "")
+{
+    typedef CSR<Ordinal, Scalar, Offset, Alloc> csr_t;
+    const bool complex = !std::is_same<Scalar, typename std::decay<decltype(std::real(Scalar()))>::type>::value;
+    const csr_t csc = transpose(a);
+    const size_t nnz = size_t(csc.nnz());
+
+    // width of an integer field, and how many fit in 80 columns
+    const int intWidth = int(std::to_string(std::max<uint64_t>(uint64_t(nnz) + 1, uint64_t(a.num_rows()))).size()) + 1;
+    const int perLine = 80 / intWidth;
+    const uint64_t nValues = complex ? 2 * nnz : nnz;
+    const uint64_t ptrCards = (uint64_t(a.num_cols()) + 1 + perLine - 1) / perLine;
+    const uint64_t indCards = (nnz + perLine - 1) / perLine;
+    const uint64_t valCards = (nValues + 2) / 3;
+
+    char sym = 'U';
+    switch (a.symmetry())
+    {
+    case Info::Symmetry::SYMMETRIC:
+        sym = 'S';
+        break;
+    case Info::Symmetry::SKEW:
+        sym = 'Z';
+        break;
+    case Info::Symmetry::HERMITIAN:
+        sym = 'H';
+        break;
+    case Info::Symmetry::GENERAL:
+    case Info::Symmetry::unknown:
+        sym = a.num_rows() == a.num_cols() ? 'U' : 'R';
+        break;
+    }
+
+    FILE *f = std::fopen(path.c_str(), "w");
+    if (!f)
+    {
+        throw std::runtime_error("write_rb: couldn't open " + path);
+    }
+    std::fprintf(f, "%-72.72s%-8.8s\n", title.c_str(), key.c_str());
+    std::fprintf(f, "%14llu%14llu%14llu%14llu\n", (unsigned long long)(ptrCards + indCards + valCards),
+                 (unsigned long long)ptrCards, (unsigned long long)indCards, (unsigned long long)valCards);
+    std::fprintf(f, "%c%cA%25lld%14lld%14llu%14d\n", complex ? 'c' : 'r', std::tolower(sym), (long long)a.num_rows(),
+                 (long long)a.num_cols(), (unsigned long long)nnz, 0);
+    char intFormat[32];
+    std::snprintf(intFormat, sizeof(intFormat), "(%dI%d)", perLine, intWidth);
+    std::fprintf(f, "%-16s%-16s%-20s\n", intFormat, intFormat, "(3E26.17)");
+
+    auto write_ints = [&](uint64_t n, uint64_t (*get)(const csr_t &, uint64_t))
+    {
+        for (uint64_t k = 0; k < n; ++k)
+        {
+            std::fprintf(f, "%*llu", intWidth, (unsigned long long)get(csc, k));
+            if ((k + 1) % perLine == 0 || k + 1 == n)
+            {
+                std::fputc('\n', f);
+            }
+        }
+    };
+    write_ints(uint64_t(a.num_cols()) + 1, [](const csr_t &c, uint64_t k)
+               { return uint64_t(c.row_ptr(k)) + 1; });
+    write_ints(nnz, [](const csr_t &c, uint64_t k)
+               { return uint64_t(c.col_ind(k)) + 1; });
+    for (uint64_t k = 0; k < nValues; ++k)
+    {
+        const Scalar &v = csc.val(complex ? k / 2 : k);
+        std::fprintf(f, "%26.17E", double(complex && k % 2 ? std::imag(v) : std::real(v)));
+        if ((k + 1) % 3 == 0 || k + 1 == nValues)
+        {
+            std::fputc('\n', f);
+        }
+    }
+    if (std::fclose(f))
+    {
+        throw std::runtime_error("write_rb: couldn't write " + path);
+    }
+}
@@ -0,0 +1,244 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#pragma once
+
+#include "mm/mm.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+/* smallest K such that A(i,j) = 0 for |i-j| > K, or -1 if A has no entries
+ */
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+Ordinal bandwidth(const CSR<Ordinal, Scalar, Offset, Alloc> &a)
+{
+    Ordinal k = -1;
+    for (Ordinal i = 0; i < a.num_rows(); ++i)
+    {
+        for (Offset ji = a.row_ptr()[i]; ji < a.row_ptr()[i + 1]; ++ji)
+        {
+            const Ordinal d = a.col_ind(ji) - i;
+            k = std::max(k, d < 0 ? -d : d);
+        }
+    }
+    return k;
+}
+
+/* B = P A P^T, so B(i,j) = A(perm[i], perm[j]).
+   Symmetric storage stays symmetric: the permuted entries still stand for their mirrors.
+
+   Rows of the transpose of B are filled in increasing row order so they come out sorted,
+   and transposing that back sorts B, so this is O(nnz + rows) with no per-row sort.
+   B's arrays use A's allocators.
+*/
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+CSR<Ordinal, Scalar, Offset, Alloc> permute_symmetric(const CSR<Ordinal, Scalar, Offset, Alloc> &a,
+                                                      const std::vector<Ordinal> &perm)
+{
+    typedef CSR<Ordinal, Scalar, Offset, Alloc> csr_t;
+    const Ordinal n = a.num_rows();
+    if (n != a.num_cols() || Ordinal(perm.size()) != n)
+    {
+        throw std::logic_error("permute_symmetric: needs a square matrix and a permutation of its rows");
+    }
+    const typename csr_t::row_ptr_type &rowPtr = a.row_ptr();
+
+    std::vector<Ordinal> inv(n);
+    for (Ordinal i = 0; i < n; ++i)
+    {
+        inv[perm[i]] = i;
+    }
+
+    // B^T row c has an entry for each B(r, c)
+    typename csr_t::row_ptr_type tRowPtr(n + 1, 0, rowPtr.get_allocator());
+    for (const Ordinal &j : a.col_ind())
+    {
+        ++tRowPtr[inv[j] + 1];
+    }
+    for (Ordinal j = 0; j < n; ++j)
+    {
+        tRowPtr[j + 1] += tRowPtr[j];
+    }
+    std::vector<Offset> next(tRowPtr.begin(), tRowPtr.end() - 1);
+    typename csr_t::col_ind_type tColInd(a.nnz(), Ordinal(), a.col_ind().get_allocator());
+    typename csr_t::val_type tVal(a.nnz(), Scalar(), a.val().get_allocator());
+    for (Ordinal r = 0; r < n; ++r)
+    {
+        const Ordinal src = perm[r];
+        for (Offset k = rowPtr[src]; k < rowPtr[src + 1]; ++k)
+        {
+            const Offset dst = next[inv[a.col_ind(k)]]++;
+            tColInd[dst] = r;
+            tVal[dst] = a.val(k);
+        }
+    }
+
+    csr_t t(n, std::move(tRowPtr), std::move(tColInd), std::move(tVal));
+    t.set_symmetry(a.symmetry());
+    return transpose(t);
+}
+
+/* Reverse Cuthill-McKee ordering of the pattern of A + A^T (diagonal ignored).
+   Returns perm, where new row i is old row perm[i], suitable for permute_symmetric.
+
+   Each connected component is ordered breadth-first from a pseudo-peripheral node
+   (George & Liu), visiting the neighbors of each node in increasing degree, and
+   the whole ordering is reversed at the end. Components are started in order of
+   their lowest-degree node.
+*/
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+std::vector<Ordinal> rcm(const CSR<Ordinal, Scalar, Offset, Alloc> &a)
+{
+    const Ordinal n = a.num_rows();
+    if (n != a.num_cols())
+    {
+        throw std::logic_error("rcm: needs a square matrix");
+    }
+
+    // adjacency of A + A^T without the diagonal, by merging the sorted rows of A and A^T
+    const CSR<Ordinal, Scalar, Offset, Alloc> at = transpose(a);
+    std::vector<Offset> xadj(n + 1, 0);
+    std::vector<Ordinal> adj;
+    adj.reserve(2 * a.nnz());
+    for (Ordinal i = 0; i < n; ++i)
+    {
+        Offset p = a.row_ptr()[i], pe = a.row_ptr()[i + 1];
+        Offset q = at.row_ptr()[i], qe = at.row_ptr()[i + 1];
+        while (p < pe || q < qe)
+        {
+            Ordinal j;
+            if (q == qe || (p < pe && a.col_ind(p) < at.col_ind(q)))
+            {
+                j = a.col_ind(p++);
+            }
+            else if (p == pe || at.col_ind(q) < a.col_ind(p))
+            {
+                j = at.col_ind(q++);
+            }
+            else
+            {
+                j = a.col_ind(p++);
+                ++q;
+            }
+            if (j != i && (Offset(adj.size()) == xadj[i] || adj.back() != j))
+            {
+                adj.push_back(j);
+            }
+        }
+        xadj[i + 1] = Offset(adj.size());
+    }
+
+    std::vector<Ordinal> degree(n);
+    for (Ordinal i = 0; i < n; ++i)
+    {
+        degree[i] = Ordinal(xadj[i + 1] - xadj[i]);
+    }
+    auto by_degree = [&degree](Ordinal u, Ordinal v)
+    { return degree[u] < degree[v] || (degree[u] == degree[v] && u < v); };
+
+    // nodes in increasing degree, to start each component
+    std::vector<Ordinal> starts(n);
+    for (Ordinal i = 0; i < n; ++i)
+    {
+        starts[i] = i;
+    }
+    std::stable_sort(starts.begin(), starts.end(), by_degree);
+
+    /* breadth-first level structure from root over unvisited nodes.
+       fills `order` with the nodes reached, and returns the number of levels.
+       `last` is the first index in `order` of the last level.
+       `mark` entries equal to `stamp` have been reached in this search
+    */
+    std::vector<Ordinal> mark(n, 0);
+    Ordinal stamp = 0;
+    std::vector<char> visited(n, 0);
+    auto levels = [&](Ordinal root, std::vector<Ordinal> &order, size_t &last) -> Ordinal
+    {
+        ++stamp;
+        order.clear();
+        order.push_back(root);
+        mark[root] = stamp;
+        Ordinal depth = 0;
+        size_t begin = 0;
+        while (begin < order.size())
+        {
+            last = begin;
+            const size_t end = order.size();
+            for (size_t k = begin; k < end; ++k)
+            {
+                const Ordinal u = order[k];
+                for (Offset e = xadj[u]; e < xadj[u + 1]; ++e)
+                {
+                    const Ordinal v = adj[e];
+                    if (!visited[v] && mark[v] != stamp)
+                    {
+                        mark[v] = stamp;
+                        order.push_back(v);
+                    }
+                }
+            }
+            begin = end;
+            ++depth;
+        }
+        return depth;
+    };
+
+    std::vector<Ordinal> perm;
+    perm.reserve(n);
+    std::vector<Ordinal> order;
+    std::vector<Ordinal> neighbors;
+    for (const Ordinal s : starts)
+    {
+        if (visited[s])
+        {
+            continue;
+        }
+
+        // pseudo-peripheral node: move to the lowest-degree node of the last level
+        // for as long as that makes the level structure deeper
+        Ordinal root = s;
+        size_t last = 0;
+        Ordinal depth = levels(root, order, last);
+        while (true)
+        {
+            const Ordinal candidate = *std::min_element(order.begin() + last, order.end(), by_degree);
+            size_t cLast = 0;
+            std::vector<Ordinal> cOrder;
+            const Ordinal cDepth = levels(candidate, cOrder, cLast);
+            if (cDepth <= depth)
+            {
+                break;
+            }
+            root = candidate;
+            depth = cDepth;
+            order.swap(cOrder);
+            last = cLast;
+        }
+
+        // Cuthill-McKee from root
+        size_t head = perm.size();
+        perm.push_back(root);
+        visited[root] = 1;
+        while (head < perm.size())
+        {
+            const Ordinal u = perm[head++];
+            neighbors.clear();
+            for (Offset e = xadj[u]; e < xadj[u + 1]; ++e)
+            {
+                const Ordinal v = adj[e];
+                if (!visited[v])
+                {
+                    visited[v] = 1;
+                    neighbors.push_back(v);
+                }
+            }
+            std::sort(neighbors.begin(), neighbors.end(), by_degree);
+            perm.insert(perm.end(), neighbors.begin(), neighbors.end());
+        }
+    }
+
+    std::reverse(perm.begin(), perm.end());
+    return perm;
+}
@@ -0,0 +1,255 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#pragma once
+
+#include "mm/mm.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+
+/* Partial loads of coordinate files whose entries are sorted by row.
+
+   A RowIndex records the byte offset of the first line of every `stride`-th row. It is built
+   by one pass that parses only the row of each line, and is saved next to the file
+   (sidecar_path()) so later loads skip that pass. read_rows() then parses only the lines
+   of the requested rows, plus at most stride - 1 rows at each end.
+
+   The sidecar stores the size and modification time of the file it indexes, and is rebuilt
+   by load_or_build() when they no longer match, or when its rows, block count, or offsets do
+   not fit the file. It is written in native byte order.
+*/
+template <typename Ordinal>
+class RowIndex
+{
+    uint64_t fileSize_;
+    int64_t fileTime_;
+    Ordinal nrows_;
+    Ordinal stride_;
+    std::vector<int64_t> offsets_; // lines of rows >= b * stride_ start at offsets_[b]; the last is data_end()
+
+    static constexpr char MAGIC[8] = {'M', 'M', 'R', 'O', 'W', 'I', 'X', '1'};
+
+    static void file_stamp(const std::string &path, uint64_t &size, int64_t &time)
+    {
+        struct stat st;
+        if (0 != stat(path.c_str(), &st))
+        {
+            throw std::logic_error("RowIndex: couldn't stat " + path);
+        }
+        size = uint64_t(st.st_size);
+        time = int64_t(st.st_mtime);
+    }
+
+public:
+    static constexpr Ordinal DEFAULT_STRIDE = 64;
+
+    RowIndex() : fileSize_(0), fileTime_(0), nrows_(0), stride_(1) {}
+
+    // where the index of path is saved
+    static std::string sidecar_path(const std::string &path) { return path + ".rowidx"; }
+
+    /* index the file of reader, which must be a coordinate file sorted by row.
+       Only the row of each line is parsed
+    */
+    template <typename Scalar, typename Offset, typename Alloc>
+    static RowIndex build(const MtxReader<Ordinal, Scalar, Offset, Alloc> &reader, Ordinal stride = DEFAULT_STRIDE)
+    {
+        const std::string &path = reader.path();
+        if (reader.info().format != Info::Format::COORDINATE)
+        {
+            throw std::logic_error("RowIndex: needs a coordinate file");
+        }
+        if (stride < 1)
+        {
+            throw std::logic_error("RowIndex: stride must be positive");
+        }
+        RowIndex index;
+        file_stamp(path, index.fileSize_, index.fileTime_);
+        index.nrows_ = Ordinal(reader.info().nrows);
+        index.stride_ = stride;
+        const size_t nBlocks = size_t((index.nrows_ + stride - 1) / stride);
+        index.offsets_.assign(nBlocks + 1, int64_t(reader.data_end()));
+
+        std::ifstream inf(path, std::ios::binary);
+        if (!inf)
+        {
+            throw std::logic_error("RowIndex: couldn't open " + path);
+        }
+        inf.seekg(reader.data_begin());
+        int64_t pos = reader.data_begin();
+        size_t next = 0; // the next block whose first line has not been seen
+        int64_t prev = 0;
+        std::string line;
+        while (pos < reader.data_end() && std::getline(inf, line))
+        {
+            const int64_t lineBegin = pos;
+            pos += line.size() + 1;
+            if (line.empty() || '%' == line[0])
+            {
+                continue;
+            }
+            const int64_t row = std::strtoll(line.c_str(), nullptr, 10) - 1;
+            if (row < prev)
+            {
+                throw std::logic_error("RowIndex: " + path + " is not sorted by row (row " + std::to_string(row + 1) + " after " + std::to_string(prev + 1) + ")");
+            }
+            prev = row;
+            // this line starts every block up to the one containing row
+            for (; next < nBlocks && int64_t(next) * stride <= row; ++next)
+            {
+                index.offsets_[next] = lineBegin;
+            }
+        }
+        return index;
+    }
+
+    /* read the sidecar of reader's file, or build it and try to save it if it is missing, stale,
+       or does not fit the file's rows and data section. A sidecar of another stride is reused.
+       An index that cannot be saved (a read-only directory) is still returned
+    */
+    template <typename Scalar, typename Offset, typename Alloc>
+    static RowIndex load_or_build(const MtxReader<Ordinal, Scalar, Offset, Alloc> &reader, Ordinal stride = DEFAULT_STRIDE)
+    {
+        const std::string &path = reader.path();
+        RowIndex index;
+        if (index.load(sidecar_path(path)) && index.is_current(path) && index.fits(reader))
+        {
+            return index;
+        }
+        index = build(reader, stride);
+        index.save(sidecar_path(path));
+        return index;
+    }
+
+    // write to path, return false if it could not be written
+    bool save(const std::string &path) const
+    {
+        std::ofstream outf(path, std::ios::binary);
+        const uint64_t header[5] = {fileSize_, uint64_t(fileTime_), uint64_t(nrows_), uint64_t(stride_), offsets_.size()};
+        outf.write(MAGIC, sizeof(MAGIC));
+        outf.write(reinterpret_cast<const char *>(header), sizeof(header));
+        outf.write(reinterpret_cast<const char *>(offsets_.data()), offsets_.size() * sizeof(int64_t));
+        return bool(outf);
+    }
+
+    /* read from path, return false if it is missing, not an index, or inconsistent: a stride that is
+       not positive, a block count that does not match the rows and stride, or offsets that decrease or
+       run past the end of the indexed file. This is left unchanged if it returns false
+    */
+    bool load(const std::string &path)
+    {
+        std::ifstream inf(path, std::ios::binary);
+        char magic[sizeof(MAGIC)];
+        uint64_t header[5];
+        if (!inf.read(magic, sizeof(magic)) || 0 != std::memcmp(magic, MAGIC, sizeof(MAGIC)) ||
+            !inf.read(reinterpret_cast<char *>(header), sizeof(header)))
+        {
+            return false;
+        }
+        const uint64_t nrows = header[2], stride = header[3];
+        if (stride < 1 || stride > uint64_t(std::numeric_limits<Ordinal>::max()) ||
+            nrows > uint64_t(std::numeric_limits<Ordinal>::max()) || header[4] != (nrows + stride - 1) / stride + 1)
+        {
+            return false;
+        }
+        std::vector<int64_t> offsets(header[4]);
+        if (!inf.read(reinterpret_cast<char *>(offsets.data()), offsets.size() * sizeof(int64_t)))
+        {
+            return false;
+        }
+        for (size_t b = 0; b < offsets.size(); ++b)
+        {
+            if (offsets[b] < 0 || uint64_t(offsets[b]) > header[0] || (b > 0 && offsets[b] < offsets[b - 1]))
+            {
+                return false;
+            }
+        }
+        fileSize_ = header[0];
+        fileTime_ = int64_t(header[1]);
+        nrows_ = Ordinal(header[2]);
+        stride_ = Ordinal(header[3]);
+        offsets_.swap(offsets);
+        return true;
+    }
+
+    // whether path still has the size and modification time this was built from
+    bool is_current(const std::string &path) const
+    {
+        uint64_t size;
+        int64_t time;
+        file_stamp(path, size, time);
+        return size == fileSize_ && time == fileTime_;
+    }
+
+    // whether this indexes the rows and data section of reader's file
+    template <typename Scalar, typename Offset, typename Alloc>
+    bool fits(const MtxReader<Ordinal, Scalar, Offset, Alloc> &reader) const
+    {
+        return nrows_ == Ordinal(reader.info().nrows) && offsets_.front() >= int64_t(reader.data_begin()) &&
+               offsets_.back() == int64_t(reader.data_end());
+    }
+
+    Ordinal num_rows() const { return nrows_; }
+    Ordinal stride() const { return stride_; }
+    const std::vector<int64_t> &offsets() const { return offsets_; }
+
+    /* a byte range whose lines hold every entry of rows [begin, end), to pass to
+       MtxReader::for_each_entry. It may hold some entries of nearby rows too
+    */
+    std::pair<int64_t, int64_t> byte_range(Ordinal begin, Ordinal end) const
+    {
+        if (begin < 0 || end > nrows_ || begin > end)
+        {
+            throw std::logic_error("RowIndex: rows out of range");
+        }
+        if (begin == end)
+        {
+            return std::make_pair(offsets_.back(), offsets_.back());
+        }
+        return std::make_pair(offsets_[begin / stride_], offsets_[(end + stride_ - 1) / stride_]);
+    }
+};
+
+template <typename Ordinal>
+constexpr char RowIndex<Ordinal>::MAGIC[8];
+
+/* the entries of rows [begin, end) of reader's file, as an (end - begin) x ncols COO whose
+   row i is row begin + i of the file. Only the lines index.byte_range(begin, end) are parsed.
+
+   Mirrored entries of a symmetric file can come from any row, so a file that is not
+   general needs set_expand_symmetry(false). The slab then holds the stored entries of its
+   rows, and is not tagged: a slab is not symmetric.
+*/
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+COO<Ordinal, Scalar, Offset, Alloc> read_rows(const MtxReader<Ordinal, Scalar, Offset, Alloc> &reader, const RowIndex<Ordinal> &index,
+                                            Ordinal begin, Ordinal end, const Alloc &alloc = Alloc())
+{
+    if (index.num_rows() != Ordinal(reader.info().nrows))
+    {
+        throw std::logic_error("read_rows: index is for a different file");
+    }
+    if (reader.info().symmetry != Info::Symmetry::GENERAL && reader.expand_symmetry())
+    {
+        throw std::logic_error("read_rows: mirrored entries of a symmetric file can be on any row, see set_expand_symmetry(false)");
+    }
+    typedef COO<Ordinal, Scalar, Offset, Alloc> coo_t;
+    coo_t coo(end - begin, Ordinal(reader.info().ncols), alloc);
+    const std::pair<int64_t, int64_t> range = index.byte_range(begin, end);
+    reader.for_each_entry(range.first, range.second, [&](const typename coo_t::entry_type &e)
+                          {
+        if (e.i >= begin && e.i < end) {
+            coo.entries.push_back(e);
+            coo.entries.back().i -= begin;
+        } });
+    return coo;
+}
@@ -0,0 +1,300 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#pragma once
+
+#include "mm/mm.hpp"
+#include "mm/parallel.hpp"
+#include "mm/partition.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/* Sparse matrix-matrix products C = A B.
+
+   Two phases over the same row blocks. The symbolic phase counts the distinct columns of
+   each row of C, so the arrays of C are allocated once at their exact size. The numeric
+   phase then fills each row in place. Rows are split by their number of multiplies (the
+   entries of B they visit), not by their entries in A, so a few long rows of a power-law
+   matrix do not all land on one thread.
+
+   Each thread merges its rows in a RowAccumulator. A row whose multiplies could cover a
+   large part of C's columns uses a dense array, and a shorter row uses a hash table sized to
+   its multiplies. A thread only allocates the dense array once it meets such a row, so the
+   extra memory is proportional to the work rather than to threads times columns.
+*/
+
+/* merges (column, value) pairs of one row of C at a time
+ */
+template <typename Ordinal, typename Scalar>
+class RowAccumulator
+{
+    Ordinal ncols_;
+    bool dense_;
+
+    // dense mode: a value and a flag for every column
+    std::vector<Scalar> dVal_;
+    std::vector<char> dUsed_;
+
+    // hash mode: open addressing with linear probing, key -1 is empty
+    std::vector<Ordinal> hKey_;
+    std::vector<Scalar> hVal_;
+    size_t hMask_;
+
+    std::vector<Ordinal> cols_;  // distinct columns of this row
+    std::vector<size_t> slots_; // hash mode: the slots they occupy
+
+    size_t slot(Ordinal j) const
+    {
+        size_t h = (uint64_t(j) * 0x9e3779b97f4a7c15ull) >> 32;
+        while (true)
+        {
+            h &= hMask_;
+            if (hKey_[h] == j || hKey_[h] == Ordinal(-1))
+            {
+                return h;
+            }
+            ++h;
+        }
+    }
+
+public:
+    /* rows with at least ncols / DENSE_DIVISOR multiplies use the dense array
+     */
+    static constexpr uint64_t DENSE_DIVISOR = 16;
+
+    explicit RowAccumulator(Ordinal ncols) : ncols_(ncols), dense_(false), hMask_(0) {}
+
+    // start a row that does at most `multiplies` insertions
+    void begin(uint64_t multiplies)
+    {
+        dense_ = multiplies * DENSE_DIVISOR >= uint64_t(ncols_);
+        if (dense_)
+        {
+            if (dVal_.empty())
+            {
+                dVal_.assign(ncols_, Scalar(0));
+                dUsed_.assign(ncols_, 0);
+            }
+        }
+        else
+        {
+            size_t cap = 8;
+            while (cap < 2 * multiplies)
+            {
+                cap *= 2;
+            }
+            if (hKey_.size() < cap)
+            {
+                hKey_.assign(cap, Ordinal(-1));
+                hVal_.assign(cap, Scalar(0));
+            }
+            hMask_ = cap - 1;
+        }
+    }
+
+    void insert(Ordinal j)
+    {
+        if (dense_)
+        {
+            if (!dUsed_[j])
+            {
+                dUsed_[j] = 1;
+                cols_.push_back(j);
+            }
+        }
+        else
+        {
+            const size_t h = slot(j);
+            if (hKey_[h] != j)
+            {
+                hKey_[h] = j;
+                cols_.push_back(j);
+                slots_.push_back(h);
+            }
+        }
+    }
+
+    void add(Ordinal j, const Scalar &v)
+    {
+        if (dense_)
+        {
+            if (!dUsed_[j])
+            {
+                dUsed_[j] = 1;
+                dVal_[j] = v;
+                cols_.push_back(j);
+            }
+            else
+            {
+                dVal_[j] += v;
+            }
+        }
+        else
+        {
+            const size_t h = slot(j);
+            if (hKey_[h] != j)
+            {
+                hKey_[h] = j;
+                hVal_[h] = v;
+                cols_.push_back(j);
+                slots_.push_back(h);
+            }
+            else
+            {
+                hVal_[h] += v;
+            }
+        }
+    }
+
+    // distinct columns of the row so far
+    size_t size() const { return cols_.size(); }
+
+    /* write the row sorted by column to colInd and val (if not null), and reset for the next row
+     */
+    void flush(Ordinal *colInd, Scalar *val)
+    {
+        if (colInd)
+        {
+            std::sort(cols_.begin(), cols_.end());
+        }
+        for (size_t q = 0; q < cols_.size(); ++q)
+        {
+            const Ordinal j = cols_[q];
+            if (dense_)
+            {
+                if (val)
+                {
+                    val[q] = dVal_[j];
+                }
+                dUsed_[j] = 0;
+            }
+            else if (val)
+            {
+                val[q] = hVal_[slot(j)];
+            }
+            if (colInd)
+            {
+                colInd[q] = j;
+            }
+        }
+        // clear only the slots in use, the table may be much larger than this row
+        for (const size_t h : slots_)
+        {
+            hKey_[h] = Ordinal(-1);
+        }
+        slots_.clear();
+        cols_.clear();
+    }
+};
+
+/* the multiplies of the rows of A B, prefix-summed: row i does work[i+1] - work[i], and
+   work.back() is the total. An upper bound on the entries of each row of the product
+*/
+template <typename Ordinal, typename Scalar, typename Offset, typename AAlloc, typename BAlloc>
+std::vector<uint64_t> spgemm_work(const CSR<Ordinal, Scalar, Offset, AAlloc> &a, const CSR<Ordinal, Scalar, Offset, BAlloc> &b,
+                                  const int nThreads = num_threads())
+{
+    if (a.num_cols() != b.num_rows())
+    {
+        throw std::logic_error("spgemm: A has " + std::to_string(a.num_cols()) + " columns but B has " + std::to_string(b.num_rows()) + " rows");
+    }
+    const Ordinal n = a.num_rows();
+    const Offset *aRowPtr = a.row_ptr().data();
+    const Ordinal *aColInd = a.col_ind().data();
+    const Offset *bRowPtr = b.row_ptr().data();
+    std::vector<uint64_t> work(n + 1, 0);
+    parallel_for(Ordinal(0), n, [&](int, Ordinal lb, Ordinal ub)
+                 {
+        for (Ordinal i = lb; i < ub; ++i) {
+            uint64_t w = 0;
+            for (Offset k = aRowPtr[i]; k < aRowPtr[i + 1]; ++k) {
+                const Ordinal j = aColInd[k];
+                w += bRowPtr[j + 1] - bRowPtr[j];
+            }
+            work[i + 1] = w;
+        } }, nThreads);
+    for (Ordinal i = 0; i < n; ++i)
+    {
+        work[i + 1] += work[i];
+    }
+    return work;
+}
+
+/* C = A B, with rows split into nThreads blocks of about the same number of multiplies.
+   Rows of C are sorted and contain every column reached through A and B, even if its value cancels to zero.
+*/
+template <typename Ordinal, typename Scalar, typename Offset, typename AAlloc, typename BAlloc>
+CSR<Ordinal, Scalar, Offset> spgemm(const CSR<Ordinal, Scalar, Offset, AAlloc> &a, const CSR<Ordinal, Scalar, Offset, BAlloc> &b,
+                                    const int nThreads = num_threads())
+{
+    if (a.symmetry() != Info::Symmetry::GENERAL || b.symmetry() != Info::Symmetry::GENERAL)
+    {
+        throw std::logic_error("spgemm: needs general storage, see expand()");
+    }
+    const Ordinal n = a.num_rows();
+    const Offset *aRowPtr = a.row_ptr().data();
+    const Ordinal *aColInd = a.col_ind().data();
+    const Scalar *aVal = a.val().data();
+    const Offset *bRowPtr = b.row_ptr().data();
+    const Ordinal *bColInd = b.col_ind().data();
+    const Scalar *bVal = b.val().data();
+
+    // balance the row blocks by multiplies
+    const std::vector<uint64_t> work = spgemm_work(a, b, nThreads);
+    const std::vector<Ordinal> bounds = balanced_row_blocks<Ordinal>(work, nThreads);
+    const int nt = int(bounds.size() - 1);
+
+    // symbolic: the number of distinct columns of each row
+    typename CSR<Ordinal, Scalar, Offset>::row_ptr_type rowPtr(n + 1, 0);
+    parallel_run(nt, [&](int t)
+                 {
+        RowAccumulator<Ordinal, Scalar> acc(b.num_cols());
+        for (Ordinal i = bounds[t]; i < bounds[t + 1]; ++i) {
+            acc.begin(work[i + 1] - work[i]);
+            for (Offset k = aRowPtr[i]; k < aRowPtr[i + 1]; ++k) {
+                const Ordinal j = aColInd[k];
+                for (Offset q = bRowPtr[j]; q < bRowPtr[j + 1]; ++q) {
+                    acc.insert(bColInd[q]);
+                }
+            }
+            rowPtr[i + 1] = Offset(acc.size());
+            acc.flush(nullptr, nullptr);
+        } });
+    for (Ordinal i = 0; i < n; ++i)
+    {
+        rowPtr[i + 1] += rowPtr[i];
+    }
+
+    // numeric: fill each row in place
+    typename CSR<Ordinal, Scalar, Offset>::col_ind_type colInd(rowPtr[n]);
+    typename CSR<Ordinal, Scalar, Offset>::val_type val(rowPtr[n]);
+    parallel_run(nt, [&](int t)
+                 {
+        RowAccumulator<Ordinal, Scalar> acc(b.num_cols());
+        for (Ordinal i = bounds[t]; i < bounds[t + 1]; ++i) {
+            acc.begin(work[i + 1] - work[i]);
+            for (Offset k = aRowPtr[i]; k < aRowPtr[i + 1]; ++k) {
+                const Ordinal j = aColInd[k];
+                const Scalar v = aVal[k];
+                for (Offset q = bRowPtr[j]; q < bRowPtr[j + 1]; ++q) {
+                    acc.add(bColInd[q], v * bVal[q]);
+                }
+            }
+            acc.flush(colInd.data() + rowPtr[i], val.data() + rowPtr[i]);
+        } });
+
+    return CSR<Ordinal, Scalar, Offset>(b.num_cols(), std::move(rowPtr), std::move(colInd), std::move(val));
+}
+
+/* the Galerkin product R A P, as (R A) P
+ */
+template <typename Ordinal, typename Scalar, typename Offset, typename RAlloc, typename AAlloc, typename PAlloc>
+CSR<Ordinal, Scalar, Offset> galerkin_product(const CSR<Ordinal, Scalar, Offset, RAlloc> &r, const CSR<Ordinal, Scalar, Offset, AAlloc> &a,
+                                              const CSR<Ordinal, Scalar, Offset, PAlloc> &p, const int nThreads = num_threads())
+{
+    return spgemm(spgemm(r, a, nThreads), p, nThreads);
+}
@@ -0,0 +1,142 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#pragma once
+
+#include "mm/mm.hpp"
+#include "mm/parallel.hpp"
+#include "mm/partition.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/* Sparse matrix times a block of dense vectors, Y = A X.
+
+   X has num_cols() rows and nv columns, Y has num_rows() rows and nv columns, both in the
+   same DenseLayout with leading dimensions ldx and ldy:
+     ROW_MAJOR: element (j, v) is at x[j * ldx + v], so the vectors of one row are adjacent
+     COL_MAJOR: element (j, v) is at x[v * ldx + j], so each vector is contiguous
+
+   The vectors are taken in panels of a compile-time width NV (32, 16, 8, 4, 2, then 1).
+   Within a panel, each entry of A is loaded once and applied to all NV vectors, and the NV
+   sums of a row stay in registers. The fixed-length loops over the panel are what the
+   compiler vectorizes, so the matrix is streamed once per panel instead of once per vector.
+   Row-major X is the faster layout: the NV values of x that an entry needs are contiguous.
+*/
+
+enum class DenseLayout
+{
+    ROW_MAJOR,
+    COL_MAJOR
+};
+
+/* rows [lb, ub) of the panel of NV vectors that starts at vector v0
+ */
+template <int NV, DenseLayout L, typename Ordinal, typename Scalar, typename Offset, typename Y, typename X>
+void spmm_panel(Y *y, size_t ldy, const Offset *rowPtr, const Ordinal *colInd, const Scalar *val, const X *x, size_t ldx,
+                int v0, Ordinal lb, Ordinal ub)
+{
+    typedef typename std::decay<decltype(val[0] * x[0])>::type acc_t;
+    // stride between vectors, and between rows, of x and y
+    const size_t xv = L == DenseLayout::ROW_MAJOR ? 1 : ldx, xr = L == DenseLayout::ROW_MAJOR ? ldx : 1;
+    const size_t yv = L == DenseLayout::ROW_MAJOR ? 1 : ldy, yr = L == DenseLayout::ROW_MAJOR ? ldy : 1;
+    x += v0 * xv;
+    y += v0 * yv;
+    for (Ordinal i = lb; i < ub; ++i)
+    {
+        acc_t acc[NV];
+        for (int v = 0; v < NV; ++v)
+        {
+            acc[v] = 0;
+        }
+        for (Offset k = rowPtr[i]; k < rowPtr[i + 1]; ++k)
+        {
+            const acc_t a = val[k];
+            const X *xj = x + colInd[k] * xr;
+            for (int v = 0; v < NV; ++v)
+            {
+                acc[v] += a * xj[v * xv];
+            }
+        }
+        Y *yi = y + i * yr;
+        for (int v = 0; v < NV; ++v)
+        {
+            yi[v * yv] = acc[v];
+        }
+    }
+}
+
+/* rows [lb, ub) of all nv vectors, in panels as wide as possible
+ */
+template <DenseLayout L, typename Ordinal, typename Scalar, typename Offset, typename Y, typename X>
+void spmm_rows(Y *y, size_t ldy, const Offset *rowPtr, const Ordinal *colInd, const Scalar *val, const X *x, size_t ldx,
+               int nv, Ordinal lb, Ordinal ub)
+{
+    int v0 = 0;
+    for (; v0 + 32 <= nv; v0 += 32)
+    {
+        spmm_panel<32, L>(y, ldy, rowPtr, colInd, val, x, ldx, v0, lb, ub);
+    }
+    for (; v0 + 16 <= nv; v0 += 16)
+    {
+        spmm_panel<16, L>(y, ldy, rowPtr, colInd, val, x, ldx, v0, lb, ub);
+    }
+    for (; v0 + 8 <= nv; v0 += 8)
+    {
+        spmm_panel<8, L>(y, ldy, rowPtr, colInd, val, x, ldx, v0, lb, ub);
+    }
+    for (; v0 + 4 <= nv; v0 += 4)
+    {
+        spmm_panel<4, L>(y, ldy, rowPtr, colInd, val, x, ldx, v0, lb, ub);
+    }
+    for (; v0 + 2 <= nv; v0 += 2)
+    {
+        spmm_panel<2, L>(y, ldy, rowPtr, colInd, val, x, ldx, v0, lb, ub);
+    }
+    for (; v0 < nv; ++v0)
+    {
+        spmm_panel<1, L>(y, ldy, rowPtr, colInd, val, x, ldx, v0, lb, ub);
+    }
+}
+
+/* Y = A X for nv vectors, one thread per row block [bounds[t], bounds[t+1])
+ */
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc, typename Y, typename X>
+void spmm(Y *y, size_t ldy, const CSR<Ordinal, Scalar, Offset, Alloc> &a, const X *x, size_t ldx, int nv, DenseLayout layout,
+          const std::vector<Ordinal> &bounds)
+{
+    if (bounds.size() < 2 || bounds.front() != 0 || bounds.back() != a.num_rows())
+    {
+        throw std::logic_error("spmm: bounds must cover every row");
+    }
+    if (a.symmetry() != Info::Symmetry::GENERAL)
+    {
+        throw std::logic_error("spmm: needs general storage, see expand()");
+    }
+    const bool rowMajor = DenseLayout::ROW_MAJOR == layout;
+    if (nv < 0 || (rowMajor && (ldx < size_t(nv) || ldy < size_t(nv))) ||
+        (!rowMajor && (ldx < size_t(a.num_cols()) || ldy < size_t(a.num_rows()))))
+    {
+        throw std::logic_error("spmm: leading dimension too small for the layout");
+    }
+    const Offset *rowPtr = a.row_ptr().data();
+    const Ordinal *colInd = a.col_ind().data();
+    const Scalar *val = a.val().data();
+    parallel_run(int(bounds.size() - 1), [&](int t)
+                 {
+        if (rowMajor) {
+            spmm_rows<DenseLayout::ROW_MAJOR>(y, ldy, rowPtr, colInd, val, x, ldx, nv, bounds[t], bounds[t + 1]);
+        } else {
+            spmm_rows<DenseLayout::COL_MAJOR>(y, ldy, rowPtr, colInd, val, x, ldx, nv, bounds[t], bounds[t + 1]);
+        } });
+}
+
+/* Y = A X, with rows split by balanced_row_blocks(a, num_threads())
+ */
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc, typename Y, typename X>
+void spmm(Y *y, size_t ldy, const CSR<Ordinal, Scalar, Offset, Alloc> &a, const X *x, size_t ldx, int nv, DenseLayout layout)
+{
+    spmm(y, ldy, a, x, ldx, nv, layout, balanced_row_blocks(a, num_threads()));
+}
@@ -0,0 +1,380 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#pragma once
+
+#include "mm/alloc.hpp"
+#include "mm/mm.hpp"
+#include "mm/parallel.hpp"
+#include "mm/partition.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/* Multithreaded sparse matrix-vector products.
+
+   Each kernel takes `bounds`, the contiguous row blocks of its threads (thread t computes rows
+   [bounds[t], bounds[t+1])), usually from balanced_row_blocks. first_touch_csr and first_touch_copy
+   build a CSR whose arrays were first written by the same threads over the same blocks, so on a
+   first-touch NUMA system every thread streams memory on its own node when the bounds are reused.
+
+   A CSR that stores one triangle of a symmetric, skew-symmetric, or hermitian matrix
+   (symmetry() is not GENERAL) is multiplied by spmv_symmetric, which applies both triangles
+   in one pass over the stored entries, with a SymmetricSpmvSchedule for its thread buffers.
+*/
+
+/* the row blocks of a symmetric SpMV, and the columns each block mirrors into outside its rows.
+
+   Thread t owns y over its rows [bounds[t], bounds[t+1]) and writes them directly. A mirrored term
+   for a column outside them goes to the thread's buffer, and a second pass adds each buffer into the
+   rows that own its columns. If the columns a block touches outside its rows fill at least half of
+   their range, its buffer covers that range, starting at lo(t); otherwise it has one slot per column,
+   cols(t), found by binary search. Either way a buffer is at most twice the columns it stands for.
+   The buffers are allocated here and reused by every product, so a schedule serves one product at a time.
+*/
+template <typename Ordinal, typename Acc, typename Offset = size_t>
+class SymmetricSpmvSchedule
+{
+    std::vector<Ordinal> bounds_;
+    Offset nnz_;
+    std::vector<Ordinal> lo_;
+    std::vector<std::vector<Ordinal>> cols_; // sorted, empty for a buffer over a range
+    std::vector<std::vector<Acc>> buf_;
+
+public:
+    template <typename Scalar, typename Alloc>
+    SymmetricSpmvSchedule(const CSR<Ordinal, Scalar, Offset, Alloc> &a, const std::vector<Ordinal> &bounds)
+        : bounds_(bounds), nnz_(a.nnz())
+    {
+        if (bounds.size() < 2 || bounds.front() != 0 || bounds.back() != a.num_rows())
+        {
+            throw std::logic_error("SymmetricSpmvSchedule: bounds must cover every row");
+        }
+        if (a.num_rows() != a.num_cols())
+        {
+            throw std::logic_error("SymmetricSpmvSchedule: symmetric storage must be square");
+        }
+        const int nt = int(bounds.size() - 1);
+        lo_.resize(nt);
+        cols_.resize(nt);
+        buf_.resize(nt);
+        parallel_run(nt, [&](int t)
+                     {
+            const Ordinal lb = bounds[t], ub = bounds[t + 1];
+            std::vector<Ordinal> &c = cols_[t];
+            for (Offset k = a.row_ptr(lb); k < a.row_ptr(ub); ++k) {
+                const Ordinal j = a.col_ind(k);
+                if (j < lb || j >= ub) {
+                    c.push_back(j);
+                }
+            }
+            std::sort(c.begin(), c.end());
+            c.erase(std::unique(c.begin(), c.end()), c.end());
+            lo_[t] = c.empty() ? 0 : c.front();
+            const size_t range = c.empty() ? 0 : size_t(c.back() - c.front()) + 1;
+            if (range <= 2 * c.size()) {
+                std::vector<Ordinal>().swap(c);
+                buf_[t].assign(range, Acc(0));
+            } else {
+                c.shrink_to_fit();
+                buf_[t].assign(c.size(), Acc(0));
+            } });
+    }
+
+    int num_threads() const { return int(bounds_.size() - 1); }
+    Offset nnz() const { return nnz_; }
+    const std::vector<Ordinal> &bounds() const { return bounds_; }
+    bool dense(int t) const { return cols_[t].empty(); }
+    Ordinal lo(int t) const { return lo_[t]; }
+    const std::vector<Ordinal> &cols(int t) const { return cols_[t]; }
+    std::vector<Acc> &buffer(int t) { return buf_[t]; }
+
+    // buffer slots over all threads, each written by the first pass and read by the second
+    size_t num_buffered() const
+    {
+        size_t n = 0;
+        for (const std::vector<Acc> &b : buf_)
+        {
+            n += b.size();
+        }
+        return n;
+    }
+};
+
+// the buffer slot of column j: in a buffer over a range starting at lo, or among sorted columns
+template <typename Ordinal>
+struct RangeSlot
+{
+    Ordinal lo;
+    size_t operator()(Ordinal j) const { return size_t(j - lo); }
+};
+template <typename Ordinal>
+struct SearchSlot
+{
+    const Ordinal *begin, *end;
+    size_t operator()(Ordinal j) const { return size_t(std::lower_bound(begin, end, j) - begin); }
+};
+
+/* the stored triangle of rows [lb, ub) times x: rows and mirrored columns in [lb, ub) go straight
+   to y, other mirrored columns j to b[slot(j)]. Sym is a template parameter so mirror() is
+   resolved outside the loop
+*/
+template <Info::Symmetry Sym, typename Ordinal, typename Scalar, typename Offset, typename Acc, typename Slot, typename YVec,
+          typename XVec>
+void spmv_triangle(YVec &y, Acc *b, Slot slot, const Offset *rowPtr, const Ordinal *colInd, const Scalar *val, const XVec &x,
+                   Ordinal lb, Ordinal ub)
+{
+    for (Ordinal i = lb; i < ub; ++i)
+    {
+        y[i] = 0;
+    }
+    for (Ordinal i = lb; i < ub; ++i)
+    {
+        Acc acc = 0;
+        const Acc xi = x[i];
+        for (Offset k = rowPtr[i]; k < rowPtr[i + 1]; ++k)
+        {
+            const Ordinal j = colInd[k];
+            acc += val[k] * x[j];
+            if (j == i)
+            {
+                continue;
+            }
+            const Acc m = mirror(Sym, Acc(val[k])) * xi;
+            if (j >= lb && j < ub)
+            {
+                y[j] += m;
+            }
+            else
+            {
+                b[slot(j)] += m;
+            }
+        }
+        y[i] += acc;
+    }
+}
+
+/* block t of s, with its kind of buffer
+ */
+template <Info::Symmetry Sym, typename Ordinal, typename Scalar, typename Offset, typename Acc, typename YVec, typename XVec>
+void spmv_triangle(YVec &y, SymmetricSpmvSchedule<Ordinal, Acc, Offset> &s, int t, const Offset *rowPtr, const Ordinal *colInd,
+                   const Scalar *val, const XVec &x)
+{
+    const Ordinal lb = s.bounds()[t], ub = s.bounds()[t + 1];
+    Acc *b = s.buffer(t).data();
+    if (s.dense(t))
+    {
+        spmv_triangle<Sym>(y, b, RangeSlot<Ordinal>{s.lo(t)}, rowPtr, colInd, val, x, lb, ub);
+    }
+    else
+    {
+        const Ordinal *cb = s.cols(t).data();
+        spmv_triangle<Sym>(y, b, SearchSlot<Ordinal>{cb, cb + s.cols(t).size()}, rowPtr, colInd, val, x, lb, ub);
+    }
+}
+
+/* y = A x for one stored triangle, one thread per row block of s.
+
+   Entry (i,j,v) adds v x[j] to y[i] and mirror(v) x[i] to y[j]. Each thread writes its own rows of
+   y, and buffers the mirrored terms for other rows, which a second pass sums into y over the same
+   row blocks, so no two threads ever write the same element.
+*/
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc, typename Acc, typename YVec, typename XVec>
+void spmv_symmetric(YVec &y, const CSR<Ordinal, Scalar, Offset, Alloc> &a, const XVec &x, SymmetricSpmvSchedule<Ordinal, Acc, Offset> &s)
+{
+    if (s.bounds().back() != a.num_rows() || s.nnz() != a.nnz())
+    {
+        throw std::logic_error("spmv_symmetric: schedule was built for a different structure");
+    }
+    const Info::Symmetry sym = a.symmetry();
+    const Offset *rowPtr = a.row_ptr().data();
+    const Ordinal *colInd = a.col_ind().data();
+    const Scalar *val = a.val().data();
+    const std::vector<Ordinal> &bounds = s.bounds();
+    const int nt = s.num_threads();
+
+    parallel_run(nt, [&](int t)
+                 {
+        std::fill(s.buffer(t).begin(), s.buffer(t).end(), Acc(0));
+        switch (sym) {
+        case Info::Symmetry::SKEW:
+            spmv_triangle<Info::Symmetry::SKEW>(y, s, t, rowPtr, colInd, val, x);
+            break;
+        case Info::Symmetry::HERMITIAN:
+            spmv_triangle<Info::Symmetry::HERMITIAN>(y, s, t, rowPtr, colInd, val, x);
+            break;
+        case Info::Symmetry::unknown:
+        case Info::Symmetry::GENERAL:
+        case Info::Symmetry::SYMMETRIC:
+            spmv_triangle<Info::Symmetry::SYMMETRIC>(y, s, t, rowPtr, colInd, val, x);
+            break;
+        } });
+
+    if (0 == s.num_buffered())
+    {
+        return;
+    }
+    parallel_run(nt, [&](int t)
+                 {
+        const Ordinal lb = bounds[t], ub = bounds[t + 1];
+        for (int u = 0; u < nt; ++u) {
+            const std::vector<Acc> &buf = s.buffer(u);
+            if (s.dense(u)) {
+                const Ordinal l = std::max(lb, s.lo(u)), h = std::min(ub, Ordinal(s.lo(u) + Ordinal(buf.size())));
+                for (Ordinal i = l; i < h; ++i) {
+                    y[i] += buf[i - s.lo(u)];
+                }
+            } else {
+                const std::vector<Ordinal> &c = s.cols(u);
+                const size_t pb = std::lower_bound(c.begin(), c.end(), lb) - c.begin();
+                const size_t pe = std::lower_bound(c.begin() + pb, c.end(), ub) - c.begin();
+                for (size_t p = pb; p < pe; ++p) {
+                    y[c[p]] += buf[p];
+                }
+            }
+        } });
+}
+
+/* y = A x for one stored triangle, building a schedule for bounds on every call.
+   Repeated products should build a SymmetricSpmvSchedule once
+*/
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc, typename YVec, typename XVec>
+void spmv_symmetric(YVec &y, const CSR<Ordinal, Scalar, Offset, Alloc> &a, const XVec &x, const std::vector<Ordinal> &bounds)
+{
+    typedef typename std::decay<decltype(a.val()[0] * x[0])>::type acc_t;
+    SymmetricSpmvSchedule<Ordinal, acc_t, Offset> s(a, bounds);
+    spmv_symmetric(y, a, x, s);
+}
+
+/* y = A x, one thread per row block.
+   Symmetric storage goes to spmv_symmetric
+ */
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc, typename YVec, typename XVec>
+void spmv(YVec &y, const CSR<Ordinal, Scalar, Offset, Alloc> &a, const XVec &x, const std::vector<Ordinal> &bounds)
+{
+    if (bounds.size() < 2 || bounds.front() != 0 || bounds.back() != a.num_rows())
+    {
+        throw std::logic_error("spmv: bounds must cover every row");
+    }
+    if (a.symmetry() != Info::Symmetry::GENERAL)
+    {
+        spmv_symmetric(y, a, x, bounds);
+        return;
+    }
+    const Offset *rowPtr = a.row_ptr().data();
+    const Ordinal *colInd = a.col_ind().data();
+    const Scalar *val = a.val().data();
+    // accumulate in the type of val * x, so narrow values times a double x are summed in double
+    typedef typename std::decay<decltype(val[0] * x[0])>::type acc_t;
+    parallel_run(int(bounds.size() - 1), [&](int t)
+                 {
+        for (Ordinal i = bounds[t]; i < bounds[t + 1]; ++i) {
+            acc_t acc = 0;
+            for (Offset k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+                acc += val[k] * x[colInd[k]];
+            }
+            y[i] = acc;
+        } });
+}
+
+/* y = A x, with rows split by balanced_row_blocks(a, num_threads())
+ */
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc, typename YVec, typename XVec>
+void spmv(YVec &y, const CSR<Ordinal, Scalar, Offset, Alloc> &a, const XVec &x)
+{
+    spmv(y, a, x, balanced_row_blocks(a, num_threads()));
+}
+
+/* CSR arrays of nRows rows and nnz entries, allocated from alloc but written only in parallel:
+   thread t writes row pointers bounds[t]...bounds[t+1] and the entries of its rows,
+   copying them with copy_rows(rowPtr, colInd, val, lb, ub).
+   Use an allocator that does not initialize, like DefaultInitAllocator, or the pages are
+   touched by the calling thread when the arrays are sized.
+*/
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc, typename F>
+CSR<Ordinal, Scalar, Offset, Alloc> first_touch_fill(Ordinal nCols, Ordinal nRows, Offset nnz, const std::vector<Ordinal> &bounds,
+                                                     const Alloc &alloc, F copy_rows)
+{
+    typedef CSR<Ordinal, Scalar, Offset, Alloc> csr_t;
+    typename csr_t::row_ptr_type rowPtr(alloc);
+    typename csr_t::col_ind_type colInd(alloc);
+    typename csr_t::val_type val(alloc);
+    rowPtr.resize(nRows + 1);
+    colInd.resize(nnz);
+    val.resize(nnz);
+
+    parallel_run(int(bounds.size() - 1), [&](int t)
+                 { copy_rows(rowPtr, colInd, val, bounds[t], bounds[t + 1]); });
+    rowPtr[nRows] = nnz;
+    return csr_t(nCols, std::move(rowPtr), std::move(colInd), std::move(val));
+}
+
+/* a copy of a whose rows in each block of bounds were first written by that block's thread
+ */
+template <typename Ordinal, typename Scalar, typename Offset, typename SrcAlloc, typename Alloc = DefaultInitAllocator<char>>
+CSR<Ordinal, Scalar, Offset, Alloc> first_touch_copy(const CSR<Ordinal, Scalar, Offset, SrcAlloc> &a,
+                                                     const std::vector<Ordinal> &bounds,
+                                                     const Alloc &alloc = Alloc())
+{
+    if (bounds.size() < 2 || bounds.front() != 0 || bounds.back() != a.num_rows())
+    {
+        throw std::logic_error("first_touch_copy: bounds must cover every row");
+    }
+    CSR<Ordinal, Scalar, Offset, Alloc> b = first_touch_fill<Ordinal, Scalar, Offset>(
+        a.num_cols(), a.num_rows(), a.nnz(), bounds, alloc,
+        [&a](typename CSR<Ordinal, Scalar, Offset, Alloc>::row_ptr_type &rowPtr,
+             typename CSR<Ordinal, Scalar, Offset, Alloc>::col_ind_type &colInd,
+             typename CSR<Ordinal, Scalar, Offset, Alloc>::val_type &val, Ordinal lb, Ordinal ub)
+        {
+            std::copy(a.row_ptr().begin() + lb, a.row_ptr().begin() + ub, rowPtr.begin() + lb);
+            const Offset kb = a.row_ptr()[lb], ke = a.row_ptr()[ub];
+            std::copy(a.col_ind().begin() + kb, a.col_ind().begin() + ke, colInd.begin() + kb);
+            std::copy(a.val().begin() + kb, a.val().begin() + ke, val.begin() + kb);
+        });
+    b.set_symmetry(a.symmetry());
+    return b;
+}
+
+/* CSR of coo built for nThreads threads, with the row blocks it used written to bounds
+   (balanced_row_blocks of the result). Each thread first writes the arrays of its own rows.
+   The sorted copy of the entries is temporary and uses the default allocator.
+*/
+template <typename Ordinal, typename Scalar, typename Offset, typename CooAlloc, typename Alloc = DefaultInitAllocator<char>>
+CSR<Ordinal, Scalar, Offset, Alloc> first_touch_csr(const COO<Ordinal, Scalar, Offset, CooAlloc> &coo,
+                                                    std::vector<Ordinal> &bounds,
+                                                    const int nThreads = num_threads(),
+                                                    const Alloc &alloc = Alloc())
+{
+    typedef typename COO<Ordinal, Scalar, Offset, CooAlloc>::entry_type entry_t;
+    std::vector<entry_t> sorted(coo.entries.begin(), coo.entries.end());
+    std::sort(sorted.begin(), sorted.end(), entry_t::by_ij);
+
+    std::vector<Offset> rowPtr(coo.num_rows() + 1, 0);
+    for (const entry_t &e : sorted)
+    {
+        ++rowPtr[e.i + 1];
+    }
+    for (Ordinal i = 0; i < coo.num_rows(); ++i)
+    {
+        rowPtr[i + 1] += rowPtr[i];
+    }
+    bounds = balanced_row_blocks<Ordinal>(rowPtr, nThreads);
+
+    CSR<Ordinal, Scalar, Offset, Alloc> a = first_touch_fill<Ordinal, Scalar, Offset>(
+        coo.num_cols(), coo.num_rows(), Offset(sorted.size()), bounds, alloc,
+        [&](typename CSR<Ordinal, Scalar, Offset, Alloc>::row_ptr_type &dstRowPtr,
+            typename CSR<Ordinal, Scalar, Offset, Alloc>::col_ind_type &colInd,
+            typename CSR<Ordinal, Scalar, Offset, Alloc>::val_type &val, Ordinal lb, Ordinal ub)
+        {
+            std::copy(rowPtr.begin() + lb, rowPtr.begin() + ub, dstRowPtr.begin() + lb);
+            for (Offset k = rowPtr[lb]; k < rowPtr[ub]; ++k)
+            {
+                colInd[k] = sorted[k].j;
+                val[k] = sorted[k].e;
+            }
+        });
+    a.set_symmetry(coo.symmetry());
+    return a;
+}
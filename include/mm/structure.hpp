@@ -0,0 +1,212 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#pragma once
+
+#include "mm/mm.hpp"
+#include "mm/parallel.hpp"
+#include "mm/partition.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+/* Structure of the graph of a matrix, for choosing a reordering or a partitioning.
+
+   connected_components() unites the row and column of every entry, so a square matrix is
+   the undirected graph of A + A^T, and the rows and columns of a rectangular matrix are
+   separate vertices (its bipartite graph). Threads unite their share of the entries in one
+   shared ConcurrentUnionFind, without locks.
+
+   structural_symmetry() is the fraction of off-diagonal entries (i, j) for which (j, i) is
+   also stored, found by a binary search of sorted row j.
+*/
+
+/* disjoint sets of 0...n-1 that many threads may unite and find at once.
+
+   A root is only ever linked under a smaller root, with a compare-and-swap that fails and is
+   retried if another thread changed that root first, so parent[x] <= x and there are no cycles.
+   find() halves the path it walks; a halving that loses a race only leaves a longer path
+*/
+template <typename Ordinal>
+class ConcurrentUnionFind
+{
+    std::vector<std::atomic<Ordinal>> parent_;
+
+public:
+    explicit ConcurrentUnionFind(Ordinal n, int nThreads = num_threads()) : parent_(n)
+    {
+        parallel_for(Ordinal(0), n, [&](int, Ordinal lb, Ordinal ub)
+                     {
+            for (Ordinal x = lb; x < ub; ++x) {
+                parent_[x].store(x, std::memory_order_relaxed);
+            } },
+                     nThreads);
+    }
+
+    Ordinal size() const { return Ordinal(parent_.size()); }
+
+    // the root of x's set
+    Ordinal find(Ordinal x)
+    {
+        while (true)
+        {
+            Ordinal p = parent_[x].load(std::memory_order_relaxed);
+            if (p == x)
+            {
+                return x;
+            }
+            const Ordinal gp = parent_[p].load(std::memory_order_relaxed);
+            if (gp != p)
+            {
+                parent_[x].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+            }
+            x = gp;
+        }
+    }
+
+    // join the sets of a and b
+    void unite(Ordinal a, Ordinal b)
+    {
+        while (true)
+        {
+            a = find(a);
+            b = find(b);
+            if (a == b)
+            {
+                return;
+            }
+            if (a > b)
+            {
+                std::swap(a, b);
+            }
+            Ordinal expected = b;
+            if (parent_[b].compare_exchange_strong(expected, a))
+            {
+                return;
+            }
+        }
+    }
+};
+
+template <typename Ordinal>
+struct Components
+{
+    std::vector<Ordinal> label; // the component of each vertex, numbered in order of their smallest vertex
+    std::vector<Ordinal> size;  // vertices in each component
+
+    Ordinal count() const { return Ordinal(size.size()); }
+    Ordinal largest() const { return size.empty() ? 0 : *std::max_element(size.begin(), size.end()); }
+};
+
+/* the components of a union-find that unite(uf, t) has filled, thread t uniting its share
+ */
+template <typename Ordinal, typename Unite>
+Components<Ordinal> collect_components(Ordinal n, int nThreads, Unite unite)
+{
+    ConcurrentUnionFind<Ordinal> uf(n, nThreads);
+    parallel_run(nThreads, [&](int t)
+                 { unite(uf, t); });
+
+    Components<Ordinal> c;
+    c.label.resize(n);
+    parallel_for(Ordinal(0), n, [&](int, Ordinal lb, Ordinal ub)
+                 {
+        for (Ordinal v = lb; v < ub; ++v) {
+            c.label[v] = uf.find(v);
+        } },
+                 nThreads);
+    // a root is the smallest vertex of its set, so it is numbered before any vertex that refers to it
+    for (Ordinal v = 0; v < n; ++v)
+    {
+        if (c.label[v] == v)
+        {
+            c.label[v] = c.count();
+            c.size.push_back(0);
+        }
+        else
+        {
+            c.label[v] = c.label[c.label[v]];
+        }
+        ++c.size[c.label[v]];
+    }
+    return c;
+}
+
+/* vertices of the graph of an nrows x ncols matrix, and the vertex of column j
+ */
+template <typename Ordinal>
+Ordinal num_graph_vertices(Ordinal nrows, Ordinal ncols) { return nrows == ncols ? nrows : nrows + ncols; }
+template <typename Ordinal>
+Ordinal column_vertex(Ordinal nrows, Ordinal ncols, Ordinal j) { return nrows == ncols ? j : nrows + j; }
+
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+Components<Ordinal> connected_components(const COO<Ordinal, Scalar, Offset, Alloc> &a, int nThreads = num_threads())
+{
+    const Ordinal nr = a.num_rows(), nc = a.num_cols();
+    const size_t nnz = a.entries.size();
+    nThreads = std::max(1, nThreads);
+    return collect_components(num_graph_vertices(nr, nc), nThreads, [&](ConcurrentUnionFind<Ordinal> &uf, int t)
+                              {
+        for (size_t k = nnz * t / nThreads; k < nnz * (t + 1) / nThreads; ++k) {
+            uf.unite(a.entries[k].i, column_vertex(nr, nc, a.entries[k].j));
+        } });
+}
+
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+Components<Ordinal> connected_components(const CSR<Ordinal, Scalar, Offset, Alloc> &a, int nThreads = num_threads())
+{
+    const Ordinal nr = a.num_rows(), nc = a.num_cols();
+    nThreads = std::max(1, nThreads);
+    const std::vector<Ordinal> bounds = balanced_row_blocks(a, nThreads);
+    return collect_components(num_graph_vertices(nr, nc), nThreads, [&](ConcurrentUnionFind<Ordinal> &uf, int t)
+                              {
+        for (Ordinal i = bounds[t]; i < bounds[t + 1]; ++i) {
+            for (Offset k = a.row_ptr(i); k < a.row_ptr(i + 1); ++k) {
+                uf.unite(i, column_vertex(nr, nc, a.col_ind(k)));
+            }
+        } });
+}
+
+/* the fraction of off-diagonal entries (i, j) of a square a with sorted rows for which (j, i) is
+   stored too. 1 if there are no off-diagonal entries, and for symmetric storage
+*/
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+double structural_symmetry(const CSR<Ordinal, Scalar, Offset, Alloc> &a, int nThreads = num_threads())
+{
+    if (a.num_rows() != a.num_cols())
+    {
+        throw std::logic_error("structural_symmetry: matrix must be square");
+    }
+    if (a.symmetry() != Info::Symmetry::GENERAL)
+    {
+        return 1;
+    }
+    nThreads = std::max(1, nThreads);
+    const std::vector<Ordinal> bounds = balanced_row_blocks(a, nThreads);
+    const Ordinal *colInd = a.col_ind().data();
+    std::vector<uint64_t> offDiag(nThreads, 0), matched(nThreads, 0);
+    parallel_run(nThreads, [&](int t)
+                 {
+        uint64_t o = 0, m = 0;
+        for (Ordinal i = bounds[t]; i < bounds[t + 1]; ++i) {
+            for (Offset k = a.row_ptr(i); k < a.row_ptr(i + 1); ++k) {
+                const Ordinal j = colInd[k];
+                if (j != i) {
+                    ++o;
+                    m += std::binary_search(colInd + a.row_ptr(j), colInd + a.row_ptr(j + 1), i);
+                }
+            }
+        }
+        offDiag[t] = o;
+        matched[t] = m; });
+    uint64_t o = 0, m = 0;
+    for (int t = 0; t < nThreads; ++t)
+    {
+        o += offDiag[t];
+        m += matched[t];
+    }
+    return 0 == o ? 1.0 : double(m) / double(o);
+}
@@ -0,0 +1,210 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#pragma once
+
+#include "mm/mm.hpp"
+#include "mm/parallel.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/* Row/column permutation and submatrix extraction on CSR.
+
+   Each routine makes two multithreaded passes over the selected rows of the source:
+   one to count the entries of each result row, and one to fill them in after a prefix sum.
+   Nothing goes back through COO, so the cost is proportional to the entries that are looked at,
+   plus a per-row sort only where a column relabeling can reorder a row.
+   Results use the allocators of the source's arrays.
+*/
+
+/* a column selection: maps source columns to result columns (-1 if not selected)
+   and says whether that mapping preserves column order
+*/
+template <typename Ordinal>
+struct ColumnMap
+{
+    std::vector<Ordinal> dst;
+    bool monotonic;
+
+    ColumnMap(Ordinal ncols, const std::vector<Ordinal> &cols) : dst(ncols, -1), monotonic(true)
+    {
+        for (size_t c = 0; c < cols.size(); ++c)
+        {
+            if (cols[c] < 0 || cols[c] >= ncols || dst[cols[c]] != -1)
+            {
+                throw std::logic_error("ColumnMap: columns must be unique and in range");
+            }
+            dst[cols[c]] = Ordinal(c);
+            monotonic &= (0 == c || cols[c - 1] < cols[c]);
+        }
+    }
+};
+
+/* B(r, c) = A(rows[r], cols[c]).
+   rows may repeat, cols must be unique
+*/
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+CSR<Ordinal, Scalar, Offset, Alloc> extract(const CSR<Ordinal, Scalar, Offset, Alloc> &a,
+                                            const std::vector<Ordinal> &rows,
+                                            const std::vector<Ordinal> &cols)
+{
+    typedef CSR<Ordinal, Scalar, Offset, Alloc> csr_t;
+    if (a.symmetry() != Info::Symmetry::GENERAL)
+    {
+        throw std::logic_error("extract: needs general storage, see expand()");
+    }
+    const ColumnMap<Ordinal> map(a.num_cols(), cols);
+    const typename csr_t::row_ptr_type &rowPtr = a.row_ptr();
+    const typename csr_t::col_ind_type &colInd = a.col_ind();
+    const typename csr_t::val_type &val = a.val();
+    const Ordinal nRows = Ordinal(rows.size());
+
+    for (const Ordinal &r : rows)
+    {
+        if (r < 0 || r >= a.num_rows())
+        {
+            throw std::logic_error("extract: row out of range");
+        }
+    }
+
+    // count
+    typename csr_t::row_ptr_type bRowPtr(nRows + 1, 0, rowPtr.get_allocator());
+    parallel_for(Ordinal(0), nRows, [&](int, Ordinal lb, Ordinal ub)
+                 {
+        for (Ordinal r = lb; r < ub; ++r) {
+            Offset n = 0;
+            for (Offset k = rowPtr[rows[r]]; k < rowPtr[rows[r] + 1]; ++k) {
+                n += (map.dst[colInd[k]] >= 0);
+            }
+            bRowPtr[r + 1] = n;
+        } });
+    for (Ordinal r = 0; r < nRows; ++r)
+    {
+        bRowPtr[r + 1] += bRowPtr[r];
+    }
+
+    // fill
+    typename csr_t::col_ind_type bColInd(bRowPtr.back(), Ordinal(), colInd.get_allocator());
+    typename csr_t::val_type bVal(bRowPtr.back(), Scalar(), val.get_allocator());
+    parallel_for(Ordinal(0), nRows, [&](int, Ordinal lb, Ordinal ub)
+                 {
+        std::vector<std::pair<Ordinal, Scalar>> row;
+        for (Ordinal r = lb; r < ub; ++r) {
+            Offset dst = bRowPtr[r];
+            for (Offset k = rowPtr[rows[r]]; k < rowPtr[rows[r] + 1]; ++k) {
+                const Ordinal c = map.dst[colInd[k]];
+                if (c >= 0) {
+                    bColInd[dst] = c;
+                    bVal[dst] = val[k];
+                    ++dst;
+                }
+            }
+            if (!map.monotonic) {
+                // relabeled columns may be out of order
+                row.clear();
+                for (Offset k = bRowPtr[r]; k < bRowPtr[r + 1]; ++k) {
+                    row.push_back(std::make_pair(bColInd[k], bVal[k]));
+                }
+                std::sort(row.begin(), row.end(), [](const std::pair<Ordinal, Scalar> &x, const std::pair<Ordinal, Scalar> &y) {
+                    return x.first < y.first;
+                });
+                for (size_t k = 0; k < row.size(); ++k) {
+                    bColInd[bRowPtr[r] + k] = row[k].first;
+                    bVal[bRowPtr[r] + k] = row[k].second;
+                }
+            }
+        } });
+
+    return csr_t(Ordinal(cols.size()), std::move(bRowPtr), std::move(bColInd), std::move(bVal));
+}
+
+/* B = A(rowBegin:rowEnd, colBegin:colEnd), half-open.
+   Each row is located by binary search, so this touches only the entries of the result
+*/
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+CSR<Ordinal, Scalar, Offset, Alloc> extract(const CSR<Ordinal, Scalar, Offset, Alloc> &a,
+                                            const Ordinal rowBegin, const Ordinal rowEnd,
+                                            const Ordinal colBegin, const Ordinal colEnd)
+{
+    typedef CSR<Ordinal, Scalar, Offset, Alloc> csr_t;
+    if (rowBegin < 0 || rowEnd > a.num_rows() || rowBegin > rowEnd || colBegin < 0 || colEnd > a.num_cols() || colBegin > colEnd)
+    {
+        throw std::logic_error("extract: range out of bounds");
+    }
+    if (a.symmetry() != Info::Symmetry::GENERAL)
+    {
+        throw std::logic_error("extract: needs general storage, see expand()");
+    }
+    const typename csr_t::row_ptr_type &rowPtr = a.row_ptr();
+    const typename csr_t::col_ind_type &colInd = a.col_ind();
+    const typename csr_t::val_type &val = a.val();
+    const Ordinal nRows = rowEnd - rowBegin;
+
+    // first and last+1 entry of each source row within the column range
+    std::vector<Offset> first(nRows);
+    typename csr_t::row_ptr_type bRowPtr(nRows + 1, 0, rowPtr.get_allocator());
+    parallel_for(Ordinal(0), nRows, [&](int, Ordinal lb, Ordinal ub)
+                 {
+        for (Ordinal r = lb; r < ub; ++r) {
+            const Ordinal i = rowBegin + r;
+            const Ordinal *b = colInd.data() + rowPtr[i];
+            const Ordinal *e = colInd.data() + rowPtr[i + 1];
+            const Ordinal *lo = std::lower_bound(b, e, colBegin);
+            const Ordinal *hi = std::lower_bound(lo, e, colEnd);
+            first[r] = Offset(lo - colInd.data());
+            bRowPtr[r + 1] = Offset(hi - lo);
+        } });
+    for (Ordinal r = 0; r < nRows; ++r)
+    {
+        bRowPtr[r + 1] += bRowPtr[r];
+    }
+
+    typename csr_t::col_ind_type bColInd(bRowPtr.back(), Ordinal(), colInd.get_allocator());
+    typename csr_t::val_type bVal(bRowPtr.back(), Scalar(), val.get_allocator());
+    parallel_for(Ordinal(0), nRows, [&](int, Ordinal lb, Ordinal ub)
+                 {
+        for (Ordinal r = lb; r < ub; ++r) {
+            const Offset n = bRowPtr[r + 1] - bRowPtr[r];
+            for (Offset k = 0; k < n; ++k) {
+                bColInd[bRowPtr[r] + k] = colInd[first[r] + k] - colBegin;
+                bVal[bRowPtr[r] + k] = val[first[r] + k];
+            }
+        } });
+
+    return csr_t(colEnd - colBegin, std::move(bRowPtr), std::move(bColInd), std::move(bVal));
+}
+
+/* B(i, j) = A(rowPerm[i], colPerm[j]).
+   An empty rowPerm or colPerm means identity, and with an identity colPerm no row is re-sorted
+*/
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+CSR<Ordinal, Scalar, Offset, Alloc> permute(const CSR<Ordinal, Scalar, Offset, Alloc> &a,
+                                            const std::vector<Ordinal> &rowPerm,
+                                            const std::vector<Ordinal> &colPerm)
+{
+    if ((!rowPerm.empty() && Ordinal(rowPerm.size()) != a.num_rows()) || (!colPerm.empty() && Ordinal(colPerm.size()) != a.num_cols()))
+    {
+        throw std::logic_error("permute: permutations must cover every row and column");
+    }
+    std::vector<Ordinal> rows(rowPerm), cols(colPerm);
+    if (rows.empty())
+    {
+        rows.resize(a.num_rows());
+        for (Ordinal i = 0; i < a.num_rows(); ++i)
+        {
+            rows[i] = i;
+        }
+    }
+    if (cols.empty())
+    {
+        cols.resize(a.num_cols());
+        for (Ordinal j = 0; j < a.num_cols(); ++j)
+        {
+            cols[j] = j;
+        }
+    }
+    return extract(a, rows, cols);
+}
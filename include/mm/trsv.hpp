@@ -0,0 +1,216 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#pragma once
+
+#include "mm/mm.hpp"
+#include "mm/parallel.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/* Sparse triangular solves, x = T^-1 b, with level scheduling.
+
+   T is the lower or upper triangle of a CSR with sorted rows. Entries outside the triangle
+   are ignored, so the L and U of an incomplete factorization stored together in one CSR
+   are solved with (LOWER, UNIT) and then (UPPER, NON_UNIT).
+
+   TrsvSchedule analyzes the structure once: row i is in level 1 + the highest level of the
+   rows it depends on, so the rows of one level are independent. It is reused for every solve
+   with the same structure, whatever the values. A solve runs the levels in order with one
+   barrier between them. Runs of levels too small to share between threads are solved by
+   one thread in a single phase, which saves their barriers.
+*/
+
+enum class Triangle
+{
+    LOWER,
+    UPPER
+};
+
+enum class Diagonal
+{
+    UNIT,    // the diagonal is all ones and is not read
+    NON_UNIT // the diagonal is stored
+};
+
+template <typename Ordinal, typename Offset = size_t>
+class TrsvSchedule
+{
+public:
+    /* levels with fewer rows than this per thread are solved serially
+     */
+    static constexpr Ordinal MIN_ROWS_PER_THREAD = 64;
+
+private:
+    Triangle triangle_;
+    Diagonal diagonal_;
+    Offset nnz_;
+    int nThreads_;
+    std::vector<Offset> begin_, end_; // the off-diagonal entries of row i in the triangle
+    std::vector<Offset> diag_;        // the diagonal entry of row i, if NON_UNIT
+    std::vector<Ordinal> levelPtr_;   // rows of level l are order_[levelPtr_[l], levelPtr_[l+1])
+    std::vector<Ordinal> order_;
+    std::vector<Ordinal> phasePtr_; // phase p is levels [phasePtr_[p], phasePtr_[p+1])
+
+public:
+    template <typename Scalar, typename Alloc>
+    TrsvSchedule(const CSR<Ordinal, Scalar, Offset, Alloc> &a, Triangle triangle, Diagonal diagonal, int nThreads = ::num_threads())
+        : triangle_(triangle), diagonal_(diagonal), nnz_(a.nnz()), nThreads_(std::max(1, nThreads))
+    {
+        const Ordinal n = a.num_rows();
+        if (n != a.num_cols())
+        {
+            throw std::logic_error("TrsvSchedule: matrix must be square");
+        }
+        if (a.symmetry() != Info::Symmetry::GENERAL)
+        {
+            throw std::logic_error("TrsvSchedule: needs general storage, see expand()");
+        }
+        const bool lower = Triangle::LOWER == triangle;
+        begin_.resize(n);
+        end_.resize(n);
+        if (Diagonal::NON_UNIT == diagonal)
+        {
+            diag_.resize(n);
+        }
+
+        // the triangle's entries in each row, and the level of each row
+        std::vector<Ordinal> level(n, 0);
+        Ordinal nLevels = 0;
+        for (Ordinal q = 0; q < n; ++q)
+        {
+            const Ordinal i = lower ? q : n - 1 - q;
+            const Offset rb = a.row_ptr(i), re = a.row_ptr(i + 1);
+            const Offset d = Offset(std::lower_bound(a.col_ind().begin() + rb, a.col_ind().begin() + re, i) - a.col_ind().begin());
+            const bool hasDiag = d < re && a.col_ind(d) == i;
+            if (Diagonal::NON_UNIT == diagonal)
+            {
+                if (!hasDiag)
+                {
+                    throw std::logic_error("TrsvSchedule: row " + std::to_string(i) + " has no diagonal entry");
+                }
+                diag_[i] = d;
+            }
+            begin_[i] = lower ? rb : d + hasDiag;
+            end_[i] = lower ? d : re;
+
+            Ordinal l = 0;
+            for (Offset k = begin_[i]; k < end_[i]; ++k)
+            {
+                l = std::max(l, Ordinal(level[a.col_ind(k)] + 1));
+            }
+            level[i] = l;
+            nLevels = std::max(nLevels, Ordinal(l + 1));
+        }
+
+        // rows sorted by level, in order within a level
+        levelPtr_.assign(nLevels + 1, 0);
+        for (Ordinal i = 0; i < n; ++i)
+        {
+            ++levelPtr_[level[i] + 1];
+        }
+        for (Ordinal l = 0; l < nLevels; ++l)
+        {
+            levelPtr_[l + 1] += levelPtr_[l];
+        }
+        order_.resize(n);
+        std::vector<Ordinal> next(levelPtr_.begin(), levelPtr_.end() - 1);
+        for (Ordinal i = 0; i < n; ++i)
+        {
+            order_[next[level[i]]++] = i;
+        }
+
+        // each large level is a phase, and so is each run of small levels
+        phasePtr_.push_back(0);
+        for (Ordinal l = 0; l < nLevels; ++l)
+        {
+            const bool small = levelPtr_[l + 1] - levelPtr_[l] < MIN_ROWS_PER_THREAD * nThreads_;
+            const bool nextSmall = l + 1 < nLevels && levelPtr_[l + 2] - levelPtr_[l + 1] < MIN_ROWS_PER_THREAD * nThreads_;
+            if (!(small && nextSmall))
+            {
+                phasePtr_.push_back(l + 1);
+            }
+        }
+    }
+
+    Triangle triangle() const { return triangle_; }
+    Diagonal diagonal() const { return diagonal_; }
+    int num_threads() const { return nThreads_; }
+    Ordinal num_rows() const { return Ordinal(order_.size()); }
+    Offset nnz() const { return nnz_; }
+    Ordinal num_levels() const { return Ordinal(levelPtr_.size() - 1); }
+    Ordinal num_phases() const { return Ordinal(phasePtr_.size() - 1); }
+
+    const std::vector<Offset> &row_begin() const { return begin_; }
+    const std::vector<Offset> &row_end() const { return end_; }
+    const std::vector<Offset> &diag() const { return diag_; }
+    const std::vector<Ordinal> &level_ptr() const { return levelPtr_; }
+    const std::vector<Ordinal> &order() const { return order_; }
+    const std::vector<Ordinal> &phase_ptr() const { return phasePtr_; }
+};
+
+/* solve T x = b with the triangle and diagonal of s, using s.num_threads() threads.
+   x may be b: row i reads b[i] before it writes x[i]
+*/
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc, typename XVec, typename BVec>
+void trsv(XVec &x, const CSR<Ordinal, Scalar, Offset, Alloc> &a, const BVec &b, const TrsvSchedule<Ordinal, Offset> &s)
+{
+    if (s.num_rows() != a.num_rows() || s.nnz() != a.nnz())
+    {
+        throw std::logic_error("trsv: schedule was built for a different structure");
+    }
+    const Ordinal *colInd = a.col_ind().data();
+    const Scalar *val = a.val().data();
+    const Offset *rb = s.row_begin().data();
+    const Offset *re = s.row_end().data();
+    const Offset *diag = s.diag().data();
+    const Ordinal *order = s.order().data();
+    const Ordinal *levelPtr = s.level_ptr().data();
+    const Ordinal *phasePtr = s.phase_ptr().data();
+    const bool unit = Diagonal::UNIT == s.diagonal();
+    typedef typename std::decay<decltype(val[0] * x[0])>::type acc_t;
+
+    auto solve_row = [&](Ordinal i)
+    {
+        acc_t acc = b[i];
+        for (Offset k = rb[i]; k < re[i]; ++k)
+        {
+            acc -= val[k] * x[colInd[k]];
+        }
+        x[i] = unit ? acc : acc / val[diag[i]];
+    };
+
+    const int nt = s.num_threads();
+    SpinBarrier barrier(nt);
+    parallel_run(nt, [&](int t)
+                 {
+        for (Ordinal p = 0; p < s.num_phases(); ++p) {
+            const Ordinal lb = levelPtr[phasePtr[p]], ub = levelPtr[phasePtr[p + 1]];
+            if (phasePtr[p + 1] - phasePtr[p] > 1 || nt == 1) {
+                // a run of small levels, in order on one thread
+                if (0 == t) {
+                    for (Ordinal q = lb; q < ub; ++q) {
+                        solve_row(order[q]);
+                    }
+                }
+            } else {
+                const Ordinal n = ub - lb;
+                for (Ordinal q = lb + Ordinal(int64_t(n) * t / nt); q < lb + Ordinal(int64_t(n) * (t + 1) / nt); ++q) {
+                    solve_row(order[q]);
+                }
+            }
+            barrier.wait();
+        } });
+}
+
+/* solve T x = b once, analyzing T first. Keep a TrsvSchedule to solve repeatedly
+ */
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc, typename XVec, typename BVec>
+void trsv(XVec &x, const CSR<Ordinal, Scalar, Offset, Alloc> &a, const BVec &b, Triangle triangle, Diagonal diagonal)
+{
+    trsv(x, a, b, TrsvSchedule<Ordinal, Offset>(a, triangle, diagonal));
+}
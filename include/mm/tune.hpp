@@ -0,0 +1,409 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#pragma once
+
+#include "mm/blocked.hpp"
+#include "mm/compressed.hpp"
+#include "mm/mm.hpp"
+#include "mm/parallel.hpp"
+#include "mm/partition.hpp"
+#include "mm/spmv.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+/* Choosing the SpMV layout of a matrix by timing it.
+
+   tune_spmv() measures a few cheap features of a CSR, uses them to drop candidates that cannot
+   win, and times short SpMV trials of the rest: CSR, CompressedCSR with 16- or 8-bit column
+   deltas, and BlockedCSR for matrices too wide for x to stay in cache, each on one thread and
+   on all of them. The fastest is returned as an SpmvDecision,
+   which TunedSpmv builds and applies.
+
+   A decision depends only on the structure of the matrix, the types it is stored in, and the
+   machine, so it is cached in a text file keyed by spmv_tune_key(), and later runs on the same
+   structure skip the trials.
+*/
+
+enum class SpmvFormat
+{
+    CSR,
+    COMPRESSED16, // CompressedCSR<..., uint16_t>
+    COMPRESSED8,  // CompressedCSR<..., uint8_t>
+    BLOCKED       // BlockedCSR with the default tile and panel
+};
+
+inline const char *to_string(SpmvFormat f)
+{
+    switch (f)
+    {
+    case SpmvFormat::CSR:
+        return "csr";
+    case SpmvFormat::COMPRESSED16:
+        return "compressed16";
+    case SpmvFormat::COMPRESSED8:
+        return "compressed8";
+    case SpmvFormat::BLOCKED:
+        return "blocked";
+    }
+    return "unknown";
+}
+
+inline SpmvFormat spmv_format_from_string(const std::string &s)
+{
+    for (SpmvFormat f : {SpmvFormat::CSR, SpmvFormat::COMPRESSED16, SpmvFormat::COMPRESSED8, SpmvFormat::BLOCKED})
+    {
+        if (s == to_string(f))
+        {
+            return f;
+        }
+    }
+    throw std::logic_error("spmv_format_from_string: unknown format " + s);
+}
+
+/* what tune_spmv prunes candidates by
+ */
+struct SpmvFeatures
+{
+    double rowMean;     // entries per row, which a compressed layout's base column per row is spread over
+    uint64_t bandwidth; // max |i - j|, how far x is read from the diagonal
+    double rowSpan;     // mean last - first column of a nonempty row, which 8-bit deltas must mostly cover
+
+    SpmvFeatures() : rowMean(0), bandwidth(0), rowSpan(0) {}
+};
+
+/* features of a, which has sorted rows, from its row pointers and the ends of its rows
+ */
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+SpmvFeatures spmv_features(const CSR<Ordinal, Scalar, Offset, Alloc> &a)
+{
+    SpmvFeatures f;
+    const Ordinal n = a.num_rows();
+    if (0 == n)
+    {
+        return f;
+    }
+    f.rowMean = double(a.nnz()) / n;
+    uint64_t nonEmpty = 0;
+    double span = 0;
+    for (Ordinal i = 0; i < n; ++i)
+    {
+        const Offset b = a.row_ptr(i), e = a.row_ptr(i + 1);
+        if (b != e)
+        {
+            ++nonEmpty;
+            span += double(a.col_ind(e - 1) - a.col_ind(b));
+            f.bandwidth = std::max(f.bandwidth, uint64_t(std::max(i - a.col_ind(b), a.col_ind(e - 1) - i)));
+        }
+    }
+    f.rowSpan = nonEmpty ? span / nonEmpty : 0;
+    return f;
+}
+
+// one step of FNV-1a over 64-bit words
+inline void fnv1a_mix(uint64_t &h, uint64_t w)
+{
+    h ^= w;
+    h *= 1099511628211ull;
+}
+
+/* a hash of the shape, row pointers, and column indices of a, which are all of a matrix that SpMV speed depends on
+ */
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+uint64_t spmv_fingerprint(const CSR<Ordinal, Scalar, Offset, Alloc> &a)
+{
+    uint64_t h = 14695981039346656037ull;
+    fnv1a_mix(h, uint64_t(a.num_rows()));
+    fnv1a_mix(h, uint64_t(a.num_cols()));
+    fnv1a_mix(h, uint64_t(a.nnz()));
+    for (const Offset &p : a.row_ptr())
+    {
+        fnv1a_mix(h, uint64_t(p));
+    }
+    for (const Ordinal &j : a.col_ind())
+    {
+        fnv1a_mix(h, uint64_t(j));
+    }
+    return h;
+}
+
+/* spmv_fingerprint(a), extended by what else a decision depends on: the sizes of a's types, the
+   threads the trials may use, and the L2 size, which tells machines apart
+*/
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+uint64_t spmv_tune_key(const CSR<Ordinal, Scalar, Offset, Alloc> &a, int maxThreads)
+{
+    uint64_t h = spmv_fingerprint(a);
+    fnv1a_mix(h, sizeof(Ordinal));
+    fnv1a_mix(h, sizeof(Scalar));
+    fnv1a_mix(h, sizeof(Offset));
+    fnv1a_mix(h, uint64_t(maxThreads));
+    fnv1a_mix(h, l2_cache_bytes());
+    return h;
+}
+
+struct SpmvDecision
+{
+    uint64_t key; // spmv_tune_key of the matrix it was made for
+    SpmvFormat format;
+    int threads;
+    double seconds; // of one SpMV in the trials
+    bool cached;    // read from the cache instead of timed
+
+    SpmvDecision() : key(0), format(SpmvFormat::CSR), threads(1), seconds(0), cached(false) {}
+};
+
+/* decisions saved in a text file, one per line: key format threads seconds
+ */
+class SpmvTuneCache
+{
+    std::map<uint64_t, SpmvDecision> decisions_;
+
+public:
+    // add the decisions in path, return false if it could not be read
+    bool load(const std::string &path)
+    {
+        std::ifstream inf(path);
+        if (!inf)
+        {
+            return false;
+        }
+        std::string line;
+        while (std::getline(inf, line))
+        {
+            std::istringstream ss(line);
+            SpmvDecision d;
+            std::string format;
+            if (ss >> d.key >> format >> d.threads >> d.seconds)
+            {
+                try
+                {
+                    d.format = spmv_format_from_string(format);
+                }
+                catch (const std::logic_error &)
+                {
+                    continue; // written by a version with other formats
+                }
+                d.cached = true;
+                decisions_[d.key] = d;
+            }
+        }
+        return true;
+    }
+
+    /* write every decision to path, return false if it could not be written.
+       The file is written beside path and renamed over it, so a reader never sees it half written
+    */
+    bool save(const std::string &path) const
+    {
+        const std::string tmp = path + ".tmp" + std::to_string(getpid());
+        {
+            std::ofstream outf(tmp);
+            outf.precision(6);
+            for (const std::pair<const uint64_t, SpmvDecision> &kv : decisions_)
+            {
+                const SpmvDecision &d = kv.second;
+                outf << d.key << " " << to_string(d.format) << " " << d.threads << " " << d.seconds << "\n";
+            }
+            outf.close();
+            if (!outf)
+            {
+                std::remove(tmp.c_str());
+                return false;
+            }
+        }
+        if (0 != std::rename(tmp.c_str(), path.c_str()))
+        {
+            std::remove(tmp.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    const SpmvDecision *find(uint64_t key) const
+    {
+        const auto it = decisions_.find(key);
+        return it == decisions_.end() ? nullptr : &it->second;
+    }
+
+    void insert(const SpmvDecision &d) { decisions_[d.key] = d; }
+    size_t size() const { return decisions_.size(); }
+};
+
+/* y = A x in the layout of an SpmvDecision. Keeps a reference to a, which must outlive it
+ */
+template <typename Ordinal, typename Scalar, typename Offset = size_t, typename Alloc = std::allocator<char>>
+class TunedSpmv
+{
+public:
+    typedef CSR<Ordinal, Scalar, Offset, Alloc> csr_type;
+
+private:
+    const csr_type &a_;
+    SpmvDecision decision_;
+    std::unique_ptr<CompressedCSR<Ordinal, Scalar, Offset, uint16_t>> c16_;
+    std::unique_ptr<CompressedCSR<Ordinal, Scalar, Offset, uint8_t>> c8_;
+    std::unique_ptr<BlockedCSR<Ordinal, Scalar, Offset, Alloc>> blocked_;
+    std::vector<Ordinal> bounds_;
+
+public:
+    TunedSpmv(const csr_type &a, const SpmvDecision &decision) : a_(a), decision_(decision)
+    {
+        const int nt = std::max(1, decision.threads);
+        switch (decision.format)
+        {
+        case SpmvFormat::CSR:
+            bounds_ = balanced_row_blocks(a, nt);
+            break;
+        case SpmvFormat::COMPRESSED16:
+            c16_.reset(new CompressedCSR<Ordinal, Scalar, Offset, uint16_t>(a));
+            bounds_ = balanced_row_blocks(*c16_, nt);
+            break;
+        case SpmvFormat::COMPRESSED8:
+            c8_.reset(new CompressedCSR<Ordinal, Scalar, Offset, uint8_t>(a));
+            bounds_ = balanced_row_blocks(*c8_, nt);
+            break;
+        case SpmvFormat::BLOCKED:
+            blocked_.reset(new BlockedCSR<Ordinal, Scalar, Offset, Alloc>(a));
+            bounds_ = balanced_row_blocks(*blocked_, nt);
+            break;
+        }
+    }
+
+    const SpmvDecision &decision() const { return decision_; }
+
+    template <typename YVec, typename XVec>
+    void apply(YVec &y, const XVec &x) const
+    {
+        switch (decision_.format)
+        {
+        case SpmvFormat::CSR:
+            return spmv(y, a_, x, bounds_);
+        case SpmvFormat::COMPRESSED16:
+            return spmv(y, *c16_, x, bounds_);
+        case SpmvFormat::COMPRESSED8:
+            return spmv(y, *c8_, x, bounds_);
+        case SpmvFormat::BLOCKED:
+            return spmv(y, *blocked_, x, bounds_);
+        }
+    }
+};
+
+struct SpmvTuneOptions
+{
+    int trials;              // timed SpMVs per candidate, after one untimed
+    int maxThreads;          // the multithreaded candidates use this many threads
+    uint64_t minParallelNnz; // matrices with fewer entries only try one thread
+    double maxSpan8;         // 8-bit deltas are only tried up to this mean row span (rowSpan)
+    uint64_t minBlockedCols; // BlockedCSR is only tried with more columns and bandwidth than this; 0 is one x tile's worth
+    std::string cachePath;   // if not empty, decisions are read from and added to this file
+
+    SpmvTuneOptions() : trials(5), maxThreads(num_threads()), minParallelNnz(1 << 15), maxSpan8(4.0 * 255), minBlockedCols(0) {}
+};
+
+/* the fastest layout for y = A x among those the features allow, or the cached decision for
+   a's structure. a needs general storage and sorted rows.
+   A compressed layout is only tried if its deltas save more index bytes per row than its base
+   column costs, 8-bit deltas only up to maxSpan8, and BlockedCSR only if rows reach further
+   from the diagonal than one x tile, since otherwise the x a panel reads already fits in cache
+*/
+template <typename Ordinal, typename Scalar, typename Offset, typename Alloc>
+SpmvDecision tune_spmv(const CSR<Ordinal, Scalar, Offset, Alloc> &a, const SpmvTuneOptions &opts = SpmvTuneOptions(),
+                       SpmvFeatures *features = nullptr)
+{
+    if (a.symmetry() != Info::Symmetry::GENERAL)
+    {
+        throw std::logic_error("tune_spmv: needs general storage, see expand()");
+    }
+    const uint64_t key = spmv_tune_key(a, opts.maxThreads);
+    if (!opts.cachePath.empty())
+    {
+        SpmvTuneCache cache;
+        cache.load(opts.cachePath);
+        if (const SpmvDecision *d = cache.find(key))
+        {
+            return *d;
+        }
+    }
+
+    const SpmvFeatures f = spmv_features(a);
+    if (features)
+    {
+        *features = f;
+    }
+    std::vector<SpmvFormat> formats = {SpmvFormat::CSR};
+    auto saves = [&](size_t deltaBytes)
+    { return f.rowMean * (double(sizeof(Ordinal)) - double(deltaBytes)) > double(sizeof(Ordinal)); };
+    if (saves(sizeof(uint16_t)))
+    {
+        formats.push_back(SpmvFormat::COMPRESSED16);
+    }
+    if (saves(sizeof(uint8_t)) && f.rowSpan <= opts.maxSpan8)
+    {
+        formats.push_back(SpmvFormat::COMPRESSED8);
+    }
+    const uint64_t minBlockedCols = opts.minBlockedCols ? opts.minBlockedCols : l2_cache_bytes() / 2 / sizeof(Scalar);
+    if (uint64_t(a.num_cols()) > minBlockedCols && f.bandwidth > minBlockedCols)
+    {
+        formats.push_back(SpmvFormat::BLOCKED);
+    }
+    std::vector<int> threads = {1};
+    if (opts.maxThreads > 1 && uint64_t(a.nnz()) >= opts.minParallelNnz)
+    {
+        threads.push_back(opts.maxThreads);
+    }
+
+    std::vector<Scalar> x(a.num_cols(), Scalar(1)), y(a.num_rows());
+    SpmvDecision best;
+    best.key = key;
+    best.seconds = std::numeric_limits<double>::infinity();
+    for (SpmvFormat format : formats)
+    {
+        for (int nt : threads)
+        {
+            SpmvDecision d;
+            d.key = key;
+            d.format = format;
+            d.threads = nt;
+            const TunedSpmv<Ordinal, Scalar, Offset, Alloc> candidate(a, d);
+            candidate.apply(y, x);
+            double fastest = std::numeric_limits<double>::infinity();
+            for (int r = 0; r < std::max(1, opts.trials); ++r)
+            {
+                const auto t0 = std::chrono::steady_clock::now();
+                candidate.apply(y, x);
+                const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+                fastest = std::min(fastest, s);
+            }
+            if (fastest < best.seconds)
+            {
+                best = d;
+                best.seconds = fastest;
+            }
+        }
+    }
+
+    if (!opts.cachePath.empty())
+    {
+        // reload, to keep what other processes added during the trials
+        SpmvTuneCache cache;
+        cache.load(opts.cachePath);
+        cache.insert(best);
+        cache.save(opts.cachePath);
+    }
+    return best;
+}
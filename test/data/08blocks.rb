@@ -0,0 +1,314 @@
+08blocks, 300 x 300, written from 08blocks.mtx                          08blocks
+           310            38            74           198
+rua                      300           300           592             0
+(8I10)          (8I10)          (1P,3D25.16)        
+         1         2         4         6         8        10        12        14
+        16        18        20        22        24        26        28        30
+        32        34        36        38        40        42        44        46
+        48        50        52        54        56        58        60        62
+        64        66        68        70        72        74        75        77
+        79        81        83        85        87        89        91        93
+        95        97        99       101       103       105       107       109
+       111       113       115       117       119       121       123       125
+       127       129       131       133       135       137       139       141
+       143       145       147       148       150       152       154       156
+       158       160       162       164       166       168       170       172
+       174       176       178       180       182       184       186       188
+       190       192       194       196       198       200       202       204
+       206       208       210       212       214       216       218       220
+       221       223       225       227       229       231       233       235
+       237       239       241       243       245       247       249       251
+       253       255       257       259       261       263       265       267
+       269       271       273       275       277       279       281       283
+       285       287       289       291       293       294       296       298
+       300       302       304       306       308       310       312       314
+       316       318       320       322       324       326       328       330
+       332       334       336       338       340       342       344       346
+       348       350       352       354       356       358       360       362
+       364       366       368       369       371       373       375       377
+       379       381       383       385       387       389       391       393
+       395       397       399       401       403       405       407       409
+       411       413       415       417       419       421       423       425
+       427       429       431       433       435       437       439       441
+       443       444       446       448       450       452       454       456
+       458       460       462       464       466       468       470       472
+       474       476       478       480       482       484       486       488
+       490       492       494       496       498       500       502       504
+       506       508       510       512       514       516       518       519
+       521       523       525       527       529       531       533       535
+       537       539       541       543       545       547       549       551
+       553       555       557       559       561       563       565       567
+       569       571       573       575       577       579       581       583
+       585       587       589       591       593
+        37         1        37         2        37         3        37         4
+        37         5        37         6        37         7        37         8
+        37         9        37        10        37        11        37        12
+        37        13        37        14        37        15        37        16
+        37        17        37        18        37        19        37        20
+        37        21        37        22        37        23        37        24
+        37        25        37        26        37        27        37        28
+        37        29        37        30        37        31        37        32
+        37        33        37        34        37        35        37        36
+        37        74        38        74        39        74        40        74
+        41        74        42        74        43        74        44        74
+        45        74        46        74        47        74        48        74
+        49        74        50        74        51        74        52        74
+        53        74        54        74        55        74        56        74
+        57        74        58        74        59        74        60        74
+        61        74        62        74        63        74        64        74
+        65        74        66        74        67        74        68        74
+        69        74        70        74        71        74        72        74
+        73        74       111        75       111        76       111        77
+       111        78       111        79       111        80       111        81
+       111        82       111        83       111        84       111        85
+       111        86       111        87       111        88       111        89
+       111        90       111        91       111        92       111        93
+       111        94       111        95       111        96       111        97
+       111        98       111        99       111       100       111       101
+       111       102       111       103       111       104       111       105
+       111       106       111       107       111       108       111       109
+       111       110       111       148       112       148       113       148
+       114       148       115       148       116       148       117       148
+       118       148       119       148       120       148       121       148
+       122       148       123       148       124       148       125       148
+       126       148       127       148       128       148       129       148
+       130       148       131       148       132       148       133       148
+       134       148       135       148       136       148       137       148
+       138       148       139       148       140       148       141       148
+       142       148       143       148       144       148       145       148
+       146       148       147       148       186       149       186       150
+       186       151       186       152       186       153       186       154
+       186       155       186       156       186       157       186       158
+       186       159       186       160       186       161       186       162
+       186       163       186       164       186       165       186       166
+       186       167       186       168       186       169       186       170
+       186       171       186       172       186       173       186       174
+       186       175       186       176       186       177       186       178
+       186       179       186       180       186       181       186       182
+       186       183       186       184       186       185       186       224
+       187       224       188       224       189       224       190       224
+       191       224       192       224       193       224       194       224
+       195       224       196       224       197       224       198       224
+       199       224       200       224       201       224       202       224
+       203       224       204       224       205       224       206       224
+       207       224       208       224       209       224       210       224
+       211       224       212       224       213       224       214       224
+       215       224       216       224       217       224       218       224
+       219       224       220       224       221       224       222       224
+       223       224       262       225       262       226       262       227
+       262       228       262       229       262       230       262       231
+       262       232       262       233       262       234       262       235
+       262       236       262       237       262       238       262       239
+       262       240       262       241       262       242       262       243
+       262       244       262       245       262       246       262       247
+       262       248       262       249       262       250       262       251
+       262       252       262       253       262       254       262       255
+       262       256       262       257       262       258       262       259
+       262       260       262       261       262       300       263       300
+       264       300       265       300       266       300       267       300
+       268       300       269       300       270       300       271       300
+       272       300       273       300       274       300       275       300
+       276       300       277       300       278       300       279       300
+       280       300       281       300       282       300       283       300
+       284       300       285       300       286       300       287       300
+       288       300       289       300       290       300       291       300
+       292       300       293       300       294       300       295       300
+       296       300       297       300       298       300       299       300
+   9.4000000000000000D+01   1.0000000000000000D+00   3.3000000000000000D+01
+   1.0000000000000000D+00   8.6000000000000000D+01   1.0000000000000000D+00
+   8.1000000000000000D+01   1.0000000000000000D+00   1.3000000000000000D+01
+   1.0000000000000000D+00   1.5000000000000000D+01   1.0000000000000000D+00
+   7.7000000000000000D+01   1.0000000000000000D+00   2.0000000000000000D+01
+   1.0000000000000000D+00   3.0000000000000000D+00   1.0000000000000000D+00
+   6.1000000000000000D+01   1.0000000000000000D+00   5.9000000000000000D+01
+   1.0000000000000000D+00   2.0000000000000000D+00   1.0000000000000000D+00
+   9.1000000000000000D+01   1.0000000000000000D+00   8.1000000000000000D+01
+   1.0000000000000000D+00   7.9000000000000000D+01   1.0000000000000000D+00
+   2.0000000000000000D+01   1.0000000000000000D+00   3.9000000000000000D+01
+   1.0000000000000000D+00   3.7000000000000000D+01   1.0000000000000000D+00
+   4.9000000000000000D+01   1.0000000000000000D+00   2.0000000000000000D+00
+   1.0000000000000000D+00   7.9000000000000000D+01   1.0000000000000000D+00
+   6.9000000000000000D+01   1.0000000000000000D+00   8.0000000000000000D+01
+   1.0000000000000000D+00   6.6000000000000000D+01   1.0000000000000000D+00
+   7.4000000000000000D+01   1.0000000000000000D+00   4.7000000000000000D+01
+   1.0000000000000000D+00   8.4000000000000000D+01   1.0000000000000000D+00
+   5.7000000000000000D+01   1.0000000000000000D+00   9.1000000000000000D+01
+   1.0000000000000000D+00   1.5000000000000000D+01   1.0000000000000000D+00
+   8.8000000000000000D+01   1.0000000000000000D+00   2.1000000000000000D+01
+   1.0000000000000000D+00   1.0000000000000000D+02   1.0000000000000000D+00
+   9.0000000000000000D+00   1.0000000000000000D+00   4.0000000000000000D+01
+   1.0000000000000000D+00   8.7000000000000000D+01   1.0000000000000000D+00
+   9.1000000000000000D+01   9.4000000000000000D+01   1.0000000000000000D+00
+   3.3000000000000000D+01   1.0000000000000000D+00   8.6000000000000000D+01
+   1.0000000000000000D+00   8.1000000000000000D+01   1.0000000000000000D+00
+   1.3000000000000000D+01   1.0000000000000000D+00   1.5000000000000000D+01
+   1.0000000000000000D+00   7.7000000000000000D+01   1.0000000000000000D+00
+   2.0000000000000000D+01   1.0000000000000000D+00   3.0000000000000000D+00
+   1.0000000000000000D+00   6.1000000000000000D+01   1.0000000000000000D+00
+   5.9000000000000000D+01   1.0000000000000000D+00   2.0000000000000000D+00
+   1.0000000000000000D+00   9.1000000000000000D+01   1.0000000000000000D+00
+   8.1000000000000000D+01   1.0000000000000000D+00   7.9000000000000000D+01
+   1.0000000000000000D+00   2.0000000000000000D+01   1.0000000000000000D+00
+   3.9000000000000000D+01   1.0000000000000000D+00   3.7000000000000000D+01
+   1.0000000000000000D+00   4.9000000000000000D+01   1.0000000000000000D+00
+   2.0000000000000000D+00   1.0000000000000000D+00   7.9000000000000000D+01
+   1.0000000000000000D+00   6.9000000000000000D+01   1.0000000000000000D+00
+   8.0000000000000000D+01   1.0000000000000000D+00   6.6000000000000000D+01
+   1.0000000000000000D+00   7.4000000000000000D+01   1.0000000000000000D+00
+   4.7000000000000000D+01   1.0000000000000000D+00   8.4000000000000000D+01
+   1.0000000000000000D+00   5.7000000000000000D+01   1.0000000000000000D+00
+   9.1000000000000000D+01   1.0000000000000000D+00   1.5000000000000000D+01
+   1.0000000000000000D+00   8.8000000000000000D+01   1.0000000000000000D+00
+   2.1000000000000000D+01   1.0000000000000000D+00   1.0000000000000000D+02
+   1.0000000000000000D+00   9.0000000000000000D+00   1.0000000000000000D+00
+   4.0000000000000000D+01   1.0000000000000000D+00   8.7000000000000000D+01
+   1.0000000000000000D+00   9.1000000000000000D+01   9.4000000000000000D+01
+   1.0000000000000000D+00   3.3000000000000000D+01   1.0000000000000000D+00
+   8.6000000000000000D+01   1.0000000000000000D+00   8.1000000000000000D+01
+   1.0000000000000000D+00   1.3000000000000000D+01   1.0000000000000000D+00
+   1.5000000000000000D+01   1.0000000000000000D+00   7.7000000000000000D+01
+   1.0000000000000000D+00   2.0000000000000000D+01   1.0000000000000000D+00
+   3.0000000000000000D+00   1.0000000000000000D+00   6.1000000000000000D+01
+   1.0000000000000000D+00   5.9000000000000000D+01   1.0000000000000000D+00
+   2.0000000000000000D+00   1.0000000000000000D+00   9.1000000000000000D+01
+   1.0000000000000000D+00   8.1000000000000000D+01   1.0000000000000000D+00
+   7.9000000000000000D+01   1.0000000000000000D+00   2.0000000000000000D+01
+   1.0000000000000000D+00   3.9000000000000000D+01   1.0000000000000000D+00
+   3.7000000000000000D+01   1.0000000000000000D+00   4.9000000000000000D+01
+   1.0000000000000000D+00   2.0000000000000000D+00   1.0000000000000000D+00
+   7.9000000000000000D+01   1.0000000000000000D+00   6.9000000000000000D+01
+   1.0000000000000000D+00   8.0000000000000000D+01   1.0000000000000000D+00
+   6.6000000000000000D+01   1.0000000000000000D+00   7.4000000000000000D+01
+   1.0000000000000000D+00   4.7000000000000000D+01   1.0000000000000000D+00
+   8.4000000000000000D+01   1.0000000000000000D+00   5.7000000000000000D+01
+   1.0000000000000000D+00   9.1000000000000000D+01   1.0000000000000000D+00
+   1.5000000000000000D+01   1.0000000000000000D+00   8.8000000000000000D+01
+   1.0000000000000000D+00   2.1000000000000000D+01   1.0000000000000000D+00
+   1.0000000000000000D+02   1.0000000000000000D+00   9.0000000000000000D+00
+   1.0000000000000000D+00   4.0000000000000000D+01   1.0000000000000000D+00
+   8.7000000000000000D+01   1.0000000000000000D+00   9.1000000000000000D+01
+   9.4000000000000000D+01   1.0000000000000000D+00   3.3000000000000000D+01
+   1.0000000000000000D+00   8.6000000000000000D+01   1.0000000000000000D+00
+   8.1000000000000000D+01   1.0000000000000000D+00   1.3000000000000000D+01
+   1.0000000000000000D+00   1.5000000000000000D+01   1.0000000000000000D+00
+   7.7000000000000000D+01   1.0000000000000000D+00   2.0000000000000000D+01
+   1.0000000000000000D+00   3.0000000000000000D+00   1.0000000000000000D+00
+   6.1000000000000000D+01   1.0000000000000000D+00   5.9000000000000000D+01
+   1.0000000000000000D+00   2.0000000000000000D+00   1.0000000000000000D+00
+   9.1000000000000000D+01   1.0000000000000000D+00   8.1000000000000000D+01
+   1.0000000000000000D+00   7.9000000000000000D+01   1.0000000000000000D+00
+   2.0000000000000000D+01   1.0000000000000000D+00   3.9000000000000000D+01
+   1.0000000000000000D+00   3.7000000000000000D+01   1.0000000000000000D+00
+   4.9000000000000000D+01   1.0000000000000000D+00   2.0000000000000000D+00
+   1.0000000000000000D+00   7.9000000000000000D+01   1.0000000000000000D+00
+   6.9000000000000000D+01   1.0000000000000000D+00   8.0000000000000000D+01
+   1.0000000000000000D+00   6.6000000000000000D+01   1.0000000000000000D+00
+   7.4000000000000000D+01   1.0000000000000000D+00   4.7000000000000000D+01
+   1.0000000000000000D+00   8.4000000000000000D+01   1.0000000000000000D+00
+   5.7000000000000000D+01   1.0000000000000000D+00   9.1000000000000000D+01
+   1.0000000000000000D+00   1.5000000000000000D+01   1.0000000000000000D+00
+   8.8000000000000000D+01   1.0000000000000000D+00   2.1000000000000000D+01
+   1.0000000000000000D+00   1.0000000000000000D+02   1.0000000000000000D+00
+   9.0000000000000000D+00   1.0000000000000000D+00   4.0000000000000000D+01
+   1.0000000000000000D+00   8.7000000000000000D+01   1.0000000000000000D+00
+   9.1000000000000000D+01   2.8000000000000000D+01   1.0000000000000000D+00
+   6.3000000000000000D+01   1.0000000000000000D+00   9.3000000000000000D+01
+   1.0000000000000000D+00   6.5000000000000000D+01   1.0000000000000000D+00
+   2.9000000000000000D+01   1.0000000000000000D+00   5.4000000000000000D+01
+   1.0000000000000000D+00   1.0000000000000000D+01   1.0000000000000000D+00
+   9.8000000000000000D+01   1.0000000000000000D+00   8.0000000000000000D+00
+   1.0000000000000000D+00   6.2000000000000000D+01   1.0000000000000000D+00
+   2.7000000000000000D+01   1.0000000000000000D+00   5.1000000000000000D+01
+   1.0000000000000000D+00   4.2000000000000000D+01   1.0000000000000000D+00
+   7.0000000000000000D+01   1.0000000000000000D+00   6.8000000000000000D+01
+   1.0000000000000000D+00   1.0000000000000000D+02   1.0000000000000000D+00
+   6.6000000000000000D+01   1.0000000000000000D+00   9.3000000000000000D+01
+   1.0000000000000000D+00   4.3000000000000000D+01   1.0000000000000000D+00
+   4.1000000000000000D+01   1.0000000000000000D+00   9.0000000000000000D+01
+   1.0000000000000000D+00   5.0000000000000000D+00   1.0000000000000000D+00
+   5.2000000000000000D+01   1.0000000000000000D+00   1.8000000000000000D+01
+   1.0000000000000000D+00   7.3000000000000000D+01   1.0000000000000000D+00
+   8.8000000000000000D+01   1.0000000000000000D+00   1.4000000000000000D+01
+   1.0000000000000000D+00   5.8000000000000000D+01   1.0000000000000000D+00
+   9.7000000000000000D+01   1.0000000000000000D+00   3.1000000000000000D+01
+   1.0000000000000000D+00   6.7000000000000000D+01   1.0000000000000000D+00
+   4.0000000000000000D+00   1.0000000000000000D+00   2.5000000000000000D+01
+   1.0000000000000000D+00   6.4000000000000000D+01   1.0000000000000000D+00
+   5.1000000000000000D+01   1.0000000000000000D+00   9.6000000000000000D+01
+   1.0000000000000000D+00   2.6000000000000000D+01   1.0000000000000000D+00
+   9.5000000000000000D+01   2.8000000000000000D+01   1.0000000000000000D+00
+   6.3000000000000000D+01   1.0000000000000000D+00   9.3000000000000000D+01
+   1.0000000000000000D+00   6.5000000000000000D+01   1.0000000000000000D+00
+   2.9000000000000000D+01   1.0000000000000000D+00   5.4000000000000000D+01
+   1.0000000000000000D+00   1.0000000000000000D+01   1.0000000000000000D+00
+   9.8000000000000000D+01   1.0000000000000000D+00   8.0000000000000000D+00
+   1.0000000000000000D+00   6.2000000000000000D+01   1.0000000000000000D+00
+   2.7000000000000000D+01   1.0000000000000000D+00   5.1000000000000000D+01
+   1.0000000000000000D+00   4.2000000000000000D+01   1.0000000000000000D+00
+   7.0000000000000000D+01   1.0000000000000000D+00   6.8000000000000000D+01
+   1.0000000000000000D+00   1.0000000000000000D+02   1.0000000000000000D+00
+   6.6000000000000000D+01   1.0000000000000000D+00   9.3000000000000000D+01
+   1.0000000000000000D+00   4.3000000000000000D+01   1.0000000000000000D+00
+   4.1000000000000000D+01   1.0000000000000000D+00   9.0000000000000000D+01
+   1.0000000000000000D+00   5.0000000000000000D+00   1.0000000000000000D+00
+   5.2000000000000000D+01   1.0000000000000000D+00   1.8000000000000000D+01
+   1.0000000000000000D+00   7.3000000000000000D+01   1.0000000000000000D+00
+   8.8000000000000000D+01   1.0000000000000000D+00   1.4000000000000000D+01
+   1.0000000000000000D+00   5.8000000000000000D+01   1.0000000000000000D+00
+   9.7000000000000000D+01   1.0000000000000000D+00   3.1000000000000000D+01
+   1.0000000000000000D+00   6.7000000000000000D+01   1.0000000000000000D+00
+   4.0000000000000000D+00   1.0000000000000000D+00   2.5000000000000000D+01
+   1.0000000000000000D+00   6.4000000000000000D+01   1.0000000000000000D+00
+   5.1000000000000000D+01   1.0000000000000000D+00   9.6000000000000000D+01
+   1.0000000000000000D+00   2.6000000000000000D+01   1.0000000000000000D+00
+   9.5000000000000000D+01   2.8000000000000000D+01   1.0000000000000000D+00
+   6.3000000000000000D+01   1.0000000000000000D+00   9.3000000000000000D+01
+   1.0000000000000000D+00   6.5000000000000000D+01   1.0000000000000000D+00
+   2.9000000000000000D+01   1.0000000000000000D+00   5.4000000000000000D+01
+   1.0000000000000000D+00   1.0000000000000000D+01   1.0000000000000000D+00
+   9.8000000000000000D+01   1.0000000000000000D+00   8.0000000000000000D+00
+   1.0000000000000000D+00   6.2000000000000000D+01   1.0000000000000000D+00
+   2.7000000000000000D+01   1.0000000000000000D+00   5.1000000000000000D+01
+   1.0000000000000000D+00   4.2000000000000000D+01   1.0000000000000000D+00
+   7.0000000000000000D+01   1.0000000000000000D+00   6.8000000000000000D+01
+   1.0000000000000000D+00   1.0000000000000000D+02   1.0000000000000000D+00
+   6.6000000000000000D+01   1.0000000000000000D+00   9.3000000000000000D+01
+   1.0000000000000000D+00   4.3000000000000000D+01   1.0000000000000000D+00
+   4.1000000000000000D+01   1.0000000000000000D+00   9.0000000000000000D+01
+   1.0000000000000000D+00   5.0000000000000000D+00   1.0000000000000000D+00
+   5.2000000000000000D+01   1.0000000000000000D+00   1.8000000000000000D+01
+   1.0000000000000000D+00   7.3000000000000000D+01   1.0000000000000000D+00
+   8.8000000000000000D+01   1.0000000000000000D+00   1.4000000000000000D+01
+   1.0000000000000000D+00   5.8000000000000000D+01   1.0000000000000000D+00
+   9.7000000000000000D+01   1.0000000000000000D+00   3.1000000000000000D+01
+   1.0000000000000000D+00   6.7000000000000000D+01   1.0000000000000000D+00
+   4.0000000000000000D+00   1.0000000000000000D+00   2.5000000000000000D+01
+   1.0000000000000000D+00   6.4000000000000000D+01   1.0000000000000000D+00
+   5.1000000000000000D+01   1.0000000000000000D+00   9.6000000000000000D+01
+   1.0000000000000000D+00   2.6000000000000000D+01   1.0000000000000000D+00
+   9.5000000000000000D+01   2.8000000000000000D+01   1.0000000000000000D+00
+   6.3000000000000000D+01   1.0000000000000000D+00   9.3000000000000000D+01
+   1.0000000000000000D+00   6.5000000000000000D+01   1.0000000000000000D+00
+   2.9000000000000000D+01   1.0000000000000000D+00   5.4000000000000000D+01
+   1.0000000000000000D+00   1.0000000000000000D+01   1.0000000000000000D+00
+   9.8000000000000000D+01   1.0000000000000000D+00   8.0000000000000000D+00
+   1.0000000000000000D+00   6.2000000000000000D+01   1.0000000000000000D+00
+   2.7000000000000000D+01   1.0000000000000000D+00   5.1000000000000000D+01
+   1.0000000000000000D+00   4.2000000000000000D+01   1.0000000000000000D+00
+   7.0000000000000000D+01   1.0000000000000000D+00   6.8000000000000000D+01
+   1.0000000000000000D+00   1.0000000000000000D+02   1.0000000000000000D+00
+   6.6000000000000000D+01   1.0000000000000000D+00   9.3000000000000000D+01
+   1.0000000000000000D+00   4.3000000000000000D+01   1.0000000000000000D+00
+   4.1000000000000000D+01   1.0000000000000000D+00   9.0000000000000000D+01
+   1.0000000000000000D+00   5.0000000000000000D+00   1.0000000000000000D+00
+   5.2000000000000000D+01   1.0000000000000000D+00   1.8000000000000000D+01
+   1.0000000000000000D+00   7.3000000000000000D+01   1.0000000000000000D+00
+   8.8000000000000000D+01   1.0000000000000000D+00   1.4000000000000000D+01
+   1.0000000000000000D+00   5.8000000000000000D+01   1.0000000000000000D+00
+   9.7000000000000000D+01   1.0000000000000000D+00   3.1000000000000000D+01
+   1.0000000000000000D+00   6.7000000000000000D+01   1.0000000000000000D+00
+   4.0000000000000000D+00   1.0000000000000000D+00   2.5000000000000000D+01
+   1.0000000000000000D+00   6.4000000000000000D+01   1.0000000000000000D+00
+   5.1000000000000000D+01   1.0000000000000000D+00   9.6000000000000000D+01
+   1.0000000000000000D+00   2.6000000000000000D+01   1.0000000000000000D+00
+   9.5000000000000000D+01
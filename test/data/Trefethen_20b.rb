@@ -0,0 +1,17 @@
+Trefethen_20b, 19 x 19, written from Trefethen_20b.mtx                  Tref20b 
+            13             1             3             9
+isa                       19            19            83             0
+(26I3)          (40I2)          (10I4)              
+  1  7 13 19 24 29 34 39 44 49 54 59 63 67 71 75 78 81 83 84
+ 1 2 3 5 917 2 3 4 61018 3 4 5 71119 4 5 6 812 5 6 7 913 6 7 81014 7 8 91115 8 9
+101216 9101113171011121418111213151912131416131415171415161815161719161718171819
+181919
+   3   1   1   1   1   1   5   1   1   1
+   1   1   7   1   1   1   1   1  11   1
+   1   1   1  13   1   1   1   1  17   1
+   1   1   1  19   1   1   1   1  23   1
+   1   1   1  29   1   1   1   1  31   1
+   1   1   1  37   1   1   1   1  41   1
+   1   1  43   1   1   1  47   1   1   1
+  53   1   1   1  59   1   1  61   1   1
+  67   1  71
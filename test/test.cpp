@@ -3,6 +3,11 @@
 
 #include "mm/mm.hpp"
 
+#include <cstdio>
+#include <cstring>
+
+#include <unistd.h>
+
 template <typename Ordinal, typename Scalar, typename Offset = size_t>
 bool contains_one(const COO<Ordinal, Scalar, Offset> &coo, Ordinal i, Ordinal j, Scalar s) {
 
@@ -145,6 +150,134 @@ int test_read(const std::string &path, Ordinal nrows, Ordinal ncols, Offset nnz)
     return 0;
 }
 
+/* splitting the file into byte ranges should visit the same entries as read_coo
+*/
+template <typename Ordinal, typename Scalar, typename Offset = size_t>
+int test_ranges(const std::string &path, int nRanges)
+{
+    typedef MtxReader<Ordinal, Scalar, Offset> reader_type;
+    typedef typename reader_type::coo_type coo_type;
+    typedef typename coo_type::entry_type entry_type;
+
+    reader_type reader(path);
+    coo_type coo = reader.read_coo();
+
+    std::vector<entry_type> entries;
+    const std::streamoff begin = reader.data_begin();
+    const std::streamoff end = reader.data_end();
+    for (int r = 0; r < nRanges; ++r)
+    {
+        reader.for_each_entry(begin + (end - begin) * r / nRanges, begin + (end - begin) * (r + 1) / nRanges,
+                              [&](const entry_type &e)
+                              { entries.push_back(e); });
+    }
+
+    if (entries != coo.entries)
+    {
+        std::cerr << "ERR: " << nRanges << " ranges got " << entries.size() << " entries, expected " << coo.nnz() << " in " << path << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+/* load statistics should account for the whole file, and be empty without MM_INSTRUMENT
+*/
+int test_stats(const std::string &path)
+{
+    typedef MtxReader<int, float> reader_type;
+
+    reader_type reader(path);
+    int calls = 0;
+    reader.set_progress([&calls](const LoadStats &)
+                        { ++calls; },
+                        1024);
+    reader_type::coo_type coo = reader.read_coo();
+    LoadStats stats = reader.stats();
+    reader_type::csr_type csr(coo, &stats);
+
+#if MM_INSTRUMENT
+    const uint64_t bytes = reader.data_end() - reader.data_begin();
+    if (stats.bytes != bytes || stats.entries != coo.nnz() || calls != int(bytes / 1024))
+    {
+        std::cerr << "ERR: stats saw " << stats.bytes << " bytes, " << stats.entries << " entries, "
+                  << calls << " progress calls in " << path << "\n";
+        return 1;
+    }
+    if (0 == stats.mirrored || stats.peak_bytes < coo.nnz() * sizeof(reader_type::coo_entry_type) || stats.csr_peak_bytes == 0)
+    {
+        std::cerr << "ERR: stats missing mirrored or peak bytes for " << path << "\n";
+        return 1;
+    }
+#else
+    if (calls != 0 || stats.bytes != 0 || stats.entries != 0)
+    {
+        std::cerr << "ERR: stats collected without MM_INSTRUMENT\n";
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+/* parse_real rounds like strtod, and lines are found across block reads, CRLF endings,
+   comment lines longer than a block, and a last line without a newline
+*/
+int test_parse()
+{
+    const char *reals[] = {"0.12345678901234567", "-9.8765432109876543e-05", "1e-30", "7.21908598e-5", ".252505826",
+                           "-0", "1.7976931348623157e308", "4.9406564584124654e-324", "123456789012345678901234",
+                           "0.30000000000000004", "9007199254740993", "1.5\r", "nan", "0x1p3", "1e", "-.5e+3"};
+    for (const char *s : reals)
+    {
+        char *e1;
+        const char *e2;
+        const double a = std::strtod(s, &e1), b = parse_real(s, &e2);
+        if (std::memcmp(&a, &b, sizeof(a)) || e1 != e2)
+        {
+            std::cerr << "ERR: parse_real(\"" << s << "\") is " << b << ", strtod gives " << a << "\n";
+            return 1;
+        }
+    }
+    for (int k = 1; k < 100000; ++k)
+    {
+        char s[32];
+        const double v = std::sin(double(k)) * std::pow(10.0, k % 41 - 20);
+        std::snprintf(s, sizeof(s), "%.17g", v);
+        const char *e;
+        if (parse_real(s, &e) != v)
+        {
+            std::cerr << "ERR: " << s << " doesn't round trip\n";
+            return 1;
+        }
+    }
+
+    // test-cpu and test-cpu-instrument run this in the same directory, maybe at once
+    const std::string path = "test_parse-" + std::to_string(getpid()) + ".mtx";
+    {
+        std::ofstream outf(path, std::ios::binary);
+        outf << "%%MatrixMarket matrix coordinate real general\r\n3 3 4\r\n";
+        outf << "% " << std::string(3000, 'x') << "\n";
+        outf << "1 1 0.5\r\n2\t3 -1.25e-3\n\n3 2 1e-30\n";
+        outf << "% " << std::string(3000, 'y') << "\n";
+        outf << "3 3 0.30000000000000004";
+    }
+    typedef MtxReader<int, double> reader_type;
+    reader_type reader(path);
+    const reader_type::coo_type coo = reader.read_coo();
+    const std::vector<reader_type::coo_entry_type> expected{{0, 0, 0.5}, {1, 2, -1.25e-3}, {2, 1, 1e-30}, {2, 2, 0.30000000000000004}};
+    if (coo.entries != expected)
+    {
+        std::cerr << "ERR: " << path << " read " << coo.nnz() << " entries\n";
+        return 1;
+    }
+    for (int nRanges : {2, 3, 50, 4000})
+    {
+        if (test_ranges<int, double>(path, nRanges))
+            return 1;
+    }
+    std::remove(path.c_str());
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     if (argc < 2)
@@ -174,5 +307,19 @@ int main(int argc, char **argv)
     if (test_read<int, std::complex<float>>(dataDir + "/mhd1280b.mtx", 1280, 1280, 22778))
         return 1;
 
+    if (test_stats(dataDir + "/Trefethen_20b.mtx"))
+        return 1;
+
+    if (test_parse())
+        return 1;
+
+    for (int nRanges : {1, 2, 7, 1000})
+    {
+        if (test_ranges<int, float>(dataDir + "/abb313.mtx", nRanges))
+            return 1;
+        if (test_ranges<int, std::complex<float>>(dataDir + "/mhd1280b.mtx", nRanges))
+            return 1;
+    }
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,87 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#include "mm/alloc.hpp"
+#include "mm/mm.hpp"
+
+typedef CSR<int, double> csr_type;
+
+// a and b have the same shape and entries
+template <typename A, typename B>
+int check_equal(const A &a, const B &b)
+{
+    if (a.num_rows() != b.num_rows() || a.num_cols() != b.num_cols() || a.nnz() != b.nnz())
+    {
+        std::cerr << "ERR: shape or nnz differs\n";
+        return 1;
+    }
+    if (!std::equal(a.row_ptr().begin(), a.row_ptr().end(), b.row_ptr().begin()) ||
+        !std::equal(a.col_ind().begin(), a.col_ind().end(), b.col_ind().begin()) ||
+        !std::equal(a.val().begin(), a.val().end(), b.val().begin()))
+    {
+        std::cerr << "ERR: entries differ\n";
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return 1;
+    }
+    std::string dataDir = argv[1];
+    const std::string path = dataDir + "/mhd1280b.mtx";
+
+    MtxReader<int, double> reader(path);
+    const csr_type ref(reader.read_coo());
+
+    {
+        // arena-backed loads reuse the same chunks once the arena is reset
+        typedef ArenaAllocator<char> alloc_t;
+        typedef MtxReader<int, double, size_t, alloc_t> reader_t;
+        Arena arena(size_t(1) << 20);
+        size_t capacity = 0;
+        for (int cycle = 0; cycle < 5; ++cycle)
+        {
+            {
+                reader_t r(path);
+                const reader_t::coo_type coo = r.read_coo(alloc_t(arena));
+                const reader_t::csr_type a(coo);
+                if (check_equal(ref, a) || check_equal(ref, transpose(transpose(a))))
+                    return 1;
+                if (arena.used() == 0 || !(a.get_allocator() == alloc_t(arena)))
+                {
+                    std::cerr << "ERR: arrays did not come from the arena\n";
+                    return 1;
+                }
+            }
+            if (cycle > 0 && arena.capacity() != capacity)
+            {
+                std::cerr << "ERR: arena grew from " << capacity << " to " << arena.capacity() << " on reload\n";
+                return 1;
+            }
+            capacity = arena.capacity();
+            arena.reset();
+        }
+    }
+
+    {
+        // huge page CSR from a default COO
+        typedef HugePageAllocator<char> alloc_t;
+        const CSR<int, double, size_t, alloc_t> a(reader.read_coo(), alloc_t());
+        if (check_equal(ref, a))
+            return 1;
+
+        std::vector<double, HugePageAllocator<double>> big(HUGE_PAGE_SIZE);
+        if (reinterpret_cast<uintptr_t>(big.data()) % HUGE_PAGE_SIZE)
+        {
+            std::cerr << "ERR: large allocation is not huge-page aligned\n";
+            return 1;
+        }
+        big.back() = 1;
+    }
+
+    return 0;
+}
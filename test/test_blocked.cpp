@@ -0,0 +1,155 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#include "mm/blocked.hpp"
+#include "mm/spmv.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+typedef MtxReader<int, double> reader_type;
+typedef CSR<int, double> csr_type;
+typedef BlockedCSR<int, double> blocked_type;
+
+// the blocks hold every entry once, and SpMV matches CSR up to the order of the sums
+int check(const std::string &path, int tileWidth, int panelHeight)
+{
+    const csr_type a(reader_type(path).read_coo());
+    const blocked_type b(a, tileWidth, panelHeight);
+    if (b.nnz() != a.nnz() || b.num_rows() != a.num_rows() || b.num_cols() != a.num_cols() || &b.csr() != &a ||
+        b.block_row().size() != size_t(b.num_panels()) * b.num_tiles() + 1 || b.block_row().back() != b.num_block_rows())
+    {
+        std::cerr << "ERR: blocks of " << path << " with " << tileWidth << "x" << panelHeight << " don't cover the matrix\n";
+        return 1;
+    }
+    // each entry of a is in exactly one block row, whose row and tile it belongs to
+    std::vector<int> seen(a.nnz(), 0);
+    for (int block = 0; block + 1 < int(b.block_row().size()); ++block)
+    {
+        const int lo = (block % b.num_tiles()) * tileWidth, hi = lo + tileWidth;
+        for (size_t r = b.block_row()[block]; r < b.block_row()[block + 1]; ++r)
+        {
+            const int i = b.rows()[r];
+            if (i / panelHeight != block / b.num_tiles() || b.row_len()[r] == 0 || b.row_begin()[r] < a.row_ptr(i) ||
+                b.row_begin()[r] + b.row_len()[r] > a.row_ptr(i + 1))
+            {
+                std::cerr << "ERR: row " << i << " listed in block " << block << "\n";
+                return 1;
+            }
+            for (size_t k = b.row_begin()[r]; k < b.row_begin()[r] + b.row_len()[r]; ++k)
+            {
+                ++seen[k];
+                if (a.col_ind(k) < lo || a.col_ind(k) >= hi)
+                {
+                    std::cerr << "ERR: column " << a.col_ind(k) << " in block " << block << "\n";
+                    return 1;
+                }
+            }
+        }
+    }
+    if (std::count(seen.begin(), seen.end(), 1) != int(a.nnz()))
+    {
+        std::cerr << "ERR: blocks of " << path << " don't hold every entry once\n";
+        return 1;
+    }
+
+    std::vector<double> x(a.num_cols()), expected(a.num_rows());
+    for (int j = 0; j < a.num_cols(); ++j)
+    {
+        x[j] = 1.0 + j % 7;
+    }
+    spmv(expected, a, x);
+    for (int threads : {1, 3})
+    {
+        std::vector<double> y(a.num_rows(), -1);
+        spmv(y, b, x, balanced_row_blocks(b, threads));
+        for (int i = 0; i < a.num_rows(); ++i)
+        {
+            if (std::abs(y[i] - expected[i]) > 1e-12 * (1 + std::abs(expected[i])))
+            {
+                std::cerr << "ERR: y[" << i << "] of " << path << " is " << y[i] << " on " << threads << " threads, expected "
+                          << expected[i] << "\n";
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return 1;
+    }
+    std::string dataDir = argv[1];
+
+    // square, rectangular, and skew-symmetric expanded; tiles narrower and wider than the matrix
+    for (const char *name : {"/08blocks.mtx", "/abb313.mtx", "/plskz362.mtx"})
+    {
+        if (check(dataDir + name, 7, 16) || check(dataDir + name, 1, 1) || check(dataDir + name, 5000, 3))
+        {
+            return 1;
+        }
+    }
+
+    // default sizes fit half of L2; bounds must fall on panel boundaries
+    {
+        const csr_type a(reader_type(dataDir + "/abb313.mtx").read_coo());
+        const blocked_type b(a);
+        if (uint64_t(b.tile_width()) * sizeof(double) > l2_cache_bytes() / 2 || b.tile_width() < 1 || b.panel_height() < 1)
+        {
+            std::cerr << "ERR: default tile is " << b.tile_width() << " columns\n";
+            return 1;
+        }
+        const blocked_type c(a, 16, 16);
+        std::vector<double> x(a.num_cols(), 1), y(a.num_rows());
+        try
+        {
+            spmv(y, c, x, std::vector<int>{0, 17, a.num_rows()});
+            std::cerr << "ERR: bounds inside a panel\n";
+            return 1;
+        }
+        catch (const std::logic_error &)
+        {
+        }
+    }
+
+    // by default every thread gets rows, however tall half of L2 is
+    {
+        const csr_type a(reader_type(dataDir + "/mhd1280b.mtx").read_coo());
+        for (int threads : {2, 4, 16})
+        {
+            set_num_threads(threads);
+            const blocked_type b(a);
+            const std::vector<int> bounds = balanced_row_blocks(b, threads);
+            for (int t = 0; t < threads; ++t)
+            {
+                if (bounds[t] >= bounds[t + 1])
+                {
+                    std::cerr << "ERR: thread " << t << " of " << threads << " gets no rows of " << b.panel_height()
+                              << "-row panels\n";
+                    return 1;
+                }
+            }
+        }
+    }
+
+    // symmetric storage is not blocked
+    {
+        reader_type reader(dataDir + "/Trefethen_20b.mtx");
+        reader.set_expand_symmetry(false);
+        const csr_type tri(reader.read_coo());
+        try
+        {
+            blocked_type b(tri);
+            std::cerr << "ERR: blocked symmetric storage\n";
+            return 1;
+        }
+        catch (const std::logic_error &)
+        {
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#include "mm/compressed.hpp"
+
+#include <cmath>
+
+typedef CSR<int64_t, double> csr_type;
+
+template <typename Compressed>
+int check(const csr_type &a, const Compressed &c)
+{
+    const csr_type b = c.to_csr();
+    if (a.num_rows() != b.num_rows() || a.num_cols() != b.num_cols() || a.row_ptr() != b.row_ptr() ||
+        a.col_ind() != b.col_ind() || a.val() != b.val())
+    {
+        std::cerr << "ERR: compressed matrix does not round-trip\n";
+        return 1;
+    }
+
+    std::vector<double> x(a.num_cols()), ref(a.num_rows(), 0);
+    for (size_t j = 0; j < x.size(); ++j)
+    {
+        x[j] = std::cos(double(j));
+    }
+    for (int64_t i = 0; i < a.num_rows(); ++i)
+    {
+        for (size_t k = a.row_ptr(i); k < a.row_ptr(i + 1); ++k)
+        {
+            ref[i] += a.val(k) * x[a.col_ind(k)];
+        }
+    }
+    for (int nThreads : {1, 3})
+    {
+        set_num_threads(nThreads);
+        std::vector<double> y(a.num_rows());
+        spmv(y, c, x);
+        for (size_t i = 0; i < y.size(); ++i)
+        {
+            if (std::abs(y[i] - ref[i]) > 1e-12 * (1 + std::abs(ref[i])))
+            {
+                std::cerr << "ERR: y[" << i << "] = " << y[i] << ", expected " << ref[i] << "\n";
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return 1;
+    }
+    std::string dataDir = argv[1];
+
+    for (const char *name : {"/08blocks.mtx", "/abb313.mtx", "/mhd1280b.mtx", "/Trefethen_20b.mtx"})
+    {
+        MtxReader<int64_t, double> reader(dataDir + name);
+        const csr_type a(reader.read_coo());
+        const CompressedCSR<int64_t, double> c(a);
+        if (check(a, c))
+            return 1;
+        // these are narrow enough to have no far entries, so from 8 entries per row the indices are half the size
+        const uint64_t csrBytes = a.row_ptr().size() * sizeof(size_t) + a.nnz() * sizeof(int64_t);
+        if (c.num_far() != 0 || (a.nnz() >= 8 * size_t(a.num_rows()) && 2 * c.index_bytes() > csrBytes))
+        {
+            std::cerr << "ERR: " << name << " indices take " << c.index_bytes() << " bytes, CSR " << csrBytes << "\n";
+            return 1;
+        }
+    }
+
+    // wide rows have far entries, here with 8-bit offsets
+    std::vector<size_t> rowPtr = {0, 5, 5, 9};
+    std::vector<int64_t> colInd = {0, 255, 256, 700, 100000, 3, 4, 99999, 100000};
+    std::vector<double> val = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+    const csr_type wide(100001, rowPtr, colInd, val);
+    const CompressedCSR<int64_t, double, size_t, uint8_t> c8(wide);
+    const CompressedCSR<int64_t, double> c16(wide);
+    if (c8.num_far() != 5 || c16.num_far() != 3)
+    {
+        std::cerr << "ERR: expected 5 and 3 far entries, got " << c8.num_far() << " and " << c16.num_far() << "\n";
+        return 1;
+    }
+    if (check(wide, c8) || check(wide, c16))
+        return 1;
+    return 0;
+}
@@ -0,0 +1,86 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#include "mm/out_of_core.hpp"
+#include "mm/spmv.hpp"
+
+#include <cmath>
+
+typedef CSR<int, double> csr_type;
+
+/* the files built from path in budget bytes map to the same CSR as CSR(read_coo()),
+   and multiply the same
+*/
+int check(const std::string &path, uint64_t budget, bool expand)
+{
+    MtxReader<int, double> reader(path);
+    reader.set_expand_symmetry(expand);
+    const csr_type a(reader.read_coo());
+
+    const std::string prefix = "test_out_of_core";
+    const OutOfCoreStats stats = build_csr_files(reader, prefix, budget, ".");
+    if (stats.entries != a.nnz() || stats.runs != (a.nnz() * sizeof(COO<int, double>::entry_type) + budget - 1) / budget)
+    {
+        std::cerr << "ERR: " << path << ": " << stats.entries << " entries in " << stats.runs << " runs\n";
+        return 1;
+    }
+    // no more than 64 runs are merged at once, through buffers that fit the budget
+    if (stats.runs > 64 && stats.passes < 2)
+    {
+        std::cerr << "ERR: " << path << ": merged " << stats.runs << " runs in one pass\n";
+        return 1;
+    }
+    if (stats.peakBytes > budget + 3 * sizeof(COO<int, double>::entry_type))
+    {
+        std::cerr << "ERR: " << path << ": used " << stats.peakBytes << " bytes of a " << budget << " budget\n";
+        return 1;
+    }
+    {
+        const MappedCSR<int, double> m(prefix);
+        if (m.num_rows() != a.num_rows() || m.num_cols() != a.num_cols() || m.symmetry() != a.symmetry() ||
+            !std::equal(a.row_ptr().begin(), a.row_ptr().end(), m.row_ptr().begin()) ||
+            !std::equal(a.col_ind().begin(), a.col_ind().end(), m.col_ind().begin()) ||
+            !std::equal(a.val().begin(), a.val().end(), m.val().begin()))
+        {
+            std::cerr << "ERR: " << path << ": mapped CSR differs\n";
+            return 1;
+        }
+        if (expand)
+        {
+            std::vector<double> x(a.num_cols()), y(a.num_rows()), ym(a.num_rows());
+            for (size_t j = 0; j < x.size(); ++j)
+            {
+                x[j] = std::cos(double(j));
+            }
+            spmv(y, a, x);
+            spmv(ym, m, x);
+            if (y != ym)
+            {
+                std::cerr << "ERR: " << path << ": mapped spmv differs\n";
+                return 1;
+            }
+        }
+    }
+    remove_csr_files(prefix);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return 1;
+    }
+    std::string dataDir = argv[1];
+
+    for (const char *name : {"/08blocks.mtx", "/abb313.mtx", "/mhd1280b.mtx", "/plskz362.mtx", "/Trefethen_20b.mtx"})
+    {
+        // one run, a few runs, many small runs, and too many runs to merge in one pass
+        for (uint64_t budget : {uint64_t(1) << 30, uint64_t(16) << 10, uint64_t(4) << 10, uint64_t(400)})
+        {
+            if (check(dataDir + name, budget, true) || check(dataDir + name, budget, false))
+                return 1;
+        }
+    }
+    return 0;
+}
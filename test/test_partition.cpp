@@ -0,0 +1,147 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#include "mm/partition.hpp"
+#include "mm/submatrix.hpp"
+
+#include <cmath>
+#include <random>
+
+typedef CSR<int, double> csr_type;
+
+// 5-point stencil on an n x n grid
+csr_type grid(int n)
+{
+    std::vector<size_t> rowPtr(1, 0);
+    std::vector<int> colInd;
+    std::vector<double> val;
+    for (int r = 0; r < n; ++r)
+    {
+        for (int c = 0; c < n; ++c)
+        {
+            const int i = r * n + c;
+            if (r > 0)
+                colInd.push_back(i - n), val.push_back(-1);
+            if (c > 0)
+                colInd.push_back(i - 1), val.push_back(-1);
+            colInd.push_back(i), val.push_back(4);
+            if (c + 1 < n)
+                colInd.push_back(i + 1), val.push_back(-1);
+            if (r + 1 < n)
+                colInd.push_back(i + n), val.push_back(-1);
+            rowPtr.push_back(colInd.size());
+        }
+    }
+    return csr_type(n * n, std::move(rowPtr), std::move(colInd), std::move(val));
+}
+
+/* every row is owned once, the local matrices reproduce A,
+   and the distributed SpMV matches a serial one
+*/
+int check(const csr_type &a, const Partition &partition, PartitionStats &stats)
+{
+    const std::vector<LocalMatrix<int, double, size_t>> locals = distribute(a, partition);
+    stats = partition_stats(locals);
+
+    size_t nnz = 0, rows = 0;
+    for (const LocalMatrix<int, double, size_t> &l : locals)
+    {
+        nnz += l.a.nnz();
+        rows += l.rows.size();
+        for (int g = 0; g < l.num_ghosts(); ++g)
+        {
+            const int owner = l.ghostOwner[g];
+            if (owner == &l - &locals[0] || locals[owner].rows[l.ghostIndex[g]] != l.ghosts[g])
+            {
+                std::cerr << "ERR: ghost " << l.ghosts[g] << " has the wrong owner\n";
+                return 1;
+            }
+        }
+    }
+    if (nnz != a.nnz() || rows != size_t(a.num_rows()))
+    {
+        std::cerr << "ERR: local matrices have " << rows << " rows and " << nnz << " entries\n";
+        return 1;
+    }
+
+    std::vector<double> x(a.num_cols()), y(a.num_rows()), ref(a.num_rows());
+    for (int j = 0; j < a.num_cols(); ++j)
+    {
+        x[j] = std::sin(j + 1.0);
+    }
+    for (int i = 0; i < a.num_rows(); ++i)
+    {
+        for (size_t k = a.row_ptr(i); k < a.row_ptr(i + 1); ++k)
+        {
+            ref[i] += a.val(k) * x[a.col_ind(k)];
+        }
+    }
+    spmv_distributed(locals, x, y);
+    for (int i = 0; i < a.num_rows(); ++i)
+    {
+        if (std::abs(y[i] - ref[i]) > 1e-12)
+        {
+            std::cerr << "ERR: y[" << i << "] = " << y[i] << ", expected " << ref[i] << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return 1;
+    }
+    std::string dataDir = argv[1];
+
+    // contiguous blocks of a grid in natural order are already good,
+    // shuffled they are terrible and the multilevel partition should recover
+    csr_type a = grid(40);
+    std::vector<int> perm(a.num_rows());
+    for (int i = 0; i < a.num_rows(); ++i)
+    {
+        perm[i] = i;
+    }
+    std::mt19937 g(0);
+    std::shuffle(perm.begin(), perm.end(), g);
+    const csr_type shuffled = permute(a, perm, perm);
+
+    for (int k : {1, 4, 7})
+    {
+        PartitionStats contiguous, natural, multilevel;
+        if (check(a, partition_contiguous(a, k), natural))
+            return 1;
+        if (check(shuffled, partition_contiguous(shuffled, k), contiguous))
+            return 1;
+        if (check(shuffled, partition_multilevel(shuffled, k), multilevel))
+            return 1;
+        std::cerr << "k=" << k << " cut: natural " << natural.cut << " contiguous " << contiguous.cut
+                  << " multilevel " << multilevel.cut << " (imbalance " << multilevel.imbalance << ")\n";
+        if (natural.imbalance > 1.05 || multilevel.imbalance > 1.1)
+        {
+            std::cerr << "ERR: partition is unbalanced\n";
+            return 1;
+        }
+        if (k > 1 && 4 * multilevel.cut > contiguous.cut)
+        {
+            std::cerr << "ERR: multilevel cut is not much better than contiguous\n";
+            return 1;
+        }
+        if (1 == k && (multilevel.cut || multilevel.volume))
+        {
+            std::cerr << "ERR: a single part should not communicate\n";
+            return 1;
+        }
+    }
+
+    MtxReader<int, double> reader(dataDir + "/08blocks.mtx");
+    const csr_type blocks(reader.read_coo());
+    PartitionStats stats;
+    if (check(blocks, partition_multilevel(blocks, 3), stats))
+        return 1;
+    if (check(blocks, partition_contiguous(blocks, 5), stats))
+        return 1;
+    return 0;
+}
@@ -0,0 +1,126 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#include "mm/precision.hpp"
+#include "mm/spmv.hpp"
+
+#include <cmath>
+
+// T(v) converts back to expected
+template <typename T>
+int check_round(float v, float expected)
+{
+    const float got = T(v);
+    if (!(got == expected) && !(std::isnan(got) && std::isnan(expected)))
+    {
+        std::cerr << "ERR: " << v << " rounded to " << got << ", expected " << expected << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+/* load the file with Scalar S, check the reported conversion error is within bound,
+   and that SpMV with double x matches SpMV on the double matrix to that accuracy
+*/
+template <typename S>
+int check_load(const std::string &path, double bound)
+{
+    MtxReader<int, double> dReader(path);
+    const CSR<int, double> a(dReader.read_coo());
+    if (dReader.conversion_error().values != 0)
+    {
+        std::cerr << "ERR: conversion to double should not be tracked\n";
+        return 1;
+    }
+
+    MtxReader<int, S> reader(path);
+    const CSR<int, S> b(reader.read_coo());
+    const ConversionError &err = reader.conversion_error();
+    if (0 == err.values || err.max_rel > bound)
+    {
+        std::cerr << "ERR: " << path << ": " << err.values << " values, max relative error " << err.max_rel << "\n";
+        return 1;
+    }
+
+    // convert_values also sees the mirrored entries, so only the worst case matches
+    ConversionError converted;
+    const CSR<int, S> c = convert_values<S>(a, &converted);
+    if (converted.max_rel != err.max_rel)
+    {
+        std::cerr << "ERR: convert_values saw error " << converted.max_rel << ", the reader saw " << err.max_rel << "\n";
+        return 1;
+    }
+
+    std::vector<double> x(a.num_cols()), y(a.num_rows()), yb(a.num_rows()), yc(a.num_rows());
+    for (size_t j = 0; j < x.size(); ++j)
+    {
+        x[j] = 1.0 + 1.0 / (j + 1);
+    }
+    spmv(y, a, x);
+    spmv(yb, b, x);
+    spmv(yc, c, x);
+    for (int i = 0; i < a.num_rows(); ++i)
+    {
+        double scale = 0; // sum of |A(i,j) x(j)| bounds the error of the row
+        for (size_t k = a.row_ptr(i); k < a.row_ptr(i + 1); ++k)
+        {
+            scale += std::abs(a.val(k) * x[a.col_ind(k)]);
+        }
+        if (std::abs(yb[i] - y[i]) > bound * scale * (1 + 1e-12) || yb[i] != yc[i])
+        {
+            std::cerr << "ERR: y[" << i << "] = " << yb[i] << ", expected " << y[i] << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return 1;
+    }
+    std::string dataDir = argv[1];
+
+    // rounding
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float inf = std::numeric_limits<float>::infinity();
+    if (check_round<float16>(1, 1) || check_round<float16>(65504, 65504) || check_round<float16>(65519, 65504) ||
+        check_round<float16>(65520, inf) || check_round<float16>(-1e6f, -inf) || check_round<float16>(nan, nan) ||
+        check_round<float16>(std::ldexp(1.0f, -24), std::ldexp(1.0f, -24)) || // smallest subnormal
+        check_round<float16>(std::ldexp(1.0f, -25), 0) ||                     // tie to even
+        check_round<float16>(std::ldexp(3.0f, -26), std::ldexp(1.0f, -24)) ||
+        check_round<float16>(1 + std::ldexp(1.0f, -11), 1) ||                          // tie to even
+        check_round<float16>(1 + std::ldexp(3.0f, -11), 1 + std::ldexp(1.0f, -9)) ||   // tie to even, up
+        check_round<float16>(0.1f, 0.0999755859375f))
+        return 1;
+    if (check_round<bfloat16>(1, 1) || check_round<bfloat16>(-3.5f, -3.5f) || check_round<bfloat16>(nan, nan) ||
+        check_round<bfloat16>(1 + std::ldexp(1.0f, -8), 1) ||
+        check_round<bfloat16>(1 + std::ldexp(3.0f, -8), 1 + std::ldexp(1.0f, -6)) ||
+        check_round<bfloat16>(257, 256) || check_round<bfloat16>(259, 260) || check_round<bfloat16>(inf, inf))
+        return 1;
+
+    // relative error of round-to-nearest is at most half an ulp
+    for (const char *name : {"/mhd1280b.mtx", "/plskz362.mtx", "/08blocks.mtx"})
+    {
+        if (check_load<float>(dataDir + name, std::ldexp(1.0, -24)) ||
+            check_load<bfloat16>(dataDir + name, std::ldexp(1.0, -8)))
+            return 1;
+    }
+    for (const char *name : {"/plskz362.mtx", "/08blocks.mtx"})
+    {
+        if (check_load<float16>(dataDir + name, std::ldexp(1.0, -11)))
+            return 1;
+    }
+
+    // some of these values are too small for float16 and flush to zero
+    MtxReader<int, float16> reader(dataDir + "/mhd1280b.mtx");
+    reader.read_coo();
+    if (reader.conversion_error().max_rel != 1)
+    {
+        std::cerr << "ERR: underflow to zero was not reported\n";
+        return 1;
+    }
+    return 0;
+}
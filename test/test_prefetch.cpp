@@ -0,0 +1,131 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#include "mm/prefetch.hpp"
+
+typedef MtxReader<int, double> reader_type;
+typedef COO<int, double> coo_type;
+typedef CSR<int, double> csr_type;
+
+// read path the usual way, return whether it could be read
+bool read_sequential(const std::string &path, coo_type &coo)
+{
+    try
+    {
+        coo = reader_type(path).read_coo();
+        return true;
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+}
+
+// every file from a CooPrefetcher matches reading it sequentially, errors included
+int check_coo(const std::vector<std::string> &paths, size_t lookahead, uint64_t memoryCap)
+{
+    CooPrefetcher<int, double> loader(paths, lookahead, memoryCap);
+    for (const std::string &path : paths)
+    {
+        coo_type expected;
+        const bool readable = read_sequential(path, expected);
+        std::future<coo_type> pending = loader.next();
+        try
+        {
+            const coo_type got = pending.get();
+            if (!readable)
+            {
+                std::cerr << "ERR: " << path << " loaded but can't be read\n";
+                return 1;
+            }
+            if (got.num_rows() != expected.num_rows() || got.num_cols() != expected.num_cols() || got.entries != expected.entries)
+            {
+                std::cerr << "ERR: " << path << " differs (lookahead " << lookahead << ", cap " << memoryCap << ")\n";
+                return 1;
+            }
+        }
+        catch (const std::exception &e)
+        {
+            if (readable)
+            {
+                std::cerr << "ERR: " << path << " failed to load: " << e.what() << "\n";
+                return 1;
+            }
+        }
+    }
+    try
+    {
+        loader.next();
+        std::cerr << "ERR: next() past the last file\n";
+        return 1;
+    }
+    catch (const std::logic_error &)
+    {
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return 1;
+    }
+    std::string dataDir = argv[1];
+
+    const std::vector<std::string> paths = {
+        dataDir + "/08blocks.mtx",
+        dataDir + "/abb313.mtx",
+        dataDir + "/missing.mtx",
+        dataDir + "/Trefethen_20b.mtx",
+        dataDir + "/plskz362.mtx",
+        dataDir + "/08blocks.mtx",
+    };
+
+    for (size_t lookahead : {1, 3, 10})
+    {
+        // no cap, a cap that holds one file at a time, and a cap smaller than any file
+        for (uint64_t memoryCap : {uint64_t(0), uint64_t(16 * 1024), uint64_t(1)})
+        {
+            if (check_coo(paths, lookahead, memoryCap))
+            {
+                return 1;
+            }
+        }
+    }
+
+    // dropping the loader with files pending stops it
+    {
+        CooPrefetcher<int, double> loader(paths, 2);
+        loader.next().get();
+    }
+
+    // CSR, and a single load
+    {
+        CsrPrefetcher<int, double> loader({paths[0], paths[3]});
+        const csr_type a = loader.next().get(), b = loader.next().get();
+        const csr_type expected(reader_type(paths[3]).read_coo());
+        if (a.nnz() != reader_type(paths[0]).read_coo().nnz() || b.col_ind() != expected.col_ind() || b.val() != expected.val())
+        {
+            std::cerr << "ERR: CsrPrefetcher differs\n";
+            return 1;
+        }
+        const csr_type c = load_csr_async<int, double>(paths[3]).get();
+        if (c.row_ptr() != expected.row_ptr() || c.col_ind() != expected.col_ind())
+        {
+            std::cerr << "ERR: load_csr_async differs\n";
+            return 1;
+        }
+    }
+    try
+    {
+        load_coo_async<int, double>(paths[2]).get();
+        std::cerr << "ERR: missing file loaded\n";
+        return 1;
+    }
+    catch (const std::exception &)
+    {
+    }
+
+    return 0;
+}
@@ -0,0 +1,135 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#include "mm/rb.hpp"
+
+#include <complex>
+#include <cstdio>
+
+template <typename Scalar>
+int check_equal(const CSR<int, Scalar> &got, const CSR<int, Scalar> &expected, const std::string &what)
+{
+    if (got.num_rows() != expected.num_rows() || got.num_cols() != expected.num_cols() || got.symmetry() != expected.symmetry() ||
+        got.row_ptr() != expected.row_ptr() || got.col_ind() != expected.col_ind() || got.val() != expected.val())
+    {
+        std::cerr << "ERR: " << what << " differs\n";
+        return 1;
+    }
+    return 0;
+}
+
+// path read by RbReader matches mtx read by MtxReader, with and without expanding symmetry
+template <typename Scalar>
+int check_file(const std::string &path, const std::string &mtx)
+{
+    for (bool expand : {true, false})
+    {
+        RbReader<int, Scalar> rb(path);
+        MtxReader<int, Scalar> reader(mtx);
+        rb.set_expand_symmetry(expand);
+        reader.set_expand_symmetry(expand);
+        if (rb.info().nrows != reader.info().nrows || rb.info().ncols != reader.info().ncols ||
+            rb.info().symmetry != reader.info().symmetry)
+        {
+            std::cerr << "ERR: " << path << " info differs\n";
+            return 1;
+        }
+        const CSR<int, Scalar> expected(reader.read_coo());
+        const CSR<int, Scalar> csr = rb.read_csr();
+        if (check_equal(csr, expected, path + " read_csr") ||
+            check_equal(rb.read_csc(), transpose(expected), path + " read_csc"))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return 1;
+    }
+    std::string dataDir = argv[1];
+
+    // formats
+    {
+        const FortranFormat f = FortranFormat::parse("(1P,4D20.12)");
+        const FortranFormat g = FortranFormat::parse("( 16i5 )");
+        if (f.count != 4 || f.width != 20 || f.type != 'D' || g.count != 16 || g.width != 5 || g.type != 'I')
+        {
+            std::cerr << "ERR: format parsed wrong\n";
+            return 1;
+        }
+        char d[] = " 1.25D+02", e[] = "-1.5-3", p[] = "0.5E1";
+        if (FortranFormat::to_real(d) != 125.0 || FortranFormat::to_real(e) != -1.5e-3 || FortranFormat::to_real(p) != 5.0)
+        {
+            std::cerr << "ERR: real field parsed wrong\n";
+            return 1;
+        }
+    }
+
+    // D exponents; fields that run together; a Harwell-Boeing header with right-hand side lines
+    if (check_file<double>(dataDir + "/08blocks.rb", dataDir + "/08blocks.mtx") ||
+        check_file<double>(dataDir + "/Trefethen_20b.rb", dataDir + "/Trefethen_20b.mtx") ||
+        check_file<float>(dataDir + "/Trefethen_20b.rb", dataDir + "/Trefethen_20b.mtx") ||
+        check_file<double>(dataDir + "/plskz362.hb", dataDir + "/plskz362.mtx"))
+    {
+        return 1;
+    }
+    {
+        RbReader<int, double> rb(dataDir + "/Trefethen_20b.rb");
+        if (rb.key() != "Tref20b" || rb.info().scalar != Info::Scalar::INTEGER || rb.title().find("Trefethen_20b") != 0)
+        {
+            std::cerr << "ERR: header of Trefethen_20b.rb\n";
+            return 1;
+        }
+    }
+
+    // write_rb round trip of a complex hermitian matrix, stored as one triangle
+    {
+        typedef std::complex<double> Scalar;
+        const std::string path = "test_rb_mhd1280b.rb";
+        MtxReader<int, Scalar> reader(dataDir + "/mhd1280b.mtx");
+        reader.set_expand_symmetry(false);
+        const CSR<int, Scalar> a(reader.read_coo());
+        write_rb(path, a, "mhd1280b", "mhd1280b");
+        RbReader<int, Scalar> rb(path);
+        rb.set_expand_symmetry(false);
+        const int err = check_equal(rb.read_csr(), a, "write_rb round trip");
+        rb.set_expand_symmetry(true);
+        const int errExpand = check_equal(rb.read_csr(), expand(a), "write_rb round trip, expanded");
+        std::remove(path.c_str());
+        if (err || errExpand)
+        {
+            return 1;
+        }
+    }
+
+    // elemental matrices are rejected
+    {
+        const std::string path = "test_rb_elemental.rb";
+        {
+            std::ofstream outf(path);
+            outf << "elemental\n1 1 1 0\nrue 2 2 4 1\n(1I2) (4I2)\n";
+        }
+        int err = 1;
+        try
+        {
+            RbReader<int, double> rb(path);
+            std::cerr << "ERR: elemental matrix was read\n";
+        }
+        catch (const std::logic_error &)
+        {
+            err = 0;
+        }
+        std::remove(path.c_str());
+        if (err)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
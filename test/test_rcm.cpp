@@ -0,0 +1,168 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#include "mm/alloc.hpp"
+#include "mm/rcm.hpp"
+
+#include <random>
+
+typedef COO<int, float> coo_type;
+typedef coo_type::entry_type entry_type;
+typedef CSR<int, float> csr_type;
+
+/* b should be a with rows and columns permuted by perm
+*/
+int check_permuted(const csr_type &a, const csr_type &b, const std::vector<int> &perm)
+{
+    if (a.nnz() != b.nnz() || a.num_rows() != b.num_rows())
+    {
+        std::cerr << "ERR: permuted matrix has a different shape\n";
+        return 1;
+    }
+    for (int i = 0; i < b.num_rows(); ++i)
+    {
+        for (size_t k = b.row_ptr(i); k < b.row_ptr(i + 1); ++k)
+        {
+            if (k > b.row_ptr(i) && b.col_ind(k - 1) >= b.col_ind(k))
+            {
+                std::cerr << "ERR: row " << i << " of permuted matrix is unsorted\n";
+                return 1;
+            }
+            // find A(perm[i], perm[j])
+            const int src = perm[i];
+            const int j = perm[b.col_ind(k)];
+            bool found = false;
+            for (size_t ak = a.row_ptr(src); ak < a.row_ptr(src + 1); ++ak)
+            {
+                found |= (a.col_ind(ak) == j && a.val(ak) == b.val(k));
+            }
+            if (!found)
+            {
+                std::cerr << "ERR: B(" << i << "," << b.col_ind(k) << ") not in A\n";
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int check_perm(const std::vector<int> &perm, int n)
+{
+    std::vector<int> seen(n, 0);
+    for (int p : perm)
+    {
+        if (p < 0 || p >= n || seen[p]++)
+        {
+            std::cerr << "ERR: rcm did not return a permutation\n";
+            return 1;
+        }
+    }
+    return int(perm.size()) != n;
+}
+
+/* a randomly-numbered path graph, plus a second disconnected path, should come back with bandwidth 1
+*/
+int test_shuffled_paths()
+{
+    const int n = 200;
+    std::vector<int> label(n);
+    for (int i = 0; i < n; ++i)
+    {
+        label[i] = i;
+    }
+    std::shuffle(label.begin(), label.end(), std::mt19937(0));
+
+    coo_type coo(n, n);
+    for (int i = 0; i < n; ++i)
+    {
+        coo.entries.push_back(entry_type(label[i], label[i], 4));
+        // two paths: 0..99 and 100..199
+        if (i + 1 < n && i + 1 != n / 2)
+        {
+            coo.entries.push_back(entry_type(label[i], label[i + 1], -1));
+            coo.entries.push_back(entry_type(label[i + 1], label[i], -1));
+        }
+    }
+    csr_type a(coo);
+
+    std::vector<int> perm = rcm(a);
+    if (check_perm(perm, n))
+        return 1;
+    csr_type b = permute_symmetric(a, perm);
+    if (check_permuted(a, b, perm))
+        return 1;
+    if (bandwidth(b) != 1)
+    {
+        std::cerr << "ERR: expected bandwidth 1 after rcm, got " << bandwidth(b) << " (was " << bandwidth(a) << ")\n";
+        return 1;
+    }
+    return 0;
+}
+
+int test_file(const std::string &path)
+{
+    MtxReader<int, float> reader(path);
+    csr_type a(reader.read_coo());
+    std::vector<int> perm = rcm(a);
+    if (check_perm(perm, a.num_rows()))
+        return 1;
+    csr_type b = permute_symmetric(a, perm);
+    if (check_permuted(a, b, perm))
+        return 1;
+    if (bandwidth(b) > bandwidth(a))
+    {
+        std::cerr << "ERR: rcm increased bandwidth from " << bandwidth(a) << " to " << bandwidth(b) << " for " << path << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return 1;
+    }
+    std::string dataDir = argv[1];
+
+    if (test_shuffled_paths())
+        return 1;
+    if (test_file(dataDir + "/Trefethen_20b.mtx"))
+        return 1;
+    if (test_file(dataDir + "/mhd1280b.mtx"))
+        return 1;
+    if (test_file(dataDir + "/08blocks.mtx"))
+        return 1;
+
+    {
+        // the same ordering and permuted matrix from an arena-backed CSR, in the arena
+        typedef ArenaAllocator<char> alloc_t;
+        typedef CSR<int, float, size_t, alloc_t> arena_csr_t;
+        Arena arena(size_t(1) << 20);
+        const std::string path = dataDir + "/mhd1280b.mtx";
+        const csr_type a(MtxReader<int, float>(path).read_coo());
+        const arena_csr_t aa(MtxReader<int, float, size_t, alloc_t>(path).read_coo(alloc_t(arena)));
+        const std::vector<int> perm = rcm(aa);
+        if (perm != rcm(a))
+        {
+            std::cerr << "ERR: rcm differs for an arena-backed CSR\n";
+            return 1;
+        }
+        const arena_csr_t b = permute_symmetric(aa, perm);
+        const csr_type expected = permute_symmetric(a, perm);
+        if (!(b.get_allocator() == alloc_t(arena)) || !(b.row_ptr().get_allocator() == alloc_t(arena)) ||
+            !(b.col_ind().get_allocator() == alloc_t(arena)))
+        {
+            std::cerr << "ERR: permuted matrix did not come from the arena\n";
+            return 1;
+        }
+        if (bandwidth(b) != bandwidth(expected) ||
+            !std::equal(expected.col_ind().begin(), expected.col_ind().end(), b.col_ind().begin()) ||
+            !std::equal(expected.val().begin(), expected.val().end(), b.val().begin()))
+        {
+            std::cerr << "ERR: arena permuted matrix differs\n";
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#include "mm/row_index.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iterator>
+
+typedef CSR<int, double> csr_type;
+typedef MtxReader<int, double> reader_type;
+
+// write the entries of a to path in row order, with the given symmetry in the banner
+void write_by_row(const std::string &path, const csr_type &a, const std::string &symmetry)
+{
+    std::ofstream outf(path);
+    outf << "%%MatrixMarket matrix coordinate real " << symmetry << "\n";
+    outf << "% written by test_row_index\n";
+    outf << a.num_rows() << " " << a.num_cols() << " " << a.nnz() << "\n";
+    outf << std::setprecision(17);
+    for (int i = 0; i < a.num_rows(); ++i)
+    {
+        for (size_t k = a.row_ptr(i); k < a.row_ptr(i + 1); ++k)
+        {
+            outf << i + 1 << " " << a.col_ind(k) + 1 << " " << a.val(k) << "\n";
+        }
+    }
+}
+
+// read_rows of every range in bounds matches the rows of a
+int check_slabs(const reader_type &reader, const RowIndex<int> &index, const csr_type &a, const std::vector<int> &bounds)
+{
+    for (size_t b = 0; b + 1 < bounds.size(); ++b)
+    {
+        const int begin = bounds[b], end = bounds[b + 1];
+        const csr_type slab(read_rows(reader, index, begin, end));
+        if (slab.num_rows() != end - begin || slab.num_cols() != a.num_cols() || slab.nnz() != a.row_ptr(end) - a.row_ptr(begin) ||
+            !std::equal(slab.col_ind().begin(), slab.col_ind().end(), a.col_ind().begin() + a.row_ptr(begin)) ||
+            !std::equal(slab.val().begin(), slab.val().end(), a.val().begin() + a.row_ptr(begin)))
+        {
+            std::cerr << "ERR: rows [" << begin << ", " << end << ") differ\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return 1;
+    }
+    std::string dataDir = argv[1];
+
+    // the files are sorted by column
+    reader_type unsorted(dataDir + "/08blocks.mtx");
+    try
+    {
+        RowIndex<int>::build(unsorted);
+        std::cerr << "ERR: unsorted file was indexed\n";
+        return 1;
+    }
+    catch (const std::logic_error &)
+    {
+    }
+
+    const std::string path = "test_row_index_08blocks.mtx";
+    const csr_type a(unsorted.read_coo());
+    write_by_row(path, a, "general");
+    std::remove(RowIndex<int>::sidecar_path(path).c_str());
+    reader_type reader(path);
+    const int n = a.num_rows();
+    for (int stride : {1, 3, 64, 1000})
+    {
+        const RowIndex<int> index = RowIndex<int>::build(reader, stride);
+        if (check_slabs(reader, index, a, {0, n}) || check_slabs(reader, index, a, {0, 0, 1, 5, 17, 100, n - 1, n}) ||
+            check_slabs(reader, index, a, {n, n}))
+            return 1;
+    }
+
+    // the sidecar is saved, reused, and rebuilt when the file changes
+    const RowIndex<int> built = RowIndex<int>::load_or_build(reader, 7);
+    RowIndex<int> loaded;
+    if (!loaded.load(RowIndex<int>::sidecar_path(path)) || loaded.offsets() != built.offsets() || loaded.stride() != 7 ||
+        !loaded.is_current(path))
+    {
+        std::cerr << "ERR: sidecar was not saved\n";
+        return 1;
+    }
+    if (RowIndex<int>::load_or_build(reader, 64).stride() != 7)
+    {
+        std::cerr << "ERR: sidecar was not reused\n";
+        return 1;
+    }
+
+    // a corrupt sidecar is not loaded, and one that does not fit the file is rebuilt
+    {
+        const std::string sidecar = RowIndex<int>::sidecar_path(path);
+        std::string bytes;
+        {
+            std::ifstream inf(sidecar, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(inf), std::istreambuf_iterator<char>());
+        }
+        // header words after the 8-byte magic: size, time, rows, stride, blocks + 1
+        auto patched = [&](int word, uint64_t v)
+        {
+            std::string b = bytes;
+            std::memcpy(&b[8 + 8 * word], &v, sizeof(v));
+            std::ofstream(sidecar, std::ios::binary) << b;
+        };
+        const uint64_t blocks = (uint64_t(n) + 6) / 7 + 1;
+        for (const std::pair<int, uint64_t> &bad : std::vector<std::pair<int, uint64_t>>{
+                 {3, 0}, {4, uint64_t(1) << 40}, {4, blocks + 1}, {0, 16}})
+        {
+            patched(bad.first, bad.second);
+            RowIndex<int> corrupt;
+            if (corrupt.load(sidecar))
+            {
+                std::cerr << "ERR: loaded a sidecar with header word " << bad.first << " = " << bad.second << "\n";
+                return 1;
+            }
+        }
+        // an index of the same size and time, but of a file with 56 more rows
+        {
+            std::string b = bytes;
+            int64_t end;
+            std::memcpy(&end, &b[b.size() - sizeof(end)], sizeof(end));
+            const uint64_t rows = uint64_t(n) + 7 * 8, more = blocks + 8;
+            std::memcpy(&b[8 + 8 * 2], &rows, sizeof(rows));
+            std::memcpy(&b[8 + 8 * 4], &more, sizeof(more));
+            for (int k = 0; k < 8; ++k)
+            {
+                b.append(reinterpret_cast<const char *>(&end), sizeof(end));
+            }
+            std::ofstream(sidecar, std::ios::binary) << b;
+        }
+        RowIndex<int> other;
+        if (!other.load(sidecar) || other.fits(reader) || RowIndex<int>::load_or_build(reader, 5).stride() != 5)
+        {
+            std::cerr << "ERR: sidecar of another file was reused\n";
+            return 1;
+        }
+    }
+
+    std::ofstream(path, std::ios::app) << "% appended\n";
+    if (loaded.is_current(path))
+    {
+        std::cerr << "ERR: changed file was not noticed\n";
+        return 1;
+    }
+    const reader_type changed(path);
+    if (RowIndex<int>::load_or_build(changed, 64).stride() != 64 || check_slabs(changed, RowIndex<int>::load_or_build(changed), a, {0, 9, n}))
+        return 1;
+    std::remove(RowIndex<int>::sidecar_path(path).c_str());
+    std::remove(path.c_str());
+
+    // a symmetric file is read as its stored triangle
+    reader_type symReader(dataDir + "/Trefethen_20b.mtx");
+    symReader.set_expand_symmetry(false);
+    csr_type tri(symReader.read_coo());
+    const std::string symPath = "test_row_index_Trefethen_20b.mtx";
+    write_by_row(symPath, tri, "symmetric");
+    reader_type symSorted(symPath);
+    const RowIndex<int> symIndex = RowIndex<int>::build(symSorted, 4);
+    try
+    {
+        read_rows(symSorted, symIndex, 0, 5);
+        std::cerr << "ERR: expanded read of rows of a symmetric file was not rejected\n";
+        return 1;
+    }
+    catch (const std::logic_error &)
+    {
+    }
+    symSorted.set_expand_symmetry(false);
+    if (check_slabs(symSorted, symIndex, tri, {0, 3, 11, tri.num_rows()}))
+        return 1;
+    std::remove(symPath.c_str());
+    return 0;
+}
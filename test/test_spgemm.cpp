@@ -0,0 +1,107 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#include "mm/spgemm.hpp"
+
+#include <cmath>
+#include <map>
+
+typedef CSR<int, double> csr_type;
+
+// C = A B with a map per row
+csr_type reference(const csr_type &a, const csr_type &b)
+{
+    std::vector<size_t> rowPtr(1, 0);
+    std::vector<int> colInd;
+    std::vector<double> val;
+    for (int i = 0; i < a.num_rows(); ++i)
+    {
+        std::map<int, double> row;
+        for (size_t k = a.row_ptr(i); k < a.row_ptr(i + 1); ++k)
+        {
+            const int j = a.col_ind(k);
+            for (size_t q = b.row_ptr(j); q < b.row_ptr(j + 1); ++q)
+            {
+                row[b.col_ind(q)] += a.val(k) * b.val(q);
+            }
+        }
+        for (const auto &e : row)
+        {
+            colInd.push_back(e.first);
+            val.push_back(e.second);
+        }
+        rowPtr.push_back(colInd.size());
+    }
+    return csr_type(b.num_cols(), rowPtr, colInd, val);
+}
+
+int check(const csr_type &expected, const csr_type &c)
+{
+    if (c.num_rows() != expected.num_rows() || c.num_cols() != expected.num_cols() ||
+        c.row_ptr() != expected.row_ptr() || c.col_ind() != expected.col_ind())
+    {
+        std::cerr << "ERR: product has the wrong structure\n";
+        return 1;
+    }
+    for (size_t k = 0; k < c.nnz(); ++k)
+    {
+        if (std::abs(c.val(k) - expected.val(k)) > 1e-12 * (1 + std::abs(expected.val(k))))
+        {
+            std::cerr << "ERR: val[" << k << "] = " << c.val(k) << ", expected " << expected.val(k) << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return 1;
+    }
+    std::string dataDir = argv[1];
+
+    // small matrices use the dense accumulator for most rows, mhd1280b the hash table
+    for (const char *name : {"/08blocks.mtx", "/Trefethen_20b.mtx", "/mhd1280b.mtx", "/abb313.mtx"})
+    {
+        MtxReader<int, double> reader(dataDir + name);
+        const csr_type a(reader.read_coo());
+        const csr_type at = transpose(a);
+        for (int nThreads : {1, 3})
+        {
+            if (check(reference(at, a), spgemm(at, a, nThreads)))
+                return 1;
+            if (a.num_rows() == a.num_cols() && check(reference(a, a), spgemm(a, a, nThreads)))
+                return 1;
+        }
+    }
+
+    // Galerkin product with pairwise aggregation, P(i, i/2) = 1
+    MtxReader<int, double> reader(dataDir + "/Trefethen_20b.mtx");
+    const csr_type a(reader.read_coo());
+    std::vector<size_t> rowPtr(1, 0);
+    std::vector<int> colInd;
+    std::vector<double> val;
+    for (int i = 0; i < a.num_rows(); ++i)
+    {
+        colInd.push_back(i / 2);
+        val.push_back(1);
+        rowPtr.push_back(colInd.size());
+    }
+    const csr_type p((a.num_rows() + 1) / 2, rowPtr, colInd, val);
+    const csr_type r = transpose(p);
+    if (check(reference(reference(r, a), p), galerkin_product(r, a, p)))
+        return 1;
+
+    try
+    {
+        spgemm(a, r);
+        std::cerr << "ERR: mismatched shapes were not rejected\n";
+        return 1;
+    }
+    catch (const std::logic_error &)
+    {
+    }
+    return 0;
+}
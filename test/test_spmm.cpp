@@ -0,0 +1,83 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#include "mm/spmm.hpp"
+#include "mm/spmv.hpp"
+
+#include <cmath>
+
+typedef CSR<int, double> csr_type;
+
+/* spmm of nv vectors in layout, with padded leading dimensions, matches spmv of each vector,
+   and leaves the padding alone
+*/
+int check(const csr_type &a, int nv, DenseLayout layout)
+{
+    const bool rowMajor = DenseLayout::ROW_MAJOR == layout;
+    const size_t ldx = (rowMajor ? nv : a.num_cols()) + 3, ldy = (rowMajor ? nv : a.num_rows()) + 1;
+    const size_t nx = rowMajor ? a.num_cols() * ldx : nv * ldx, ny = rowMajor ? a.num_rows() * ldy : nv * ldy;
+    const double pad = -7;
+    std::vector<double> x(nx, pad), y(ny, pad);
+    auto xi = [&](int j, int v) -> double & { return rowMajor ? x[j * ldx + v] : x[v * ldx + j]; };
+    auto yi = [&](int i, int v) -> double & { return rowMajor ? y[i * ldy + v] : y[v * ldy + i]; };
+    for (int j = 0; j < a.num_cols(); ++j)
+    {
+        for (int v = 0; v < nv; ++v)
+        {
+            xi(j, v) = std::cos(double(j) + 0.5 * v);
+        }
+    }
+    spmm(y.data(), ldy, a, x.data(), ldx, nv, layout);
+
+    size_t written = 0;
+    for (int v = 0; v < nv; ++v)
+    {
+        std::vector<double> xv(a.num_cols()), ref(a.num_rows());
+        for (int j = 0; j < a.num_cols(); ++j)
+        {
+            xv[j] = xi(j, v);
+        }
+        spmv(ref, a, xv);
+        for (int i = 0; i < a.num_rows(); ++i)
+        {
+            if (std::abs(yi(i, v) - ref[i]) > 1e-12 * (1 + std::abs(ref[i])))
+            {
+                std::cerr << "ERR: nv=" << nv << " Y(" << i << "," << v << ") = " << yi(i, v) << ", expected " << ref[i] << "\n";
+                return 1;
+            }
+        }
+        written += a.num_rows();
+    }
+    if (size_t(std::count(y.begin(), y.end(), pad)) != ny - written)
+    {
+        std::cerr << "ERR: nv=" << nv << " wrote outside Y\n";
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return 1;
+    }
+    std::string dataDir = argv[1];
+
+    for (const char *name : {"/08blocks.mtx", "/abb313.mtx", "/mhd1280b.mtx"})
+    {
+        MtxReader<int, double> reader(dataDir + name);
+        const csr_type a(reader.read_coo());
+        for (int nThreads : {1, 3})
+        {
+            set_num_threads(nThreads);
+            // every panel width, and combinations of them
+            for (int nv : {0, 1, 2, 3, 4, 7, 8, 16, 32, 63})
+            {
+                if (check(a, nv, DenseLayout::ROW_MAJOR) || check(a, nv, DenseLayout::COL_MAJOR))
+                    return 1;
+            }
+        }
+    }
+    return 0;
+}
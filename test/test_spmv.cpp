@@ -0,0 +1,102 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#include "mm/spmv.hpp"
+
+typedef CSR<int, double> csr_type;
+
+// a and b have the same shape and entries
+template <typename A, typename B>
+int check_equal(const A &a, const B &b)
+{
+    if (a.num_rows() != b.num_rows() || a.num_cols() != b.num_cols() || a.nnz() != b.nnz())
+    {
+        std::cerr << "ERR: shape or nnz differs\n";
+        return 1;
+    }
+    if (!std::equal(a.row_ptr().begin(), a.row_ptr().end(), b.row_ptr().begin()) ||
+        !std::equal(a.col_ind().begin(), a.col_ind().end(), b.col_ind().begin()) ||
+        !std::equal(a.val().begin(), a.val().end(), b.val().begin()))
+    {
+        std::cerr << "ERR: entries differ\n";
+        return 1;
+    }
+    return 0;
+}
+
+// y = A x, serially
+std::vector<double> reference(const csr_type &a, const std::vector<double> &x)
+{
+    std::vector<double> y(a.num_rows(), 0);
+    for (int i = 0; i < a.num_rows(); ++i)
+    {
+        for (size_t k = a.row_ptr(i); k < a.row_ptr(i + 1); ++k)
+        {
+            y[i] += a.val(k) * x[a.col_ind(k)];
+        }
+    }
+    return y;
+}
+
+template <typename Y>
+int check_close(const Y &y, const std::vector<double> &ref)
+{
+    for (size_t i = 0; i < ref.size(); ++i)
+    {
+        if (std::abs(y[i] - ref[i]) > 1e-12 * (1 + std::abs(ref[i])))
+        {
+            std::cerr << "ERR: y[" << i << "] = " << y[i] << ", expected " << ref[i] << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return 1;
+    }
+    std::string dataDir = argv[1];
+
+    for (const char *name : {"/08blocks.mtx", "/abb313.mtx", "/mhd1280b.mtx"})
+    {
+        MtxReader<int, double> reader(dataDir + name);
+        const MtxReader<int, double>::coo_type coo = reader.read_coo();
+        const csr_type ref(coo);
+        std::vector<double> x(ref.num_cols());
+        for (size_t j = 0; j < x.size(); ++j)
+        {
+            x[j] = 1.0 / (j + 1);
+        }
+        const std::vector<double> yRef = reference(ref, x);
+
+        for (int nThreads : {1, 2, 5})
+        {
+            std::vector<int> bounds;
+            const CSR<int, double, size_t, DefaultInitAllocator<char>> a = first_touch_csr(coo, bounds, nThreads);
+            if (check_equal(ref, a))
+                return 1;
+            if (bounds != balanced_row_blocks(a, nThreads))
+            {
+                std::cerr << "ERR: first_touch_csr did not report its row blocks\n";
+                return 1;
+            }
+            if (check_equal(ref, first_touch_copy(ref, bounds)))
+                return 1;
+
+            std::vector<double, DefaultInitAllocator<double>> y(a.num_rows());
+            spmv(y, a, x, bounds);
+            if (check_close(y, yRef))
+                return 1;
+
+            set_num_threads(nThreads);
+            std::vector<double> y2(ref.num_rows());
+            spmv(y2, ref, x);
+            if (check_close(y2, yRef))
+                return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,161 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#include "mm/structure.hpp"
+
+#include <queue>
+#include <set>
+#include <utility>
+
+typedef MtxReader<int, double> reader_type;
+typedef COO<int, double> coo_type;
+typedef CSR<int, double> csr_type;
+
+// components of a by breadth-first search, numbered in order of their smallest vertex
+Components<int> bfs_components(const coo_type &a)
+{
+    const int nr = a.num_rows(), nc = a.num_cols();
+    const int n = num_graph_vertices(nr, nc);
+    std::vector<std::vector<int>> adj(n);
+    for (const coo_type::entry_type &e : a.entries)
+    {
+        adj[e.i].push_back(column_vertex(nr, nc, e.j));
+        adj[column_vertex(nr, nc, e.j)].push_back(e.i);
+    }
+    Components<int> c;
+    c.label.assign(n, -1);
+    for (int s = 0; s < n; ++s)
+    {
+        if (c.label[s] >= 0)
+        {
+            continue;
+        }
+        const int id = c.count();
+        c.size.push_back(0);
+        std::queue<int> q;
+        q.push(s);
+        c.label[s] = id;
+        while (!q.empty())
+        {
+            const int u = q.front();
+            q.pop();
+            ++c.size[id];
+            for (int v : adj[u])
+            {
+                if (c.label[v] < 0)
+                {
+                    c.label[v] = id;
+                    q.push(v);
+                }
+            }
+        }
+    }
+    return c;
+}
+
+double set_symmetry(const coo_type &a)
+{
+    std::set<std::pair<int, int>> entries;
+    for (const coo_type::entry_type &e : a.entries)
+    {
+        entries.insert(std::make_pair(e.i, e.j));
+    }
+    uint64_t offDiag = 0, matched = 0;
+    for (const std::pair<int, int> &e : entries)
+    {
+        if (e.first != e.second)
+        {
+            ++offDiag;
+            matched += entries.count(std::make_pair(e.second, e.first));
+        }
+    }
+    return 0 == offDiag ? 1.0 : double(matched) / double(offDiag);
+}
+
+int check(const std::string &path)
+{
+    const coo_type coo = reader_type(path).read_coo();
+    const csr_type csr(coo);
+    const Components<int> expected = bfs_components(coo);
+    for (int nThreads : {1, 3, 8})
+    {
+        const Components<int> fromCoo = connected_components(coo, nThreads);
+        const Components<int> fromCsr = connected_components(csr, nThreads);
+        if (fromCoo.label != expected.label || fromCoo.size != expected.size || fromCsr.label != expected.label ||
+            fromCsr.size != expected.size)
+        {
+            std::cerr << "ERR: components of " << path << " differ with " << nThreads << " threads (" << fromCoo.count()
+                      << " and " << fromCsr.count() << ", expected " << expected.count() << ")\n";
+            return 1;
+        }
+        if (csr.num_rows() == csr.num_cols() && std::abs(structural_symmetry(csr, nThreads) - set_symmetry(coo)) > 1e-12)
+        {
+            std::cerr << "ERR: structural symmetry of " << path << " is " << structural_symmetry(csr, nThreads)
+                      << ", expected " << set_symmetry(coo) << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return 1;
+    }
+    std::string dataDir = argv[1];
+
+    // many threads racing to unite one long chain, in both directions
+    {
+        const int n = 100000;
+        ConcurrentUnionFind<int> uf(n, 4);
+        parallel_run(4, [&](int t)
+                     {
+            // thread t has every fourth link; odd threads walk theirs backwards
+            const int links = (n - 1) / 4;
+            for (int k = 0; k < links; ++k) {
+                const int i = 4 * (t % 2 ? links - 1 - k : k) + t;
+                uf.unite(i, i + 1);
+            } });
+        for (int i = 4 * ((n - 1) / 4); i < n - 1; ++i)
+        {
+            uf.unite(i + 1, i);
+        }
+        for (int i = 0; i < n; ++i)
+        {
+            if (uf.find(i) != 0)
+            {
+                std::cerr << "ERR: chain is not one set at " << i << "\n";
+                return 1;
+            }
+        }
+    }
+
+    // square general, rectangular, symmetric, skew-symmetric
+    if (check(dataDir + "/08blocks.mtx") || check(dataDir + "/abb313.mtx") || check(dataDir + "/Trefethen_20b.mtx") ||
+        check(dataDir + "/plskz362.mtx"))
+    {
+        return 1;
+    }
+
+    // a triangle has no mirrored entries; symmetric storage is symmetric
+    {
+        reader_type reader(dataDir + "/Trefethen_20b.mtx");
+        reader.set_expand_symmetry(false);
+        csr_type lower(reader.read_coo());
+        if (structural_symmetry(lower) != 1)
+        {
+            std::cerr << "ERR: symmetric storage is not structurally symmetric\n";
+            return 1;
+        }
+        lower.set_symmetry(Info::Symmetry::GENERAL);
+        if (structural_symmetry(lower, 3) != 0)
+        {
+            std::cerr << "ERR: a triangle is structurally symmetric\n";
+            return 1;
+        }
+    }
+
+    return 0;
+}
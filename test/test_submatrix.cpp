@@ -0,0 +1,147 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#include "mm/alloc.hpp"
+#include "mm/submatrix.hpp"
+
+#include <random>
+
+typedef CSR<int, float> csr_type;
+
+// value of A(i,j), or 0
+float at(const csr_type &a, int i, int j)
+{
+    for (size_t k = a.row_ptr(i); k < a.row_ptr(i + 1); ++k)
+    {
+        if (a.col_ind(k) == j)
+        {
+            return a.val(k);
+        }
+    }
+    return 0;
+}
+
+int check_sorted(const csr_type &b)
+{
+    for (int i = 0; i < b.num_rows(); ++i)
+    {
+        for (size_t k = b.row_ptr(i) + 1; k < b.row_ptr(i + 1); ++k)
+        {
+            if (b.col_ind(k - 1) >= b.col_ind(k))
+            {
+                std::cerr << "ERR: row " << i << " is not sorted\n";
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* every B(r, c) should be A(rows[r], cols[c]), and B should have every non-zero of that submatrix
+*/
+int check_extract(const csr_type &a, const csr_type &b, const std::vector<int> &rows, const std::vector<int> &cols)
+{
+    if (b.num_rows() != int(rows.size()) || b.num_cols() != int(cols.size()))
+    {
+        std::cerr << "ERR: extracted matrix is " << b.num_rows() << " x " << b.num_cols() << "\n";
+        return 1;
+    }
+    if (check_sorted(b))
+        return 1;
+    size_t nnz = 0;
+    for (size_t r = 0; r < rows.size(); ++r)
+    {
+        for (size_t c = 0; c < cols.size(); ++c)
+        {
+            const float expected = at(a, rows[r], cols[c]);
+            nnz += (expected != 0);
+            if (at(b, int(r), int(c)) != expected)
+            {
+                std::cerr << "ERR: B(" << r << "," << c << ") = " << at(b, int(r), int(c)) << ", expected " << expected << "\n";
+                return 1;
+            }
+        }
+    }
+    if (nnz != b.nnz())
+    {
+        std::cerr << "ERR: extracted " << b.nnz() << " entries, expected " << nnz << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+std::vector<int> iota(int begin, int end)
+{
+    std::vector<int> v;
+    for (int i = begin; i < end; ++i)
+    {
+        v.push_back(i);
+    }
+    return v;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return 1;
+    }
+    std::string dataDir = argv[1];
+
+    MtxReader<int, float> reader(dataDir + "/08blocks.mtx");
+    csr_type a(reader.read_coo());
+    std::mt19937 g(0);
+
+    for (int nThreads : {1, 3})
+    {
+        set_num_threads(nThreads);
+
+        // diagonal block
+        if (check_extract(a, extract(a, 40, 120, 40, 120), iota(40, 120), iota(40, 120)))
+            return 1;
+
+        // row and column permutation
+        std::vector<int> rowPerm = iota(0, a.num_rows()), colPerm = iota(0, a.num_cols());
+        std::shuffle(rowPerm.begin(), rowPerm.end(), g);
+        std::shuffle(colPerm.begin(), colPerm.end(), g);
+        if (check_extract(a, permute(a, rowPerm, colPerm), rowPerm, colPerm))
+            return 1;
+        if (check_extract(a, permute(a, rowPerm, std::vector<int>()), rowPerm, iota(0, a.num_cols())))
+            return 1;
+
+        // arbitrary subsets, with repeated rows
+        std::vector<int> rows = {5, 5, 299, 0, 37, 36};
+        std::vector<int> cols = {1, 250, 3, 0, 36};
+        if (check_extract(a, extract(a, rows, cols), rows, cols))
+            return 1;
+    }
+
+    {
+        // results come from the source's allocator
+        typedef ArenaAllocator<char> alloc_t;
+        typedef CSR<int, float, size_t, alloc_t> arena_csr_t;
+        Arena arena(size_t(1) << 20);
+        const arena_csr_t aa(MtxReader<int, float, size_t, alloc_t>(dataDir + "/08blocks.mtx").read_coo(alloc_t(arena)));
+        std::vector<int> rowPerm = iota(0, a.num_rows());
+        std::shuffle(rowPerm.begin(), rowPerm.end(), g);
+        const arena_csr_t blocks[] = {extract(aa, 40, 120, 40, 120), permute(aa, rowPerm, std::vector<int>())};
+        const csr_type expected[] = {extract(a, 40, 120, 40, 120), permute(a, rowPerm, std::vector<int>())};
+        for (int b = 0; b < 2; ++b)
+        {
+            if (!(blocks[b].get_allocator() == alloc_t(arena)) || !(blocks[b].row_ptr().get_allocator() == alloc_t(arena)) ||
+                !(blocks[b].col_ind().get_allocator() == alloc_t(arena)))
+            {
+                std::cerr << "ERR: submatrix did not come from the arena\n";
+                return 1;
+            }
+            if (!std::equal(expected[b].row_ptr().begin(), expected[b].row_ptr().end(), blocks[b].row_ptr().begin()) ||
+                !std::equal(expected[b].col_ind().begin(), expected[b].col_ind().end(), blocks[b].col_ind().begin()) ||
+                !std::equal(expected[b].val().begin(), expected[b].val().end(), blocks[b].val().begin()))
+            {
+                std::cerr << "ERR: arena submatrix differs\n";
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
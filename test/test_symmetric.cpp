@@ -0,0 +1,129 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#include "mm/spmv.hpp"
+
+#include <cmath>
+#include <complex>
+
+/* load path with one triangle stored, and check it against the expanded load:
+   expand() gives the same matrix, and SpMV on the stored triangle gives the same product
+*/
+template <typename Scalar>
+int check(const std::string &path, Info::Symmetry expected)
+{
+    typedef CSR<int, Scalar> csr_type;
+    MtxReader<int, Scalar> full(path);
+    const csr_type a(full.read_coo());
+
+    MtxReader<int, Scalar> reader(path);
+    reader.set_expand_symmetry(false);
+    const csr_type tri(reader.read_coo());
+    if (tri.symmetry() != expected || a.symmetry() != Info::Symmetry::GENERAL)
+    {
+        std::cerr << "ERR: " << path << ": wrong symmetry tag\n";
+        return 1;
+    }
+    if (tri.nnz() >= a.nnz())
+    {
+        std::cerr << "ERR: " << path << ": stored " << tri.nnz() << " of " << a.nnz() << " entries\n";
+        return 1;
+    }
+    for (int i = 0; i < tri.num_rows(); ++i)
+    {
+        for (size_t k = tri.row_ptr(i); k < tri.row_ptr(i + 1); ++k)
+        {
+            if (tri.col_ind(k) > i)
+            {
+                std::cerr << "ERR: " << path << ": entry above the diagonal\n";
+                return 1;
+            }
+        }
+    }
+
+    const csr_type b = expand(tri);
+    if (b.symmetry() != Info::Symmetry::GENERAL || a.row_ptr() != b.row_ptr() || a.col_ind() != b.col_ind() ||
+        !std::equal(a.val().begin(), a.val().end(), b.val().begin()))
+    {
+        std::cerr << "ERR: " << path << ": expand() differs from the expanded load\n";
+        return 1;
+    }
+    const csr_type t = transpose(b);
+    for (size_t k = 0; k < b.nnz(); ++k)
+    {
+        if (!(t.val(k) == mirror(expected, b.val(k))))
+        {
+            std::cerr << "ERR: " << path << ": entry " << k << " is not the mirror of its transpose\n";
+            return 1;
+        }
+    }
+
+    std::vector<Scalar> x(a.num_cols());
+    for (size_t j = 0; j < x.size(); ++j)
+    {
+        x[j] = Scalar(std::cos(double(j)));
+    }
+    std::vector<Scalar> ref(a.num_rows());
+    spmv(ref, a, x, std::vector<int>{0, a.num_rows()});
+    for (int nThreads : {1, 3})
+    {
+        set_num_threads(nThreads);
+        std::vector<Scalar> y(a.num_rows(), Scalar(1)); // overwritten
+        spmv(y, tri, x);
+        SymmetricSpmvSchedule<int, Scalar> sched(tri, balanced_row_blocks(tri, nThreads));
+        if (1 == nThreads && sched.num_buffered() != 0)
+        {
+            std::cerr << "ERR: " << path << ": one thread buffers " << sched.num_buffered() << " columns\n";
+            return 1;
+        }
+        // the schedule's buffers are reused
+        for (int rep = 0; rep < 3; ++rep)
+        {
+            std::vector<Scalar> ys(a.num_rows(), Scalar(1));
+            spmv_symmetric(ys, tri, x, sched);
+            for (size_t i = 0; i < y.size(); ++i)
+            {
+                if (std::abs(y[i] - ref[i]) > 1e-12 * (1 + std::abs(ref[i])) || ys[i] != y[i])
+                {
+                    std::cerr << "ERR: " << path << ": y[" << i << "] = " << y[i] << " and " << ys[i] << ", expected "
+                              << ref[i] << "\n";
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return 1;
+    }
+    std::string dataDir = argv[1];
+
+    if (check<double>(dataDir + "/plskz362.mtx", Info::Symmetry::SKEW) ||
+        check<double>(dataDir + "/Trefethen_20b.mtx", Info::Symmetry::SYMMETRIC) ||
+        check<std::complex<double>>(dataDir + "/mhd1280b.mtx", Info::Symmetry::HERMITIAN))
+        return 1;
+
+    // an empty matrix
+    {
+        CSR<int, double> empty(0, CSR<int, double>::row_ptr_type{0}, CSR<int, double>::col_ind_type{},
+                               CSR<int, double>::val_type{});
+        empty.set_symmetry(Info::Symmetry::SYMMETRIC);
+        std::vector<double> x, y;
+        spmv(y, empty, x);
+    }
+
+    // general matrices are not affected
+    MtxReader<int, double> reader(dataDir + "/08blocks.mtx");
+    reader.set_expand_symmetry(false);
+    if (CSR<int, double>(reader.read_coo()).symmetry() != Info::Symmetry::GENERAL)
+    {
+        std::cerr << "ERR: general matrix was tagged\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,145 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#include "mm/trsv.hpp"
+
+#include <cmath>
+
+typedef CSR<int, double> csr_type;
+typedef COO<int, double> coo_type;
+
+// x = T^-1 b, serially in row order
+std::vector<double> reference(const csr_type &a, const std::vector<double> &b, Triangle triangle, Diagonal diagonal)
+{
+    const int n = a.num_rows();
+    std::vector<double> x(n);
+    for (int q = 0; q < n; ++q)
+    {
+        const int i = Triangle::LOWER == triangle ? q : n - 1 - q;
+        double acc = b[i], d = 1;
+        for (size_t k = a.row_ptr(i); k < a.row_ptr(i + 1); ++k)
+        {
+            const int j = a.col_ind(k);
+            if (j == i)
+            {
+                d = a.val(k);
+            }
+            else if ((j < i) == (Triangle::LOWER == triangle))
+            {
+                acc -= a.val(k) * x[j];
+            }
+        }
+        x[i] = Diagonal::UNIT == diagonal ? acc : acc / d;
+    }
+    return x;
+}
+
+int check(const csr_type &a, Triangle triangle, Diagonal diagonal)
+{
+    std::vector<double> b(a.num_rows());
+    for (size_t i = 0; i < b.size(); ++i)
+    {
+        b[i] = std::sin(double(i) + 1);
+    }
+    const std::vector<double> ref = reference(a, b, triangle, diagonal);
+    for (int nThreads : {1, 3})
+    {
+        const TrsvSchedule<int> s(a, triangle, diagonal, nThreads);
+        // solve twice with the same schedule, the second time in place
+        std::vector<double> x(a.num_rows()), y(b);
+        trsv(x, a, b, s);
+        trsv(y, a, y, s);
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            if (std::abs(x[i] - ref[i]) > 1e-10 * (1 + std::abs(ref[i])) || x[i] != y[i])
+            {
+                std::cerr << "ERR: x[" << i << "] = " << x[i] << " (in place " << y[i] << "), expected " << ref[i]
+                          << ", " << s.num_levels() << " levels in " << s.num_phases() << " phases\n";
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// a with every diagonal entry replaced by 1 + its row's absolute sum
+csr_type dominant(const csr_type &a)
+{
+    coo_type coo(a.num_rows(), a.num_cols());
+    for (int i = 0; i < a.num_rows(); ++i)
+    {
+        double sum = 1;
+        for (size_t k = a.row_ptr(i); k < a.row_ptr(i + 1); ++k)
+        {
+            if (a.col_ind(k) != i)
+            {
+                coo.entries.push_back(coo_type::entry_type(i, a.col_ind(k), a.val(k)));
+                sum += std::abs(a.val(k));
+            }
+        }
+        coo.entries.push_back(coo_type::entry_type(i, i, sum));
+    }
+    return csr_type(coo);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return 1;
+    }
+    std::string dataDir = argv[1];
+
+    // a combined L and U, as left by an incomplete factorization
+    std::vector<csr_type> mats;
+    for (const char *name : {"/mhd1280b.mtx", "/Trefethen_20b.mtx"})
+    {
+        MtxReader<int, double> reader(dataDir + name);
+        mats.push_back(dominant(csr_type(reader.read_coo())));
+    }
+
+    // 8 wide levels of 1000 rows each in both triangles, solved in parallel
+    const int n = 8000;
+    coo_type coo(n, n);
+    for (int i = 0; i < n; ++i)
+    {
+        coo.entries.push_back(coo_type::entry_type(i, i, 2));
+        if (i >= 1000)
+        {
+            const int j = (i / 1000 - 1) * 1000 + (i * 7) % 1000; // in the previous block
+            coo.entries.push_back(coo_type::entry_type(i, j, 0.5));
+            coo.entries.push_back(coo_type::entry_type(j, i, -0.25));
+        }
+    }
+    mats.push_back(csr_type(coo));
+
+    for (const csr_type &a : mats)
+    {
+        for (Triangle triangle : {Triangle::LOWER, Triangle::UPPER})
+        {
+            if (check(a, triangle, Diagonal::UNIT) || check(a, triangle, Diagonal::NON_UNIT))
+                return 1;
+        }
+    }
+    const TrsvSchedule<int> wide(mats.back(), Triangle::LOWER, Diagonal::NON_UNIT, 3);
+    if (wide.num_levels() != 8 || wide.num_phases() != 8)
+    {
+        std::cerr << "ERR: expected 8 parallel levels, got " << wide.num_levels() << " levels in " << wide.num_phases() << " phases\n";
+        return 1;
+    }
+
+    // a missing diagonal is reported at analysis
+    coo_type noDiag(2, 2);
+    noDiag.entries.push_back(coo_type::entry_type(0, 0, 1));
+    noDiag.entries.push_back(coo_type::entry_type(1, 0, 1));
+    try
+    {
+        TrsvSchedule<int> s(csr_type(noDiag), Triangle::LOWER, Diagonal::NON_UNIT);
+        std::cerr << "ERR: missing diagonal was not rejected\n";
+        return 1;
+    }
+    catch (const std::logic_error &)
+    {
+    }
+    return 0;
+}
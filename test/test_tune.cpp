@@ -0,0 +1,154 @@
+// Copyright (C) 2021 Carl Pearson
+// This code is released under the GPLv3 license
+
+#include "mm/tune.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+typedef MtxReader<int, double> reader_type;
+typedef CSR<int, double> csr_type;
+
+// every layout gives the same y as CSR, up to the order of the sums
+int check_layouts(const csr_type &a)
+{
+    std::vector<double> x(a.num_cols()), expected(a.num_rows());
+    for (int j = 0; j < a.num_cols(); ++j)
+    {
+        x[j] = 1.0 + j % 7;
+    }
+    spmv(expected, a, x);
+    for (SpmvFormat format : {SpmvFormat::CSR, SpmvFormat::COMPRESSED16, SpmvFormat::COMPRESSED8, SpmvFormat::BLOCKED})
+    {
+        for (int threads : {1, 3})
+        {
+            SpmvDecision d;
+            d.format = format;
+            d.threads = threads;
+            std::vector<double> y(a.num_rows(), -1);
+            TunedSpmv<int, double>(a, d).apply(y, x);
+            for (int i = 0; i < a.num_rows(); ++i)
+            {
+                if (std::abs(y[i] - expected[i]) > 1e-12 * (1 + std::abs(expected[i])))
+                {
+                    std::cerr << "ERR: " << to_string(format) << " on " << threads << " threads differs\n";
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return 1;
+    }
+    std::string dataDir = argv[1];
+
+    // features of a dense 4x4 and a diagonal
+    {
+        const csr_type dense(4, csr_type::row_ptr_type{0, 4, 8, 12, 16}, csr_type::col_ind_type{0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3},
+                             csr_type::val_type(16, 1.0));
+        const SpmvFeatures f = spmv_features(dense);
+        const csr_type diag(8, csr_type::row_ptr_type{0, 1, 2, 3, 4, 5, 6, 7, 8}, csr_type::col_ind_type{0, 1, 2, 3, 4, 5, 6, 7},
+                            csr_type::val_type(8, 2.0));
+        const SpmvFeatures g = spmv_features(diag);
+        if (f.rowMean != 4 || f.bandwidth != 3 || f.rowSpan != 3 || g.rowMean != 1 || g.bandwidth != 0 || g.rowSpan != 0)
+        {
+            std::cerr << "ERR: features\n";
+            return 1;
+        }
+
+        // one entry per row saves nothing by compressing, and a narrow band nothing by blocking
+        SpmvTuneOptions opts;
+        opts.minBlockedCols = 4;
+        if (tune_spmv(diag, opts).format != SpmvFormat::CSR)
+        {
+            std::cerr << "ERR: diagonal tuned to another layout than CSR\n";
+            return 1;
+        }
+    }
+
+    const csr_type a(reader_type(dataDir + "/08blocks.mtx").read_coo());
+    const csr_type b(reader_type(dataDir + "/plskz362.mtx").read_coo());
+    if (check_layouts(a) || check_layouts(b))
+    {
+        return 1;
+    }
+
+    // the fingerprint follows the structure, not the values; the key also the types and threads
+    {
+        csr_type scaled(a.num_cols(), a.row_ptr(), a.col_ind(), csr_type::val_type(a.nnz(), 3.0));
+        const CSR<int, float> single(a.num_cols(), CSR<int, float>::row_ptr_type(a.row_ptr().begin(), a.row_ptr().end()),
+                                     a.col_ind(), CSR<int, float>::val_type(a.nnz(), 1.0f));
+        if (spmv_fingerprint(scaled) != spmv_fingerprint(a) || spmv_fingerprint(a) == spmv_fingerprint(b) ||
+            spmv_fingerprint(single) != spmv_fingerprint(a))
+        {
+            std::cerr << "ERR: fingerprint\n";
+            return 1;
+        }
+        if (spmv_tune_key(scaled, 2) != spmv_tune_key(a, 2) || spmv_tune_key(single, 2) == spmv_tune_key(a, 2) ||
+            spmv_tune_key(a, 3) == spmv_tune_key(a, 2))
+        {
+            std::cerr << "ERR: tune key\n";
+            return 1;
+        }
+    }
+
+    // the decision is saved and reused
+    {
+        const std::string path = "test_tune.cache";
+        std::remove(path.c_str());
+        SpmvTuneOptions opts;
+        opts.trials = 2;
+        opts.maxThreads = 2;
+        opts.minParallelNnz = 0;
+        opts.cachePath = path;
+        SpmvFeatures f;
+        const SpmvDecision first = tune_spmv(a, opts, &f);
+        const SpmvDecision second = tune_spmv(a, opts);
+        tune_spmv(b, opts);
+        SpmvTuneOptions more = opts;
+        more.maxThreads = 3;
+        const SpmvDecision third = tune_spmv(a, more);
+        const bool tmpLeft = bool(std::ifstream(path + ".tmp" + std::to_string(getpid())));
+        {
+            std::ofstream outf(path, std::ios::app);
+            outf << "123 diagonal 4 0.5\n"; // a format this version doesn't have
+        }
+        SpmvTuneCache cache;
+        const bool loaded = cache.load(path);
+        std::remove(path.c_str());
+        if (first.cached || !second.cached || second.format != first.format || second.threads != first.threads ||
+            first.key != spmv_tune_key(a, 2) || f.rowMean <= 0 || third.cached || tmpLeft)
+        {
+            std::cerr << "ERR: decision not reused\n";
+            return 1;
+        }
+        if (!loaded || cache.size() != 3 || !cache.find(spmv_tune_key(b, 2)) || !cache.find(spmv_tune_key(a, 3)) || cache.find(123))
+        {
+            std::cerr << "ERR: cache holds " << cache.size() << " decisions\n";
+            return 1;
+        }
+    }
+
+    // symmetric storage is not tuned
+    {
+        reader_type reader(dataDir + "/Trefethen_20b.mtx");
+        reader.set_expand_symmetry(false);
+        try
+        {
+            tune_spmv(csr_type(reader.read_coo()));
+            std::cerr << "ERR: tuned symmetric storage\n";
+            return 1;
+        }
+        catch (const std::logic_error &)
+        {
+        }
+    }
+
+    return 0;
+}
@@ -6,6 +6,18 @@
 #include <algorithm>
 #include <vector>
 
+/* An implicit, static 2D KD-tree for counting points in axis-aligned ranges.
+
+   The points are partitioned in place with nth_element so that for any range
+   [lo, hi), the node is the point at mid = lo + (hi-lo)/2, its left subtree is
+   [lo, mid) and its right subtree is [mid+1, hi). No per-node allocations are
+   made: the tree is the point array plus a parallel array of subtree bounding
+   boxes, and the size of any subtree is just hi-lo.
+
+   Subtrees whose bounding box is contained in the query are counted in O(1),
+   and subtrees whose bounding box is disjoint from the query are skipped.
+   Subtrees at or below LEAF_SIZE points are scanned linearly.
+*/
 class KD {
 public:
     struct Point {
@@ -37,94 +49,133 @@ public:
 
     };
 private:
-    struct Node {
-        Point location;
-        Node *left;
-        Node *right;
-        Node() : left(nullptr), right(nullptr) {}
-        ~Node() {
-            if (left) delete left;
-            if (right) delete right;
-        }
-    };
 
-    Node *root_;
-
-    Node *helper(Point *begin, Point *end, int depth) {
-        // all work is done within the memory from begin to end
+    // inclusive bounds of all points in a subtree
+    struct Box {
+        int ilo;
+        int ihi;
+        int jlo;
+        int jhi;
+    };
 
-        if (begin >= end) {return nullptr;}
+    // a subtree is the points in [lo, hi), split on i (depth even) or j (depth odd)
+    struct Range {
+        int lo;
+        int hi;
+        int depth;
+        Range() = default;
+        Range(int _lo, int _hi, int _depth) : lo(_lo), hi(_hi), depth(_depth) {}
+    };
 
-        const int iAxis = depth % 2;
+    static constexpr int LEAF_SIZE = 16;
 
+    std::vector<Point> points_;
+    std::vector<Box> boxes_; // boxes_[mid] is the bounding box of the subtree rooted at mid
 
-        if (iAxis) {
-            std::sort(begin, end, Point::by_ij);
-        } else {
-            std::sort(begin, end, Point::by_ji);
+    void build() {
+        const int n = int(points_.size());
+        if (0 == n) {
+            return;
         }
+        boxes_.resize(n);
+
+        std::vector<Range> stack;
+        stack.push_back(Range(0, n, 0));
+        while (!stack.empty()) {
+            const Range r = stack.back();
+            stack.pop_back();
+
+            const int mid = r.lo + (r.hi - r.lo) / 2;
+            Point *begin = &points_[0] + r.lo;
+            Point *end = &points_[0] + r.hi;
+
+            Box b;
+            b.ilo = b.ihi = begin->i;
+            b.jlo = b.jhi = begin->j;
+            for (const Point *p = begin + 1; p < end; ++p) {
+                b.ilo = std::min(b.ilo, p->i);
+                b.ihi = std::max(b.ihi, p->i);
+                b.jlo = std::min(b.jlo, p->j);
+                b.jhi = std::max(b.jhi, p->j);
+            }
+            boxes_[mid] = b;
 
-        // split across median
-        int mi = (end-begin) / 2;
+            if (r.hi - r.lo <= LEAF_SIZE) {
+                continue; // leaves are scanned, not split
+            }
 
-        Node *n = new Node;
+            // split across median
+            if (r.depth % 2) {
+                std::nth_element(begin, &points_[mid], end, Point::by_ji);
+            } else {
+                std::nth_element(begin, &points_[mid], end, Point::by_ij);
+            }
 
-        // split points across median
-        n->location = begin[mi];
-        n->left = helper(begin, begin+mi, depth+1);
-        n->right = helper(begin+mi+1, end, depth+1);
-        
-        return n;
+            stack.push_back(Range(r.lo, mid, r.depth + 1));
+            stack.push_back(Range(mid + 1, r.hi, r.depth + 1));
+        }
     }
 
+public:
+    KD(std::vector<Point> ps /* by value so we can use it as scratch*/) : points_(std::move(ps)) {
+        build();
+    }
 
+    // number of points in the tree
+    int size() const { return int(points_.size()); }
 
     // count all points in [ilb...iub) and [jlb...jub)
-    int range_count_helper(Node *n, int ilb, int iub, int jlb ,int jub, int depth) const {
-
-        int i = n->location.i;
-        int j = n->location.j;
+    int range_count(int ilb, int iub, int jlb ,int jub) const {
 
-        int count = 0;
-        // node location is in the range
-        if (i >= ilb && i < iub && j >= jlb && j < jub) {
-            count += 1;
+        if (points_.empty() || ilb >= iub || jlb >= jub) {
+            return 0;
         }
 
+        // inclusive query bounds, to compare against the inclusive boxes
+        const int iqh = iub - 1;
+        const int jqh = jub - 1;
 
-        int iAxis = depth % 2;
+        int count = 0;
+        Range stack[64]; // depth is bounded by log2(INT_MAX) for a balanced tree
+        int top = 0;
+        stack[top++] = Range(0, int(points_.size()), 0);
+        while (top > 0) {
+            const Range r = stack[--top];
+            const int mid = r.lo + (r.hi - r.lo) / 2;
+            const Box &b = boxes_[mid];
+
+            // subtree is disjoint from the query
+            if (b.ihi < ilb || b.ilo > iqh || b.jhi < jlb || b.jlo > jqh) {
+                continue;
+            }
+            // subtree is totally contained in the query
+            if (b.ilo >= ilb && b.ihi <= iqh && b.jlo >= jlb && b.jhi <= jqh) {
+                count += r.hi - r.lo;
+                continue;
+            }
 
-        if (iAxis) {
-            // TODO: optimization if subtree is totally contained
-            if (i >= ilb && n->left) {
-                count += range_count_helper(n->left, ilb, iub, jlb, jub, depth+1);
+            if (r.hi - r.lo <= LEAF_SIZE) {
+                for (int k = r.lo; k < r.hi; ++k) {
+                    const Point &p = points_[k];
+                    if (p.i >= ilb && p.i < iub && p.j >= jlb && p.j < jub) {
+                        ++count;
+                    }
+                }
+                continue;
             }
-            if (i < iub && n->right) {
-                count += range_count_helper(n->right, ilb, iub, jlb, jub, depth+1);
+
+            const Point &p = points_[mid];
+            if (p.i >= ilb && p.i < iub && p.j >= jlb && p.j < jub) {
+                ++count;
             }
-        } else {
-            // TODO: optimization if subtree is totally contained
-            if (j >= jlb && n->left) {
-                count += range_count_helper(n->left, ilb, iub, jlb, jub, depth+1);
+            if (r.lo < mid) {
+                stack[top++] = Range(r.lo, mid, r.depth + 1);
             }
-            if (j < jub && n->right) {
-                count += range_count_helper(n->right, ilb, iub, jlb, jub, depth+1);
+            if (mid + 1 < r.hi) {
+                stack[top++] = Range(mid + 1, r.hi, r.depth + 1);
             }
         }
         return count;
     }
 
-public:
-    KD(std::vector<Point> ps /* by value so we can use it as scratch*/) {
-        root_ = helper(&ps[0], &ps[ps.size()], 0);
-    }
-    ~KD() {
-        delete root_;
-    }
-
-    // find all points in [ilb...iub) and [jlb...jub)
-    int range_count(int ilb, int iub, int jlb ,int jub) const {
-        return range_count_helper(root_, ilb, iub, jlb , jub, 0);
-    }
-
-};
\ No newline at end of file
+};
@@ -2,6 +2,7 @@
 // This code is released under the GPLv3 license
 
 #include "mm/mm.hpp"
+#include "mm/prefetch.hpp"
 #include "kd.hpp"
 
 #include <algorithm>
@@ -214,14 +215,16 @@ int main(int argc, char **argv) {
     }
     std::cout << "\n";
 
-    // read as coo data
+    // read as coo data, the next file in the background while this one is analyzed
+    CooPrefetcher<Ordinal, Scalar, Offset> loader(std::vector<std::string>(argv + 1, argv + argc), 1,
+                                                  physical_memory_bytes() / 4);
     for (int arg = 1; arg < argc; ++arg) {
 
         std::cout << argv[arg] << std::flush;
-        reader_t reader(argv[arg]);
+        std::future<coo_t> pending = loader.next();
         coo_t mat;
         try {
-            mat = reader.read_coo();
+            mat = pending.get();
 
         } catch (const std::exception &e) {
             // on error, blank, but print failure reason
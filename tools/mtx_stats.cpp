@@ -2,6 +2,9 @@
 // This code is released under the GPLv3 license
 
 #include "mm/mm.hpp"
+#include "mm/prefetch.hpp"
+#include "mm/rcm.hpp"
+#include "mm/structure.hpp"
 
 #include <algorithm>
 #include <limits>
@@ -16,6 +19,7 @@ using Offset = size_t;
 using reader_t = MtxReader<Ordinal, Scalar, Offset>;
 using coo_t = reader_t::coo_type;
 using entry_t = coo_t::entry_type;
+using csr_t = reader_t::csr_type;
 
 int main(int argc, char **argv) {
 
@@ -23,20 +27,24 @@ int main(int argc, char **argv) {
         std::cerr << "USAGE: " << argv[0] << " input.mtx...\n";
     }
 
-    std::cout << "file,rows,cols,nnz,max abs,max nnz/row,avg nnz/row,diags,bandwidth,diagness,hopkins,err\n";
+    // columns added since the first release go after hopkins, so existing ones keep their positions
+    const std::string header = "file,rows,cols,nnz,max abs,max nnz/row,avg nnz/row,diags,bandwidth,diagness,hopkins,rcm bandwidth,components,largest component,structural symmetry,err";
+    std::cout << header << "\n";
 
-    // read as coo data
+    // read as coo data, the next file in the background while this one is analyzed
+    CooPrefetcher<Ordinal, Scalar, Offset> loader(std::vector<std::string>(argv + 1, argv + argc), 1,
+                                                  physical_memory_bytes() / 4);
     for (int arg = 1; arg < argc; ++arg) {
 
         std::cout << argv[arg] << std::flush;
-        reader_t reader(argv[arg]);
+        std::future<coo_t> pending = loader.next();
         coo_t res;
         try {
-            res = reader.read_coo();
+            res = pending.get();
 
         } catch (const std::exception &e) {
-            // on error, blank, but print failure reason
-            std::cout << ",,,,,,,,,," << e.what() << "\n";
+            // on error, blank, but print failure reason under err, one comma per column after file
+            std::cout << std::string(std::count(header.begin(), header.end(), ','), ',') << e.what() << "\n";
             continue;
         }
 
@@ -100,7 +108,6 @@ int main(int argc, char **argv) {
             std::cout << "," << K;
         }
 
-
         // count diagonal-ness
         // entry e at i,j contributes e paired (i,j) samples.
         // THis probably can be extended to non-negative reals, but I'm not sure how
@@ -183,6 +190,29 @@ int main(int argc, char **argv) {
             std::cout << "," << su / (su + sw);
         }
 
+        // the RCM bandwidth and structural symmetry of square matrices share one CSR
+        const bool square = res.num_rows() == res.num_cols();
+        const csr_t csr = square ? csr_t(res) : csr_t();
+
+        {
+            // bandwidth after reverse Cuthill-McKee reordering (square matrices only)
+            std::cout << ",";
+            if (square) {
+                std::cout << bandwidth(permute_symmetric(csr, rcm(csr)));
+            }
+            std::cout << std::flush;
+        }
+
+        {
+            // connected components of the graph, and the fraction of off-diagonal entries whose mirror is stored
+            const Components<Ordinal> components = connected_components(res);
+            std::cout << "," << components.count() << "," << components.largest() << ",";
+            if (square) {
+                std::cout << structural_symmetry(csr);
+            }
+            std::cout << std::flush;
+        }
+
         // no error
         std::cout << "," << std::endl;
     }
@@ -2,13 +2,25 @@
 // This code is released under the GPLv3 license
 
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <exception>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 #include <cmath>
 #include <iomanip>
+#include <limits>
+#include <complex>
+
+#include <sys/stat.h>
 
 #include "mm/mm.hpp"
 
@@ -31,7 +43,7 @@ void ppm_banner(std::ofstream &fs, int width, int height, std::vector<std::strin
 // assume maxval is 255
 // data should be raster rows, of RGB, one byte each channel
 void ppm_data(std::ofstream &fs, const char *data, int width, int height) {
-    fs.write(data, width*height*3);
+    fs.write(data, size_t(width)*height*3);
 }
 
 using Ordinal = int64_t;
@@ -41,6 +53,9 @@ using reader_t = MtxReader<Ordinal, Scalar, Offset>;
 using coo_t = reader_t::coo_type;
 using entry_t = coo_t::entry_type;
 
+// value modes read every scalar kind as complex so the phase survives
+using value_reader_t = MtxReader<Ordinal, std::complex<double>, Offset>;
+
 static double logish(const double x) {
     if (0 == x) {
         return 0;
@@ -57,102 +72,777 @@ static double inv_logish(const double x) {
     }
 }
 
+/* split the data section of the file into one byte range per thread,
+   and call f(t, entry) from thread t for each entry in its range
+*/
+template <typename Reader, typename F>
+static void parallel_for_each_entry(const Reader &reader, const int nThreads, F f) {
+    const std::streamoff begin = reader.data_begin();
+    const std::streamoff end = reader.data_end();
+
+    std::vector<std::exception_ptr> errors(nThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; ++t) {
+        threads.push_back(std::thread([&, t]() {
+            try {
+                const std::streamoff lb = begin + (end - begin) * t / nThreads;
+                const std::streamoff ub = begin + (end - begin) * (t + 1) / nThreads;
+                reader.for_each_entry(lb, ub, [&](const typename Reader::coo_entry_type &e) { f(t, e); });
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        }));
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    for (const std::exception_ptr &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+// a += v, as a relaxed compare-and-swap loop
+static void atomic_add(std::atomic<double> &a, const double v) {
+    double old = a.load(std::memory_order_relaxed);
+    while (!a.compare_exchange_weak(old, old + v, std::memory_order_relaxed)) {
+    }
+}
+
+/* per-pixel accumulators, shared by every thread binning a band.
+   add() folds in the value of one entry with relaxed atomics, since nothing reads a pixel until
+   the threads are joined, and value() is what gets colormapped.
+   Counts saturate instead of wrapping.
+*/
+struct CountPixel {
+    std::atomic<uint32_t> n;
+    CountPixel() : n(0) {}
+    template <typename S> void add(const S &) {
+        uint32_t old = n.load(std::memory_order_relaxed);
+        while (old != UINT32_MAX && !n.compare_exchange_weak(old, old + 1, std::memory_order_relaxed)) {
+        }
+    }
+    uint32_t count() const { return n.load(std::memory_order_relaxed); }
+    bool empty() const { return 0 == count(); }
+    double value() const { return count(); }
+};
+
+// largest |a_ij|
+struct MaxAbsPixel : CountPixel {
+    std::atomic<float> m;
+    MaxAbsPixel() : m(0) {}
+    void add(const std::complex<double> &e) {
+        CountPixel::add(e);
+        const float v = float(std::abs(e));
+        float old = m.load(std::memory_order_relaxed);
+        while (old < v && !m.compare_exchange_weak(old, v, std::memory_order_relaxed)) {
+        }
+    }
+    double value() const { return m.load(std::memory_order_relaxed); }
+};
+
+// sum of a_ij (real part for complex matrices)
+struct SumPixel : CountPixel {
+    std::atomic<double> s;
+    SumPixel() : s(0) {}
+    void add(const std::complex<double> &e) { CountPixel::add(e); atomic_add(s, e.real()); }
+    double value() const { return s.load(std::memory_order_relaxed); }
+};
+
+// mean of a_ij (real part for complex matrices)
+struct MeanPixel : SumPixel {
+    double value() const { return SumPixel::value() / count(); }
+};
+
+// phase of the sum of a_ij
+struct PhasePixel : CountPixel {
+    std::atomic<double> re;
+    std::atomic<double> im;
+    PhasePixel() : re(0), im(0) {}
+    void add(const std::complex<double> &e) { CountPixel::add(e); atomic_add(re, e.real()); atomic_add(im, e.imag()); }
+    double value() const { return std::atan2(im.load(std::memory_order_relaxed), re.load(std::memory_order_relaxed)); }
+};
+
+/* the pixel values of an image, appended one band of rows at a time.
+   The first band is held in memory, and only once a second band arrives do they go to a file beside
+   the output, so that only one band is in memory. Empty pixels are stored as a NaN that is_empty()
+   tests by its bits, since the tools build with -ffast-math.
+   Also gathers the statistics that the colormaps are normalized by.
+*/
+class ValueSpill {
+    static const uint32_t EMPTY = 0x7fc0e3e3;
+
+    std::string path_;
+    std::fstream f_;
+    std::vector<float> held_; // the first band, until there is a second
+    size_t pos_;              // next value read() takes from held_
+
+public:
+    uint64_t nnz;  // entries binned
+    uint32_t cMax; // most entries in one pixel
+    double lo;     // smallest non-zero |value()| of a non-empty pixel
+    double hi;     // largest |value()| of a non-empty pixel
+
+    explicit ValueSpill(const std::string &path)
+        : path_(path), pos_(0), nnz(0), cMax(0), lo(std::numeric_limits<double>::infinity()), hi(0) {}
+    ~ValueSpill() {
+        if (f_.is_open()) {
+            f_.close();
+            std::remove(path_.c_str());
+        }
+    }
+
+    template <typename Pixel>
+    void append(const std::vector<Pixel> &band) {
+        std::vector<float> values(band.size());
+        for (size_t i = 0; i < band.size(); ++i) {
+            const Pixel &p = band[i];
+            if (p.empty()) {
+                std::memcpy(&values[i], &EMPTY, sizeof(float));
+                continue;
+            }
+            const double v = p.value();
+            values[i] = float(v);
+            nnz += p.count();
+            cMax = std::max(cMax, p.count());
+            if (std::abs(v) > 0) {
+                lo = std::min(lo, std::abs(v));
+                hi = std::max(hi, std::abs(v));
+            }
+        }
+        if (!f_.is_open() && held_.empty()) {
+            held_.swap(values);
+            return;
+        }
+        if (!f_.is_open()) {
+            f_.open(path_, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!f_) {
+                throw std::runtime_error("couldn't create " + path_);
+            }
+            f_.write((const char *)held_.data(), held_.size() * sizeof(float));
+            std::vector<float>().swap(held_);
+        }
+        f_.write((const char *)values.data(), values.size() * sizeof(float));
+        if (!f_) {
+            throw std::runtime_error("error writing " + path_);
+        }
+    }
+
+    static bool is_empty(const float v) {
+        uint32_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        return EMPTY == bits;
+    }
+
+    // read the next n values, starting over from the first after rewind()
+    void rewind() {
+        if (f_.is_open()) {
+            f_.seekg(0);
+        }
+        pos_ = 0;
+    }
+    void read(float *values, const size_t n) {
+        if (!f_.is_open()) {
+            if (pos_ + n > held_.size()) {
+                throw std::runtime_error("read past the values of " + path_);
+            }
+            std::copy(held_.begin() + pos_, held_.begin() + pos_ + n, values);
+            pos_ += n;
+            return;
+        }
+        f_.read((char *)values, n * sizeof(float));
+        if (!f_) {
+            throw std::runtime_error("error reading " + path_);
+        }
+    }
+};
+
+/* accumulate the entries that land in image rows [y0, y1).
+
+   Every thread adds into the same pixels, so a band takes the same memory however many threads bin it.
+*/
+template <typename Pixel, typename Reader>
+static std::vector<Pixel> rasterize_band(const Reader &reader, const int width, const int height,
+                                         const int y0, const int y1, const int nThreads) {
+    typedef typename Reader::coo_entry_type reader_entry_t;
+    const Ordinal nrows = reader.info().nrows;
+    const Ordinal ncols = reader.info().ncols;
+    const size_t bandSize = size_t(y1 - y0) * width;
+
+    std::vector<Pixel> hist(bandSize);
+    parallel_for_each_entry(reader, nThreads, [&](int, const reader_entry_t &e) {
+        // map to image pixel
+        int64_t py = e.i * height / nrows;
+        py = std::max(int64_t(0), std::min(py, int64_t(height - 1)));
+        if (py < y0 || py >= y1) {
+            return;
+        }
+        int64_t px = e.j * width / ncols;
+        px = std::max(int64_t(0), std::min(px, int64_t(width - 1)));
+        hist[size_t(py - y0) * width + px].add(e.e);
+    });
+    return hist;
+}
+
+/* accumulate all matrix entries into spill, in as many bands of rows as the memory budget requires.
+   A band takes its pixels plus their values
+*/
+template <typename Pixel, typename Reader>
+static void rasterize(const Reader &reader, const int width, const int height,
+                      const int nThreads, const size_t memBudget, ValueSpill &spill) {
+    const size_t rowBytes = size_t(width) * (sizeof(Pixel) + sizeof(float));
+    const int bandRows = int(std::max(size_t(1), std::min(size_t(height), memBudget / rowBytes)));
+    for (int y0 = 0; y0 < height; y0 += bandRows) {
+        const int y1 = std::min(height, y0 + bandRows);
+        if (bandRows < height) {
+            std::cerr << "rows " << y0 << "-" << y1 << " of " << height << "\n";
+        }
+        spill.append(rasterize_band<Pixel>(reader, width, height, y0, y1, nThreads));
+    }
+}
+
+struct RGB {
+    unsigned char r;
+    unsigned char g;
+    unsigned char b;
+    RGB(double _r, double _g, double _b) : r(_r + 0.5), g(_g + 0.5), b(_b + 0.5) {}
+};
+
+static RGB lerp(const double (*stops)[3], int nStops, double t) {
+    t = std::max(0.0, std::min(t, 1.0)) * (nStops - 1);
+    const int k = std::min(int(t), nStops - 2);
+    const double f = t - k;
+    return RGB(stops[k][0] + f * (stops[k+1][0] - stops[k][0]),
+               stops[k][1] + f * (stops[k+1][1] - stops[k][1]),
+               stops[k][2] + f * (stops[k+1][2] - stops[k][2]));
+}
+
+// sequential colormap (viridis), t in [0,1]
+static RGB viridis(const double t) {
+    static const double stops[][3] = {
+        {68, 1, 84}, {72, 40, 120}, {62, 74, 137}, {49, 104, 142}, {38, 130, 142},
+        {31, 158, 137}, {53, 183, 121}, {110, 206, 88}, {181, 222, 43}, {253, 231, 37}};
+    return lerp(stops, 10, t);
+}
+
+// diverging colormap (blue - white - red), t in [-1,1]
+static RGB coolwarm(const double t) {
+    static const double stops[][3] = {
+        {59, 76, 192}, {141, 176, 254}, {221, 221, 221}, {244, 154, 123}, {180, 4, 38}};
+    return lerp(stops, 5, (t + 1) / 2);
+}
+
+// h, s, and v in [0,1]
+static RGB hsv(const double h, const double s, const double v) {
+    const double hh = (h - std::floor(h)) * 6;
+    const int k = int(hh) % 6;
+    const double f = hh - std::floor(hh);
+    const double p = v * (1 - s), q = v * (1 - s * f), u = v * (1 - s * (1 - f));
+    switch (k) {
+    case 0: return RGB(255 * v, 255 * u, 255 * p);
+    case 1: return RGB(255 * q, 255 * v, 255 * p);
+    case 2: return RGB(255 * p, 255 * v, 255 * u);
+    case 3: return RGB(255 * p, 255 * q, 255 * v);
+    case 4: return RGB(255 * u, 255 * p, 255 * v);
+    default: return RGB(255 * v, 255 * p, 255 * q);
+    }
+}
+
+// write the image one raster row at a time, coloring each pixel value. empty pixels are white
+template <typename Color>
+static void write_image(std::ofstream &outf, ValueSpill &spill, const int width, const int height,
+                        const std::vector<std::string> &comments, Color color) {
+    ppm_banner(outf, width, height, comments);
+    spill.rewind();
+    std::vector<float> row(width);
+    std::vector<unsigned char> data(size_t(width) * 3 /*channels*/);
+    for (int y = 0; y < height; ++y) {
+        spill.read(row.data(), width);
+        for (int x = 0; x < width; ++x) {
+            const RGB c = ValueSpill::is_empty(row[x]) ? RGB(255, 255, 255) : color(row[x]);
+            data[x*3+0] = c.r;
+            data[x*3+1] = c.g;
+            data[x*3+2] = c.b;
+        }
+        ppm_data(outf, (char*)data.data(), width, 1);
+    }
+}
+
+enum class Mode {
+    COUNT,
+    MAXABS,
+    SUM,
+    MEAN,
+    PHASE
+};
+
+/* render a value mode: magnitudes use a log-scaled sequential colormap,
+   signed values a symmetric-log diverging colormap, and phase a hue wheel
+*/
+template <typename Pixel>
+static void render_values(const value_reader_t &reader, std::ofstream &outf, ValueSpill &spill, const Mode mode,
+                          const int width, const int height, const int nThreads, const size_t memBudget,
+                          std::vector<std::string> comments) {
+    rasterize<Pixel>(reader, width, height, nThreads, memBudget, spill);
+
+    // smallest non-zero and largest magnitude over non-empty pixels
+    double lo = spill.lo;
+    double hi = spill.hi;
+    if (hi == 0) {
+        lo = hi = 1;
+    }
+    std::cerr << "pixel magnitudes: " << lo << " - " << hi << "\n";
+
+    std::stringstream ss;
+    ss << "pixel magnitudes " << lo << " - " << hi;
+    comments.push_back(ss.str());
+
+    const double logLo = std::log10(lo);
+    const double logRange = std::log10(hi) - logLo;
+    const double symlogMax = std::log1p(hi / lo);
+    std::cerr << "write image" << std::endl;
+    switch (mode) {
+    case Mode::MAXABS: {
+        comments.push_back("color is log10(max |a_ij|), viridis");
+        write_image(outf, spill, width, height, comments, [&](const double v) {
+            return viridis(logRange > 0 ? (std::log10(v) - logLo) / logRange : 1);
+        });
+        break;
+    }
+    case Mode::SUM:
+    case Mode::MEAN: {
+        comments.push_back("color is sign(a) log(1 + |a| / min |a|), blue negative, red positive");
+        write_image(outf, spill, width, height, comments, [&](const double v) {
+            const double t = std::log1p(std::abs(v) / lo) / symlogMax;
+            return coolwarm(v < 0 ? -t : t);
+        });
+        break;
+    }
+    case Mode::PHASE: {
+        comments.push_back("hue is the phase of the sum of a_ij, red is 0");
+        write_image(outf, spill, width, height, comments, [&](const double v) {
+            return hsv(v / (2 * std::acos(-1.0)), 1, 1);
+        });
+        break;
+    }
+    case Mode::COUNT:
+        throw std::logic_error("count is not a value mode");
+    }
+}
+
+/* a .tiles file, written one tile at a time in row-major grid order:
+   native-endian uint32 number of tiles, then for each tile: ty, tx, tile x tile counts
+*/
+class TileWriter {
+    std::string path_;
+    std::ofstream outf_;
+    uint32_t n_;
+
+public:
+    explicit TileWriter(const std::string &path) : path_(path), outf_(path, std::ios::binary), n_(0) {
+        if (!outf_) {
+            throw std::runtime_error("couldn't open " + path);
+        }
+        outf_.write((const char *)&n_, sizeof(n_)); // filled in by close()
+    }
+
+    void add(const int ty, const int tx, const std::vector<uint32_t> &t) {
+        const uint32_t yx[2] = {uint32_t(ty), uint32_t(tx)};
+        outf_.write((const char *)yx, sizeof(yx));
+        outf_.write((const char *)t.data(), t.size() * sizeof(uint32_t));
+        ++n_;
+    }
+
+    void close() {
+        outf_.seekp(0);
+        outf_.write((const char *)&n_, sizeof(n_));
+        outf_.close();
+        if (!outf_) {
+            throw std::runtime_error("error writing " + path_);
+        }
+    }
+};
+
+/* A mip-style pyramid of square density tiles.
+
+   Level z is a (2^z x 2^z) grid of tile x tile pixels that covers a
+   span x span square (span = max(rows, cols)) from the top-left of the matrix.
+   Only non-empty tiles are allocated.
+*/
+struct Pyramid {
+    typedef std::vector<uint32_t> Tile;
+    int tile;
+    int level;
+    int grid; // 2^level
+    std::vector<Tile> tiles; // row-major over the grid, empty if the tile has no entries
+
+    Pyramid(int _tile, int _level) : tile(_tile), level(_level), grid(1 << _level), tiles(size_t(grid) * grid) {}
+
+    // sum 2x2 pixels of src, tile (ty, tx) of the level below, into this level
+    void add_coarsened(const int ty, const int tx, const Tile &src) {
+        Tile &dst = tiles[size_t(ty / 2) * grid + tx / 2];
+        if (dst.empty()) {
+            dst.assign(size_t(tile) * tile, 0);
+        }
+        const int oy = (ty % 2) * tile / 2;
+        const int ox = (tx % 2) * tile / 2;
+        for (int y = 0; y < tile; ++y) {
+            for (int x = 0; x < tile; ++x) {
+                uint32_t &d = dst[size_t(oy + y / 2) * tile + ox + x / 2];
+                d = uint32_t(std::min(uint64_t(d) + src[size_t(y) * tile + x], uint64_t(UINT32_MAX)));
+            }
+        }
+    }
+
+    // the level above
+    Pyramid coarsen() const {
+        Pyramid up(tile, level - 1);
+        for (int ty = 0; ty < grid; ++ty) {
+            for (int tx = 0; tx < grid; ++tx) {
+                const Tile &src = tiles[size_t(ty) * grid + tx];
+                if (!src.empty()) {
+                    up.add_coarsened(ty, tx, src);
+                }
+            }
+        }
+        return up;
+    }
+
+    void write(const std::string &path) const {
+        TileWriter w(path);
+        for (int ty = 0; ty < grid; ++ty) {
+            for (int tx = 0; tx < grid; ++tx) {
+                const Tile &t = tiles[size_t(ty) * grid + tx];
+                if (!t.empty()) {
+                    w.add(ty, tx, t);
+                }
+            }
+        }
+        w.close();
+    }
+
+    // bytes of a level with every tile allocated
+    static double dense_bytes(const int tile, const int level) {
+        return std::pow(4.0, level) * (sizeof(Tile) + double(tile) * tile * sizeof(uint32_t));
+    }
+};
+
+/* tile rows [ty0, ty1) of a pyramid level, as one thread bins them
+ */
+struct PyramidBand {
+    int tile;
+    int grid;
+    int ty0;
+    std::vector<Pyramid::Tile> tiles; // row-major over the band
+
+    PyramidBand(int _tile, int _grid, int _ty0, int ty1)
+        : tile(_tile), grid(_grid), ty0(_ty0), tiles(size_t(ty1 - _ty0) * _grid) {}
+
+    uint32_t &at(int64_t py, int64_t px) {
+        Pyramid::Tile &t = tiles[size_t(py / tile - ty0) * grid + px / tile];
+        if (t.empty()) {
+            t.assign(size_t(tile) * tile, 0);
+        }
+        return t[size_t(py % tile) * tile + px % tile];
+    }
+};
+
+static std::string level_path(const std::string &outDir, const int z) {
+    std::stringstream ss;
+    ss << outDir << "/level-" << z << ".tiles";
+    return ss.str();
+}
+
+/* bin all entries into the finest level of a pyramid and write it into outDir as level-<z>.tiles,
+   then each coarser level (built from the one below it), with a pyramid.txt that describes them.
+
+   The finest level is binned in bands of tile rows, one pass over the file per band, with the
+   threads' copies of a band sharing half of -m. A finished band is written out and
+   folded into the next coarser level, which is the only whole level held in memory.
+*/
+static void write_pyramid(const reader_t &reader, const std::string &outDir, const int tile,
+                          int levels, const size_t memBudget, const int nThreads) {
+    const Ordinal nrows = reader.info().nrows;
+    const Ordinal ncols = reader.info().ncols;
+    const int64_t span = std::max(nrows, ncols);
+
+    // finest level has about one matrix row per pixel, unless that would exceed the memory budget if dense
+    if (levels <= 0) {
+        levels = 1;
+        while ((int64_t(tile) << (levels - 1)) < span && Pyramid::dense_bytes(tile, levels) <= memBudget) {
+            ++levels;
+        }
+    }
+    const int finest = levels - 1;
+    const int64_t res = int64_t(tile) << finest;
+    const int grid = 1 << finest;
+    std::cerr << "pyramid: " << levels << " levels of " << tile << " x " << tile << " tiles, finest is "
+              << res << " x " << res << "\n";
+
+    if (mkdir(outDir.c_str(), 0755) && errno != EEXIST) {
+        throw std::runtime_error("couldn't create " + outDir);
+    }
+
+    // the threads' copies of a band get half the budget, the next coarser level at most a quarter
+    const double rowBytes = nThreads * Pyramid::dense_bytes(tile, finest) / grid;
+    const int bandRows = int(std::max(1.0, std::min(double(grid), memBudget / 2 / rowBytes)));
+
+    Pyramid up(tile, std::max(0, finest - 1));
+    TileWriter finestOut(level_path(outDir, finest));
+    uint64_t nnz = 0;
+    for (int ty0 = 0; ty0 < grid; ty0 += bandRows) {
+        const int ty1 = std::min(grid, ty0 + bandRows);
+        if (bandRows < grid) {
+            std::cerr << "tile rows " << ty0 << "-" << ty1 << " of " << grid << "\n";
+        }
+
+        // each thread bins into its own sparse band, which are merged tile-by-tile
+        std::vector<PyramidBand> partials(nThreads, PyramidBand(tile, grid, ty0, ty1));
+        parallel_for_each_entry(reader, nThreads, [&](int t, const entry_t &e) {
+            const int64_t py = e.i * res / span;
+            if (py / tile < ty0 || py / tile >= ty1) {
+                return;
+            }
+            uint32_t &h = partials[t].at(py, e.j * res / span);
+            h += (h != UINT32_MAX);
+        });
+        std::vector<Pyramid::Tile> &band = partials[0].tiles;
+        for (size_t ti = 0; ti < band.size(); ++ti) {
+            for (int t = 1; t < nThreads; ++t) {
+                Pyramid::Tile &src = partials[t].tiles[ti];
+                Pyramid::Tile &dst = band[ti];
+                if (src.empty()) {
+                    continue;
+                } else if (dst.empty()) {
+                    dst.swap(src);
+                } else {
+                    for (size_t i = 0; i < dst.size(); ++i) {
+                        dst[i] = uint32_t(std::min(uint64_t(dst[i]) + src[i], uint64_t(UINT32_MAX)));
+                    }
+                    Pyramid::Tile().swap(src);
+                }
+            }
+
+            Pyramid::Tile &t = band[ti];
+            if (t.empty()) {
+                continue;
+            }
+            const int ty = ty0 + int(ti / grid);
+            const int tx = int(ti % grid);
+            for (uint32_t c : t) {
+                nnz += c;
+            }
+            finestOut.add(ty, tx, t);
+            if (finest > 0) {
+                up.add_coarsened(ty, tx, t);
+            }
+            Pyramid::Tile().swap(t);
+        }
+    }
+    std::cerr << "write " << level_path(outDir, finest) << std::endl;
+    finestOut.close();
+
+    for (int z = finest - 1; z >= 0; --z) {
+        std::cerr << "write " << level_path(outDir, z) << std::endl;
+        up.write(level_path(outDir, z));
+        if (z > 0) {
+            up = up.coarsen();
+        }
+    }
+
+    std::ofstream meta(outDir + "/pyramid.txt");
+    meta << "# created by github.com/cwpearson/matrix-market/tools/mtx-to-ppm\n";
+    meta << "# level-<z>.tiles covers span x span entries with a 2^z x 2^z grid of tile x tile pixels\n";
+    meta << "rows " << nrows << "\n";
+    meta << "cols " << ncols << "\n";
+    meta << "nnz " << nnz << "\n";
+    meta << "span " << span << "\n";
+    meta << "tile " << tile << "\n";
+    meta << "levels " << levels << "\n";
+}
+
+static void usage(const char *argv0) {
+    std::cerr << "USAGE:\n";
+    std::cerr << " " << argv0 << " [-j threads] [-m MiB] [-v mode] input.mtx output.ppm width height\n";
+    std::cerr << " " << argv0 << " [-j threads] [-m MiB] [-v mode] input.mtx output.ppm maxdim\n";
+    std::cerr << " " << argv0 << " [-j threads] [-m MiB] -p [-t tile] [-l levels] input.mtx output-dir\n";
+    std::cerr << "  -j: number of threads (default: all hardware threads)\n";
+    std::cerr << "  -m: memory for histograms, in MiB (default: 1024)\n";
+    std::cerr << "      larger images are rendered in bands of rows, one pass over the file per band\n";
+    std::cerr << "      with more than one band, finished bands wait in output.ppm.values, 4 bytes per pixel,\n";
+    std::cerr << "      until the image is written\n";
+    std::cerr << "  -v: what each pixel shows (default: count)\n";
+    std::cerr << "      count: number of entries, grey\n";
+    std::cerr << "      maxabs: largest |a_ij|\n";
+    std::cerr << "      sum: sum of a_ij (real part)\n";
+    std::cerr << "      mean: mean of a_ij (real part)\n";
+    std::cerr << "      phase: phase of the sum of a_ij, as hue\n";
+    std::cerr << "  -p: write a tile pyramid instead of one image. Pyramids hold counts, so -v is not allowed\n";
+    std::cerr << "  -t: pyramid tile size, a power of two (default: 256)\n";
+    std::cerr << "  -l: number of pyramid levels, if the finest fits in -m when dense\n";
+    std::cerr << "      (default: about one matrix row per finest pixel, within -m)\n";
+    std::cerr << "      the finest level is binned in bands of tiles, one pass over the file per band\n";
+}
+
 int main(int argc, char **argv) {
-    if (argc > 5 || argc < 4) {
-        std::cerr << "USAGE:\n";
-        std::cerr << " " << argv[0] << "input.mtx output.pbm width height\n";
-        std::cerr << " " << argv[0] << "input.mtx output.pbm maxdim\n";
+
+    int nThreads = std::max(1u, std::thread::hardware_concurrency());
+    size_t memBudget = size_t(1024) * 1024 * 1024;
+
+    Mode mode = Mode::COUNT;
+    bool pyramid = false;
+    int tile = 256;
+    int levels = 0;
+
+    std::vector<char *> args;
+    for (int i = 1; i < argc; ++i) {
+        if (0 == std::strcmp(argv[i], "-v") && i + 1 < argc) {
+            const std::string m = argv[++i];
+            if ("count" == m) {
+                mode = Mode::COUNT;
+            } else if ("maxabs" == m) {
+                mode = Mode::MAXABS;
+            } else if ("sum" == m) {
+                mode = Mode::SUM;
+            } else if ("mean" == m) {
+                mode = Mode::MEAN;
+            } else if ("phase" == m) {
+                mode = Mode::PHASE;
+            } else {
+                usage(argv[0]);
+                exit(1);
+            }
+        } else if (0 == std::strcmp(argv[i], "-p")) {
+            pyramid = true;
+        } else if (0 == std::strcmp(argv[i], "-t") && i + 1 < argc) {
+            tile = std::atoi(argv[++i]);
+        } else if (0 == std::strcmp(argv[i], "-l") && i + 1 < argc) {
+            levels = std::atoi(argv[++i]);
+        } else if (0 == std::strcmp(argv[i], "-j") && i + 1 < argc) {
+            nThreads = std::max(1, std::atoi(argv[++i]));
+        } else if (0 == std::strcmp(argv[i], "-m") && i + 1 < argc) {
+            memBudget = size_t(std::max(1, std::atoi(argv[++i]))) * 1024 * 1024;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+
+    if (pyramid) {
+        if (args.size() != 2 || tile < 2 || (tile & (tile - 1)) || mode != Mode::COUNT) {
+            usage(argv[0]);
+            exit(1);
+        }
+        if (levels > 0 && Pyramid::dense_bytes(tile, levels - 1) > memBudget) {
+            std::cerr << "-l " << levels << " needs up to " << Pyramid::dense_bytes(tile, levels - 1) / (1024 * 1024)
+                      << " MiB for the finest level, more than -m\n";
+            usage(argv[0]);
+            exit(1);
+        }
+        std::cerr << "read " << args[0] << std::endl;
+        reader_t reader(args[0]);
+        write_pyramid(reader, args[1], tile, levels, memBudget, nThreads);
+        return 0;
+    }
+
+    if (args.size() > 4 || args.size() < 3) {
+        usage(argv[0]);
         exit(1);
     }
 
-    std::cerr << "open " << argv[2] << std::endl;
-    std::ofstream outf(argv[2]);
+    std::cerr << "open " << args[1] << std::endl;
+    std::ofstream outf(args[1], std::ios::binary);
     if (!outf) {
-        std::cerr << "some error opening " << argv[2] << std::endl;
+        std::cerr << "some error opening " << args[1] << std::endl;
         exit(1);
     }
 
-    std::cerr << "read " << argv[1] << std::endl;
-    reader_t reader(argv[1]);
-    coo_t coo = reader.read_coo();
+    std::cerr << "read " << args[0] << std::endl;
+    reader_t reader(args[0]);
+    const Ordinal nrows = reader.info().nrows;
+    const Ordinal ncols = reader.info().ncols;
 
     int width = -1, height = -1;
-    if (5 == argc) {
-        width = std::atoi(argv[3]);
-        height = std::atoi(argv[4]);
-        width = std::min(width, int(coo.num_cols()));
-        height = std::min(height, int(coo.num_rows()));
-    } else if (4 == argc) {
-        if (coo.num_rows() > coo.num_cols()) {
-            height = std::atoi(argv[3]);
-            height = std::min(height, int(coo.num_rows()));
-            width = double(coo.num_cols()) * height / coo.num_rows() + 0.5;
+    if (4 == args.size()) {
+        width = std::atoi(args[2]);
+        height = std::atoi(args[3]);
+        width = std::min(width, int(ncols));
+        height = std::min(height, int(nrows));
+    } else if (3 == args.size()) {
+        if (nrows > ncols) {
+            height = std::atoi(args[2]);
+            height = std::min(height, int(nrows));
+            width = double(ncols) * height / nrows + 0.5;
         } else {
-            width = std::atoi(argv[3]);
-            width = std::min(width, int(coo.num_cols()));
-            height = double(coo.num_rows()) * width / coo.num_cols() + 0.5;
+            width = std::atoi(args[2]);
+            width = std::min(width, int(ncols));
+            height = double(nrows) * width / ncols + 0.5;
         }
     }
 
-    if (width <= 0 && height <= 0) {
+    if (width <= 0 || height <= 0) {
         std::cerr << "need to specify width and/or height > 0\n";
         exit(1);
     } else {
         std::cerr << "output image will be " << width << " x " << height << "\n";
     }
 
-    // histogram all matrix entries
-    std::vector<double> hist(width * height, 0);
-
-    // map to image pixel
-    for (const entry_t &e : coo.entries) {
-        int px = double(e.j) / coo.num_cols() * width;
-        int py = double(e.i) / coo.num_rows() * height;
-        px = std::max(0, std::min(px, width));
-        py = std::max(0, std::min(py, height));
-        hist[py * width + px] += 1.0;
-    }
-
-    // ~ log of histogram
-    for (size_t i = 0; i < hist.size(); ++i) {
-        hist[i] = logish(hist[i]);
-    }
-
-    // normalize to 0-255
-    double hMax = 0;
-    for (size_t i = 0; i < hist.size(); ++i) {
-        hMax = std::max(hMax, hist[i]);
-    }
-    std::cerr << "max pixel val: " << hMax << "\n";
-    std::vector<unsigned char> data(hist.size() * 3 /*channels*/);
-    for (size_t i = 0; i < hist.size(); ++i) {
-        double h = std::max(0.0, std::min(hist[i] / hMax * 255, 255.0));
-        data[i*3+0] = (255 - h) + 0.5;
-        data[i*3+1] = (255 - h) + 0.5;
-        data[i*3+2] = (255 - h) + 0.5;
-    }
-
-
-    // generate comments
+    // comments common to all modes
     std::vector<std::string> comments;
     {
         // source matrix info
         std::stringstream ss;
-        ss << "source matrix: " << coo.num_rows() << " x " << coo.num_cols() << " w/ " << coo.nnz() << " nnz";
+        ss << "source matrix: " << nrows << " x " << ncols << " w/ " << reader.info().nnz << " stored entries";
         comments.push_back(ss.str());
         ss.str(""); // clear
 
         // pixel size
         ss << "each pixel approx " 
-           << uint64_t(double(coo.num_rows()) / height + 0.5) << " x "
-           << uint64_t(double(coo.num_cols()) / width  + 0.5) << " entries";
+           << uint64_t(double(nrows) / height + 0.5) << " x "
+           << uint64_t(double(ncols) / width  + 0.5) << " entries";
         comments.push_back(ss.str()); 
         ss.str(""); // clear
+    }
+
+    // values of finished bands, until the colormap is known
+    ValueSpill spill(std::string(args[1]) + ".values");
+
+    switch (mode) {
+    case Mode::COUNT:
+        break;
+    case Mode::MAXABS:
+        render_values<MaxAbsPixel>(value_reader_t(args[0]), outf, spill, mode, width, height, nThreads, memBudget, comments);
+        return 0;
+    case Mode::SUM:
+        render_values<SumPixel>(value_reader_t(args[0]), outf, spill, mode, width, height, nThreads, memBudget, comments);
+        return 0;
+    case Mode::MEAN:
+        render_values<MeanPixel>(value_reader_t(args[0]), outf, spill, mode, width, height, nThreads, memBudget, comments);
+        return 0;
+    case Mode::PHASE:
+        render_values<PhasePixel>(value_reader_t(args[0]), outf, spill, mode, width, height, nThreads, memBudget, comments);
+        return 0;
+    }
+
+    // histogram all matrix entries
+    rasterize<CountPixel>(reader, width, height, nThreads, memBudget, spill);
+    const uint64_t nnz = spill.nnz;
+    const uint32_t cMax = spill.cMax;
+
+    // ~ log of histogram, normalized to 0-255
+    const double hMax = logish(cMax);
+    std::cerr << "max pixel val: " << hMax << "\n";
+
+    {
+        std::stringstream ss;
+        ss << "source matrix has " << nnz << " nnz";
+        comments.push_back(ss.str());
+        ss.str(""); // clear
 
         ss << "approx pixel's nnz count vs value\n";
         ss << "# each row is pixel value, then nnz count for val ... val+9";
 
-        const int fieldWidth = std::ceil(std::log10(inv_logish(hMax)));
+        const int fieldWidth = std::max(1.0, std::ceil(std::log10(inv_logish(hMax))));
 
         // pixel values
         for (int i = 0; i <= 255; ++i) {
@@ -175,11 +865,14 @@ int main(int argc, char **argv) {
         ss.str(""); // clear
     }
 
-    std::cerr << "write " << argv[2] << std::endl;
-    ppm_banner(outf, width, height, comments);
-    ppm_data(outf, (char*)data.data(), width, height);
+    std::cerr << "write " << args[1] << std::endl;
+    write_image(outf, spill, width, height, comments, [&](const double n) {
+        double h = hMax > 0 ? logish(n) / hMax * 255 : 0;
+        h = 255 - std::max(0.0, std::min(h, 255.0));
+        return RGB(h, h, h);
+    });
     outf.close();
 
     return 0;
 
-}
\ No newline at end of file
+}